@@ -1,5 +1,10 @@
 #include <SDL2/SDL.h>
 
+#ifdef __linux__
+#include <time.h>
+#include <errno.h>
+#endif
+
 #define GAME_FPS 60
 #define GAME_W 640
 #define GAME_H 480
@@ -51,14 +56,87 @@ static double GetTime() {
 	return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
 }
 
+#define MIN_SPIN_MARGIN 0.0002
+#define MAX_SPIN_MARGIN 0.02
+
+// WaitUntil() sleeps until this long before the deadline and spins for the rest.
+static double spin_margin = MAX_SPIN_MARGIN;
+
+static void SleepSeconds(double seconds) {
+#ifdef __linux__
+	timespec ts;
+	ts.tv_sec  = (time_t)seconds;
+	ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1000000000.0);
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {}
+#else
+	SDL_Delay((Uint32)(seconds * 1000.0));
+#endif
+}
+
+static double Clamp(double x, double min, double max) {
+	if (x < min) return min;
+	if (x > max) return max;
+	return x;
+}
+
+// Sets the initial spin margin from how much a 1ms sleep overshoots.
+static void CalibrateSleep() {
+	double worst = 0.0;
+	for (int i = 0; i < 8; i++) {
+		double t = GetTime();
+		SleepSeconds(0.001);
+		double took = GetTime() - t;
+		if (took > worst) worst = took;
+	}
+	spin_margin = Clamp(worst - 0.001 + MIN_SPIN_MARGIN, MIN_SPIN_MARGIN, MAX_SPIN_MARGIN);
+}
+
+// Returns how late we woke up, in seconds.
+static double WaitUntil(double deadline) {
+	double time = GetTime();
+
+	double sleep_time = (deadline - time) - spin_margin;
+	if (sleep_time > 0.0) {
+		SleepSeconds(sleep_time);
+
+		double now = GetTime();
+		double oversleep = (now - time) - sleep_time;
+
+		// Grow the margin right away, shrink it slowly.
+		double target = Clamp(oversleep + MIN_SPIN_MARGIN, MIN_SPIN_MARGIN, MAX_SPIN_MARGIN);
+		if (target > spin_margin) {
+			spin_margin = target;
+		} else {
+			spin_margin += (target - spin_margin) * 0.02;
+		}
+
+		time = now;
+	}
+
+	while (time < deadline) {
+#ifdef SDL_CPUPauseInstruction
+		SDL_CPUPauseInstruction();
+#endif
+		time = GetTime();
+	}
+
+	return time - deadline;
+}
+
 void Game::Run() {
+	CalibrateSleep();
+
 	double prev_time = GetTime();
+	double frame_end_time = prev_time;
+	double pacing_error = 0.0;
+	int missed_frames = 0;
 
 	bool quit = false;
 	while (!quit) {
 		double time = GetTime();
 
-		double frame_end_time = time + (1.0 / (double)GAME_FPS);
+		// Added to the last deadline, so that waking up a bit late doesn't slow the game down.
+		frame_end_time += (1.0 / (double)GAME_FPS);
 
 		double fps = 1.0 / (time - prev_time);
 		prev_time = time;
@@ -73,7 +151,7 @@ void Game::Run() {
 			}
 		}
 
-		printf("%f\n", fps);
+		printf("%f (pacing error %.3fms, missed %d frames)\n", fps, pacing_error * 1000.0, missed_frames);
 
 		// update
 		{
@@ -128,10 +206,13 @@ void Game::Run() {
 		}
 
 		time = GetTime();
-		double time_left = frame_end_time - time;
-		if (time_left > 0.0) {
-			SDL_Delay((Uint32)(time_left * 0.95));
-			while (GetTime() < frame_end_time) {}
+		if (time < frame_end_time) {
+			pacing_error = WaitUntil(frame_end_time);
+		} else {
+			// Missed it. The next frames get a full frame each, they don't hurry to make up for this one.
+			pacing_error = time - frame_end_time;
+			missed_frames++;
+			frame_end_time = time;
 		}
 	}
 }
@@ -3,6 +3,7 @@
 #include "package.h"
 #include "window_creation.h"
 #include "util.h"
+#include "software_renderer.h"
 
 Batch_Renderer renderer = {};
 
@@ -11,12 +12,13 @@ static char texture_vert_shader_src[] = R"(
 #version 330 core
 
 layout(location = 0) in vec3 in_Position;
-layout(location = 1) in vec3 in_Normal;
+layout(location = 1) in vec4 in_Shape;
 layout(location = 2) in vec4 in_Color;
-layout(location = 3) in vec2 in_TexCoord;
+layout(location = 3) in vec3 in_TexCoord;
 
 out vec4 v_Color;
-out vec2 v_TexCoord;
+out vec3 v_TexCoord;
+flat out vec4 v_Shape;
 
 uniform mat4 u_MVP;
 
@@ -25,6 +27,7 @@ void main() {
 
 	v_Color    = in_Color;
 	v_TexCoord = in_TexCoord;
+	v_Shape    = in_Shape;
 }
 )";
 
@@ -36,12 +39,35 @@ static char texture_frag_shader_src[] = R"(
 layout(location = 0) out vec4 FragColor;
 
 in vec4 v_Color;
-in vec2 v_TexCoord;
+in vec3 v_TexCoord;
+flat in vec4 v_Shape;
 
-uniform sampler2D u_Texture;
+uniform sampler2D      u_Texture;
+uniform sampler2DArray u_TextureArray;
 
 void main() {
-	vec4 color = texture(u_Texture, v_TexCoord);
+	// Size of a pixel in shape units, for anti-aliasing. Derivatives have to be taken outside of the branches.
+	vec2 p = v_TexCoord.xy;
+	float pixel = max(length(dFdx(p)), length(dFdy(p)));
+
+	vec4 color;
+	if (v_Shape.x == 1.0) {
+		// SHAPE_CIRCLE
+		float len = length(p);
+		float d = max(len - v_Shape.y, v_Shape.z - len);
+		color = vec4(1.0, 1.0, 1.0, clamp(0.5 - d / pixel, 0.0, 1.0));
+	} else if (v_Shape.x == 2.0) {
+		// SHAPE_ROUNDED_RECT
+		vec2 q = abs(p) - v_Shape.yz + v_Shape.w;
+		float d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - v_Shape.w;
+		color = vec4(1.0, 1.0, 1.0, clamp(0.5 - d / pixel, 0.0, 1.0));
+	} else if (v_TexCoord.z < 0.0) {
+		// z is the layer in the texture array, or -1 for a standalone texture.
+		// textureLod because there are no mipmaps, and implicit derivatives aren't defined inside non-uniform branches.
+		color = textureLod(u_Texture, v_TexCoord.xy, 0.0);
+	} else {
+		color = textureLod(u_TextureArray, v_TexCoord, 0.0);
+	}
 
 	FragColor = color * v_Color;
 }
@@ -65,7 +91,7 @@ static char sharp_bilinear_frag_shader_src[] = R"(
 layout(location = 0) out vec4 FragColor;
 
 in vec4 v_Color;
-in vec2 v_TexCoord;
+in vec3 v_TexCoord;
 
 uniform sampler2D u_Texture;
 
@@ -73,7 +99,7 @@ uniform vec2 u_SourceSize;
 uniform vec2 u_Scale; // The integer scale.
 
 void main() {
-	vec2 texel = v_TexCoord * u_SourceSize;
+	vec2 texel = v_TexCoord.xy * u_SourceSize;
 	vec2 scale = u_Scale;
 
 	vec2 texel_floored = floor(texel);
@@ -95,13 +121,28 @@ void main() {
 
 
 
+// 
+// ARB_buffer_storage isn't in our glad loader (it's generated for 3.3 core), so load it by hand.
+// 
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (GLAD_API_PTR *PFN_glBufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+static PFN_glBufferStorage _glBufferStorage;
+
 static void set_vertex_attribs() {
 	// Position
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
 	glEnableVertexAttribArray(0);
 
-	// Normal
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+	// Shape
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, shape));
 	glEnableVertexAttribArray(1);
 
 	// Color
@@ -109,11 +150,38 @@ static void set_vertex_attribs() {
 	glEnableVertexAttribArray(2);
 
 	// Texcoord
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
 	glEnableVertexAttribArray(3);
 }
 
+static void init_gl_resources();
+
 void init_renderer() {
+	renderer.batch_vertices.data = (Vertex*) malloc(BATCH_MAX_VERTICES * sizeof(Vertex));
+	renderer.batch_vertices.capacity = BATCH_MAX_VERTICES;
+
+	renderer.queue.data = (Draw_Command*) malloc(QUEUE_MAX_COMMANDS * sizeof(Draw_Command));
+	renderer.queue.capacity = QUEUE_MAX_COMMANDS;
+
+	renderer.queue_temp = (Draw_Command*) malloc(QUEUE_MAX_COMMANDS * sizeof(Draw_Command));
+
+	renderer.queue_vertices.data = (Vertex*) malloc(BATCH_MAX_VERTICES * sizeof(Vertex));
+	renderer.queue_vertices.capacity = BATCH_MAX_VERTICES;
+
+	if (window.software_renderer) {
+		sw_init(window.game_width, window.game_height);
+	} else {
+		init_gl_resources();
+	}
+
+	init_texture_array();
+
+	// stub texture. Goes into the texture array, so untextured stuff batches with sprites.
+	u32 pixel_data[1] = {0xffffffff};
+	renderer.stub_texture = create_texture(pixel_data, 1, 1);
+}
+
+static void init_gl_resources() {
 	// 
 	// Initialize.
 	// 
@@ -125,9 +193,39 @@ void init_renderer() {
 		// 1. bind Vertex Array Object
 		glBindVertexArray(renderer.batch_vao);
 
-		// 2. copy our vertices array in a vertex buffer for OpenGL to use
+		// 2. allocate the streaming vertex buffer
 		glBindBuffer(GL_ARRAY_BUFFER, renderer.batch_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * BATCH_MAX_VERTICES, nullptr, GL_DYNAMIC_DRAW);
+		{
+			size_t size = sizeof(Vertex) * BATCH_MAX_VERTICES * BATCH_RING_SEGMENTS;
+
+			bool persistent = SDL_GL_ExtensionSupported("GL_ARB_buffer_storage");
+
+			char* env_no_persistent = SDL_getenv("NO_PERSISTENT_MAPPING"); // @Leak
+			if (env_no_persistent) {
+				persistent = (SDL_atoi(env_no_persistent) == 0);
+			}
+
+			if (persistent) {
+				_glBufferStorage = (PFN_glBufferStorage) SDL_GL_GetProcAddress("glBufferStorage");
+				persistent = (_glBufferStorage != nullptr);
+			}
+
+			if (persistent) {
+				GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+				_glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+				renderer.vbo_mapped = (Vertex*) glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+			}
+
+			if (renderer.vbo_mapped) {
+				log_info("Batch renderer: using a persistently mapped vertex buffer.");
+			} else {
+				log_info("Batch renderer: using buffer orphaning.");
+				glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+			}
+
+			renderer.vbo_segment = BATCH_RING_SEGMENTS - 1; // render_begin_frame advances to 0
+			renderer.vbo_cursor  = renderer.vbo_segment * BATCH_MAX_VERTICES;
+		}
 
 		u32* indices = (u32*) malloc(BATCH_MAX_INDICES * sizeof(u32));
 		defer { free(indices); };
@@ -153,18 +251,6 @@ void init_renderer() {
 		set_vertex_attribs();
 
 		glBindVertexArray(0);
-
-		renderer.batch_vertices.data = (Vertex*) malloc(BATCH_MAX_VERTICES * sizeof(Vertex));
-		renderer.batch_vertices.capacity = BATCH_MAX_VERTICES;
-
-		// stub texture
-		glGenTextures(1, &renderer.stub_texture);
-		glBindTexture(GL_TEXTURE_2D, renderer.stub_texture);
-
-		u32 pixel_data[1] = {0xffffffff};
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel_data);
-
-		glBindTexture(GL_TEXTURE_2D, 0);
 	}
 
 	// 
@@ -183,6 +269,15 @@ void init_renderer() {
 		renderer.texture_shader = link_program(texture_vert_shader, texture_frag_shader);
 		renderer.sharp_bilinear_shader = link_program(texture_vert_shader, sharp_bilinear_frag_shader);
 
+		// Samplers always read from the same texture units.
+		Shader shaders[] = {renderer.texture_shader, renderer.sharp_bilinear_shader};
+		for (Shader shader : shaders) {
+			glUseProgram(shader.ID);
+			glUniform1i(shader.u_Texture, 0);
+			glUniform1i(shader.u_TextureArray, 1);
+		}
+		glUseProgram(0);
+
 		renderer.current_shader = renderer.texture_shader;
 	}
 
@@ -214,17 +309,125 @@ void init_renderer() {
 }
 
 void deinit_renderer() {
+	deinit_texture_array();
+
+	if (window.software_renderer) {
+		sw_deinit();
+	} else {
+		for (size_t i = 0; i < BATCH_RING_SEGMENTS; i++) {
+			if (renderer.segment_fences[i]) glDeleteSync(renderer.segment_fences[i]);
+		}
+
+		if (renderer.vbo_mapped) {
+			glBindBuffer(GL_ARRAY_BUFFER, renderer.batch_vbo);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+	}
+
 	free(renderer.batch_vertices.data);
+	free(renderer.queue.data);
+	free(renderer.queue_temp);
+	free(renderer.queue_vertices.data);
+}
+
+static void use_shader(Shader shader) {
+	if (renderer.bound_program != shader.ID) {
+		glUseProgram(shader.ID);
+		renderer.bound_program = shader.ID;
+	}
+}
+
+// Moves the write cursor to the start of the next ring segment.
+// Assumes the vbo is bound.
+static void advance_vbo_segment() {
+	if (renderer.vbo_mapped) {
+		// Everything that reads from the current segment has been submitted by now.
+		size_t curr = renderer.vbo_segment;
+		if (renderer.segment_fences[curr]) glDeleteSync(renderer.segment_fences[curr]);
+		renderer.segment_fences[curr] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	renderer.vbo_segment = (renderer.vbo_segment + 1) % BATCH_RING_SEGMENTS;
+	renderer.vbo_cursor  = renderer.vbo_segment * BATCH_MAX_VERTICES;
+
+	if (renderer.vbo_mapped) {
+		// Wait until the GPU is done with the segment we're about to overwrite.
+		// Normally it's been done for a couple frames already and this returns immediately.
+		if (GLsync fence = renderer.segment_fences[renderer.vbo_segment]) {
+			while (true) {
+				GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+				if (status != GL_TIMEOUT_EXPIRED) break;
+			}
+
+			glDeleteSync(fence);
+			renderer.segment_fences[renderer.vbo_segment] = nullptr;
+		}
+	} else if (renderer.vbo_segment == 0) {
+		// Wrapped around. Orphan the buffer: the driver hands us fresh storage
+		// instead of stalling until the GPU is done with the old one.
+		size_t size = sizeof(Vertex) * BATCH_MAX_VERTICES * BATCH_RING_SEGMENTS;
+		glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	}
+}
+
+// Copies the vertices into the ring buffer. Returns the index of the first vertex.
+static size_t upload_vertices(const Vertex* vertices, size_t count) {
+	Assert(count <= BATCH_MAX_VERTICES);
+
+	glBindBuffer(GL_ARRAY_BUFFER, renderer.batch_vbo);
+	defer { glBindBuffer(GL_ARRAY_BUFFER, 0); };
+
+	// A batch never straddles two segments.
+	size_t segment_end = (renderer.vbo_segment + 1) * BATCH_MAX_VERTICES;
+	if (renderer.vbo_cursor + count > segment_end) {
+		advance_vbo_segment();
+	}
+
+	size_t first = renderer.vbo_cursor;
+
+	if (renderer.vbo_mapped) {
+		memcpy(renderer.vbo_mapped + first, vertices, count * sizeof(Vertex));
+	} else {
+		// Unsynchronized is fine: this range hasn't been used since the buffer was last orphaned.
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+		void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, first * sizeof(Vertex), count * sizeof(Vertex), flags);
+		Assert(ptr);
+		memcpy(ptr, vertices, count * sizeof(Vertex));
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+
+	renderer.vbo_cursor += count;
+
+	return first;
 }
 
 void render_begin_frame(vec4 clear_color) {
-	Assert(renderer.batch_vertices.count == 0);
+	Assert(renderer.queue.count == 0);
+
+	renderer.layer = 0;
+	renderer.view_rect = {};
 
 	renderer.draw_calls = renderer.curr_draw_calls;
 	renderer.max_batch  = renderer.curr_max_batch;
+	renderer.culled     = renderer.curr_culled;
+	renderer.submitted  = renderer.curr_submitted;
 
 	renderer.curr_draw_calls = 0;
 	renderer.curr_max_batch  = 0;
+	renderer.curr_culled     = 0;
+	renderer.curr_submitted  = 0;
+
+	if (window.software_renderer) {
+		sw_clear(clear_color);
+		return;
+	}
+
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, renderer.batch_vbo);
+		advance_vbo_segment();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, renderer.game_framebuffer);
 
@@ -237,6 +440,11 @@ void render_begin_frame(vec4 clear_color) {
 void render_end_frame() {
 	break_batch();
 
+	if (window.software_renderer) {
+		sw_end_frame(window.handle);
+		return;
+	}
+
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	int backbuffer_width;
@@ -247,16 +455,17 @@ void render_end_frame() {
 	renderer.proj_mat = glm::ortho(0.0f, (float)backbuffer_width, (float)backbuffer_height, 0.0f);
 	renderer.view_mat = {1};
 	renderer.model_mat = {1};
+	renderer.view_rect = {};
 
 	glClearColor(0, 0, 0, 1);
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	{
-		u32 program    = renderer.sharp_bilinear_shader;
-		u32 old_shader = renderer.current_shader;
+		Shader program    = renderer.sharp_bilinear_shader;
+		Shader old_shader = renderer.current_shader;
 
 		renderer.current_shader = program;
-		glUseProgram(program);
+		use_shader(program);
 
 		float xscale = backbuffer_width  / (float)window.game_width;
 		float yscale = backbuffer_height / (float)window.game_height;
@@ -267,16 +476,11 @@ void render_end_frame() {
 		int x = (backbuffer_width  - w) / 2;
 		int y = (backbuffer_height - h) / 2;
 
-		{
-			int u_SourceSize = glGetUniformLocation(program, "u_SourceSize");
-			glUniform2f(u_SourceSize, (float)window.game_width, (float)window.game_height);
-		}
+		glUniform2f(program.u_SourceSize, (float)window.game_width, (float)window.game_height);
 
 		{
 			float int_scale = max(floorf(scale), 1.0f);
-
-			int u_Scale = glGetUniformLocation(program, "u_Scale");
-			glUniform2f(u_Scale, int_scale, int_scale);
+			glUniform2f(program.u_Scale, int_scale, int_scale);
 		}
 
 		Texture t;
@@ -291,7 +495,55 @@ void render_end_frame() {
 	}
 }
 
-void break_batch() {
+static void draw_batch_gl() {
+	size_t first = upload_vertices(renderer.batch_vertices.data, renderer.batch_vertices.count);
+
+	Shader program = {};
+	for (int i = 0; i < renderer.shader_count; i++) {
+		if (renderer.shaders[i].ID == renderer.batch_program) {
+			program = renderer.shaders[i];
+			break;
+		}
+	}
+	Assert(program.ID != 0);
+
+	use_shader(program);
+
+	mat4 MVP = (renderer.proj_mat * renderer.view_mat) * renderer.model_mat;
+	glUniformMatrix4fv(program.u_MVP, 1, GL_FALSE, &MVP[0][0]);
+
+	// The texture array always sits on unit 1, standalone textures go on unit 0.
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array.ID);
+	glActiveTexture(GL_TEXTURE0);
+	if (renderer.current_texture != texture_array.ID) {
+		glBindTexture(GL_TEXTURE_2D, renderer.current_texture);
+	}
+	defer { glBindTexture(GL_TEXTURE_2D, 0); };
+
+	glBindVertexArray(renderer.batch_vao);
+	defer { glBindVertexArray(0); };
+
+	switch (renderer.current_mode) {
+		case MODE_QUADS: {
+			Assert(renderer.batch_vertices.count % 4 == 0);
+
+			// The index buffer always starts at vertex 0, so offset it with base vertex.
+			glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)renderer.batch_vertices.count / 4 * 6, GL_UNSIGNED_INT, 0, (GLint)first);
+			break;
+		}
+
+		case MODE_TRIANGLES: {
+			Assert(renderer.batch_vertices.count % 3 == 0);
+
+			glDrawArrays(GL_TRIANGLES, (GLint)first, (GLsizei)renderer.batch_vertices.count);
+			break;
+		}
+	}
+}
+
+// Makes the draw call for renderer.batch_vertices.
+static void flush_batch() {
 	if (renderer.batch_vertices.count == 0) {
 		return;
 	}
@@ -299,69 +551,192 @@ void break_batch() {
 	Assert(renderer.current_mode != MODE_NONE);
 	Assert(renderer.current_texture != 0);
 
-	{
-		glBindBuffer(GL_ARRAY_BUFFER, renderer.batch_vbo);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, renderer.batch_vertices.count * sizeof(Vertex), renderer.batch_vertices.data);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (window.software_renderer) {
+		mat4 MVP = (renderer.proj_mat * renderer.view_mat) * renderer.model_mat;
+
+		if (renderer.current_mode == MODE_QUADS) {
+			sw_draw_quads(renderer.batch_vertices.data, renderer.batch_vertices.count, MVP, renderer.current_texture);
+		} else {
+			sw_draw_triangles(renderer.batch_vertices.data, renderer.batch_vertices.count, MVP, renderer.current_texture);
+		}
+	} else {
+		draw_batch_gl();
 	}
 
-	switch (renderer.current_mode) {
-		case MODE_QUADS: {
-			u32 program = renderer.current_shader;
+	renderer.curr_draw_calls++;
+	renderer.curr_max_batch = max(renderer.curr_max_batch, renderer.batch_vertices.count);
 
-			glUseProgram(program);
-			defer { glUseProgram(0); };
+	renderer.batch_vertices.count = 0;
+	renderer.current_texture = 0;
+	renderer.current_mode = MODE_NONE;
+	renderer.batch_program = 0;
+}
 
-			mat4 MVP = (renderer.proj_mat * renderer.view_mat) * renderer.model_mat;
+constexpr u64 KEY_LAYER_SHIFT   = 48;
+constexpr u64 KEY_SHADER_SHIFT  = 40;
+constexpr u64 KEY_TEXTURE_SHIFT = 8;
 
-			int u_MVP = glGetUniformLocation(program, "u_MVP");
-			glUniformMatrix4fv(u_MVP, 1, GL_FALSE, &MVP[0][0]);
+static u64 make_sort_key(int layer, int shader_index, u32 texture, RenderMode mode) {
+	Assert(layer >= INT16_MIN && layer <= INT16_MAX);
+	Assert(shader_index >= 0 && shader_index < 256);
 
-			glBindTexture(GL_TEXTURE_2D, renderer.current_texture);
-			defer { glBindTexture(GL_TEXTURE_2D, 0); };
+	u64 key = 0;
+	key |= (u64)(u16)(layer + 0x8000) << KEY_LAYER_SHIFT; // Biased, so negative layers sort first
+	key |= (u64)shader_index          << KEY_SHADER_SHIFT;
+	key |= (u64)texture               << KEY_TEXTURE_SHIFT;
+	key |= (u64)mode;
+	return key;
+}
 
-			glBindVertexArray(renderer.batch_vao);
-			defer { glBindVertexArray(0); };
+static int get_shader_index(Shader shader) {
+	for (int i = 0; i < renderer.shader_count; i++) {
+		if (renderer.shaders[i].ID == shader.ID) {
+			return i;
+		}
+	}
 
-			Assert(renderer.batch_vertices.count % 4 == 0);
+	Assert(renderer.shader_count < (int)MAX_SHADERS);
 
-			glDrawElements(GL_TRIANGLES, (GLsizei)renderer.batch_vertices.count / 4 * 6, GL_UNSIGNED_INT, 0);
-			renderer.curr_draw_calls++;
-			renderer.curr_max_batch = max(renderer.curr_max_batch, renderer.batch_vertices.count);
-			break;
+	renderer.shaders[renderer.shader_count] = shader;
+	return renderer.shader_count++;
+}
+
+// LSD radix sort, one byte at a time. Stable, so commands with equal keys stay in submission order.
+static void sort_queue() {
+	Draw_Command* src = renderer.queue.data;
+	Draw_Command* dst = renderer.queue_temp;
+	size_t count = renderer.queue.count;
+
+	if (count < 2) {
+		return;
+	}
+
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t offsets[256] = {};
+
+		for (size_t i = 0; i < count; i++) {
+			offsets[(src[i].key >> shift) & 0xff]++;
 		}
 
-		case MODE_TRIANGLES: {
-			u32 program = renderer.current_shader;
+		// Every key has the same byte here, nothing to do.
+		if (offsets[(src[0].key >> shift) & 0xff] == count) {
+			continue;
+		}
 
-			glUseProgram(program);
-			defer { glUseProgram(0); };
+		size_t total = 0;
+		for (size_t i = 0; i < 256; i++) {
+			size_t c = offsets[i];
+			offsets[i] = total;
+			total += c;
+		}
 
-			mat4 MVP = (renderer.proj_mat * renderer.view_mat) * renderer.model_mat;
+		for (size_t i = 0; i < count; i++) {
+			dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
+		}
 
-			int u_MVP = glGetUniformLocation(program, "u_MVP");
-			glUniformMatrix4fv(u_MVP, 1, GL_FALSE, &MVP[0][0]);
+		Draw_Command* temp = src;
+		src = dst;
+		dst = temp;
+	}
 
-			glBindTexture(GL_TEXTURE_2D, renderer.current_texture);
-			defer { glBindTexture(GL_TEXTURE_2D, 0); };
+	if (src != renderer.queue.data) {
+		memcpy(renderer.queue.data, src, count * sizeof(Draw_Command));
+	}
+}
 
-			glBindVertexArray(renderer.batch_vao);
-			defer { glBindVertexArray(0); };
+void break_batch() {
+	if (renderer.queue.count == 0) {
+		return;
+	}
 
-			Assert(renderer.batch_vertices.count % 3 == 0);
+	sort_queue();
 
-			glDrawArrays(GL_TRIANGLES, 0, (GLsizei)renderer.batch_vertices.count);
-			renderer.curr_draw_calls++;
-			renderer.curr_max_batch = max(renderer.curr_max_batch, renderer.batch_vertices.count);
-			break;
+	for (const Draw_Command& cmd : renderer.queue) {
+		u32 texture  = (u32)((cmd.key >> KEY_TEXTURE_SHIFT) & 0xffff'ffff);
+		RenderMode mode = (RenderMode)(cmd.key & 0xff);
+		u32 program  = renderer.shaders[(cmd.key >> KEY_SHADER_SHIFT) & 0xff].ID;
+
+		// Commands that only differ by layer can still go in the same draw call.
+		if (texture != renderer.current_texture || mode != renderer.current_mode || program != renderer.batch_program
+			|| renderer.batch_vertices.count + cmd.vertex_count > renderer.batch_vertices.capacity) {
+			flush_batch();
+
+			renderer.current_texture = texture;
+			renderer.current_mode = mode;
+			renderer.batch_program = program;
 		}
+
+		memcpy(renderer.batch_vertices.data + renderer.batch_vertices.count,
+			   renderer.queue_vertices.data + cmd.first_vertex,
+			   cmd.vertex_count * sizeof(Vertex));
+		renderer.batch_vertices.count += cmd.vertex_count;
 	}
 
-	renderer.batch_vertices.count = 0;
-	renderer.current_texture = 0;
-	renderer.current_mode = MODE_NONE;
+	flush_batch();
+
+	renderer.queue.count = 0;
+	renderer.queue_vertices.count = 0;
 }
 
+// Records a draw. Returns where to write the vertices.
+static Vertex* push_command(u32 texture, RenderMode mode, size_t vertex_count) {
+	// If the queue is full, draw what we have. Layer order only holds within one flush.
+	if (renderer.queue.count == renderer.queue.capacity
+		|| renderer.queue_vertices.count + vertex_count > renderer.queue_vertices.capacity) {
+		break_batch();
+	}
+
+	int shader_index = get_shader_index(renderer.current_shader);
+	u64 key = make_sort_key(renderer.layer, shader_index, texture, mode);
+
+	// Consecutive draws with the same key are merged into one command, which keeps the sort short.
+	if (renderer.queue.count > 0) {
+		Draw_Command* last = &renderer.queue.data[renderer.queue.count - 1];
+		if (last->key == key && last->first_vertex + last->vertex_count == renderer.queue_vertices.count) {
+			last->vertex_count += (u32)vertex_count;
+
+			Vertex* result = renderer.queue_vertices.data + renderer.queue_vertices.count;
+			renderer.queue_vertices.count += vertex_count;
+			return result;
+		}
+	}
+
+	Draw_Command cmd;
+	cmd.key = key;
+	cmd.first_vertex = (u32)renderer.queue_vertices.count;
+	cmd.vertex_count = (u32)vertex_count;
+	array_add(&renderer.queue, cmd);
+
+	Vertex* result = renderer.queue_vertices.data + renderer.queue_vertices.count;
+	renderer.queue_vertices.count += vertex_count;
+	return result;
+}
+
+void set_view_rect(Rectf view) {
+	break_batch();
+
+	renderer.proj_mat = glm::ortho<float>(0, view.w, view.h, 0);
+	renderer.view_mat = glm::translate(mat4{1}, vec3{-view.x, -view.y, 0});
+	renderer.view_rect = view;
+}
+
+// Returns true if a circle is completely outside of the view. Counts culled and submitted draws.
+static bool cull_circle(vec2 center, float radius) {
+	Rectf v = renderer.view_rect;
+
+	if (v.w != 0) {
+		if (center.x + radius < v.x
+			|| center.y + radius < v.y
+			|| center.x - radius > v.x + v.w
+			|| center.y - radius > v.y + v.h) {
+			renderer.curr_culled++;
+			return true;
+		}
+	}
+
+	renderer.curr_submitted++;
+	return false;
+}
 
 void draw_texture(Texture t, Rect src,
 				  vec2 pos, vec2 scale,
@@ -371,23 +746,41 @@ void draw_texture(Texture t, Rect src,
 		src.h = t.height;
 	}
 
-	if (t.ID != renderer.current_texture || renderer.current_mode != MODE_QUADS) {
-		break_batch();
-
-		renderer.current_texture = t.ID;
-		renderer.current_mode = MODE_QUADS;
-	}
-
 	{
 		float x1 = -origin.x;
 		float y1 = -origin.y;
 		float x2 = src.w - origin.x;
 		float y2 = src.h - origin.y;
 
-		float u1 =  src.x          / (float)t.width;
-		float v1 =  src.y          / (float)t.height;
-		float u2 = (src.x + src.w) / (float)t.width;
-		float v2 = (src.y + src.h) / (float)t.height;
+		// The quad rotates around pos, so the farthest corner gives a bounding circle for any angle.
+		{
+			float far_x = max(fabsf(x1), fabsf(x2)) * fabsf(scale.x);
+			float far_y = max(fabsf(y1), fabsf(y2)) * fabsf(scale.y);
+
+			if (cull_circle(pos, sqrtf(far_x * far_x + far_y * far_y))) {
+				return;
+			}
+		}
+
+		float u1;
+		float v1;
+		float u2;
+		float v2;
+		float layer;
+
+		if (t.layer >= 0) {
+			u1 = (t.x + src.x)         / (float)TEXTURE_ARRAY_SIZE;
+			v1 = (t.y + src.y)         / (float)TEXTURE_ARRAY_SIZE;
+			u2 = (t.x + src.x + src.w) / (float)TEXTURE_ARRAY_SIZE;
+			v2 = (t.y + src.y + src.h) / (float)TEXTURE_ARRAY_SIZE;
+			layer = (float)t.layer;
+		} else {
+			u1 =  src.x          / (float)t.width;
+			v1 =  src.y          / (float)t.height;
+			u2 = (src.x + src.w) / (float)t.width;
+			v2 = (src.y + src.h) / (float)t.height;
+			layer = -1.0f;
+		}
 
 		if (flip.x) {
 			float temp = u1;
@@ -402,10 +795,10 @@ void draw_texture(Texture t, Rect src,
 		}
 
 		Vertex vertices[] = {
-			{{x1, y1, 0.0f}, {}, color, {u1, v1}},
-			{{x2, y1, 0.0f}, {}, color, {u2, v1}},
-			{{x2, y2, 0.0f}, {}, color, {u2, v2}},
-			{{x1, y2, 0.0f}, {}, color, {u1, v2}},
+			{{x1, y1, 0.0f}, {}, color, {u1, v1, layer}},
+			{{x2, y1, 0.0f}, {}, color, {u2, v1, layer}},
+			{{x2, y2, 0.0f}, {}, color, {u2, v2, layer}},
+			{{x1, y2, 0.0f}, {}, color, {u1, v2, layer}},
 		};
 
 		// Has to be in this order (learned it the hard way)
@@ -418,10 +811,8 @@ void draw_texture(Texture t, Rect src,
 		vertices[2].pos = model * vec4{vertices[2].pos, 1.0f};
 		vertices[3].pos = model * vec4{vertices[3].pos, 1.0f};
 
-		array_add(&renderer.batch_vertices, vertices[0]);
-		array_add(&renderer.batch_vertices, vertices[1]);
-		array_add(&renderer.batch_vertices, vertices[2]);
-		array_add(&renderer.batch_vertices, vertices[3]);
+		Vertex* dest = push_command(t.ID, MODE_QUADS, 4);
+		memcpy(dest, vertices, sizeof(vertices));
 	}
 }
 
@@ -433,7 +824,7 @@ void draw_texture_centered(Texture t,
 }
 
 void draw_rectangle(Rectf rect, vec4 color) {
-	Texture t = {renderer.stub_texture, 1, 1};
+	Texture t = renderer.stub_texture;
 	vec2 pos = {rect.x, rect.y};
 	vec2 scale = {rect.w, rect.h};
 	draw_texture(t, {}, pos, scale, {}, 0, color);
@@ -441,7 +832,7 @@ void draw_rectangle(Rectf rect, vec4 color) {
 
 void draw_rectangle(Rectf rect, vec2 scale,
 					vec2 origin, float angle, vec4 color) {
-	Texture t = {renderer.stub_texture, 1, 1};
+	Texture t = renderer.stub_texture;
 	vec2 pos = {rect.x, rect.y};
 
 	origin.x /= rect.w;
@@ -454,32 +845,70 @@ void draw_rectangle(Rectf rect, vec2 scale,
 }
 
 void draw_triangle(vec2 p1, vec2 p2, vec2 p3, vec4 color) {
-	if (renderer.current_texture != renderer.stub_texture || renderer.current_mode != MODE_TRIANGLES) {
-		break_batch();
-
-		renderer.current_texture = renderer.stub_texture;
-		renderer.current_mode = MODE_TRIANGLES;
-	}
-
 	{
+		// Sample the middle of the stub texel.
+		Texture t = renderer.stub_texture;
+		vec3 uv;
+		if (t.layer >= 0) {
+			uv = {(t.x + 0.5f) / (float)TEXTURE_ARRAY_SIZE, (t.y + 0.5f) / (float)TEXTURE_ARRAY_SIZE, (float)t.layer};
+		} else {
+			uv = {0.5f, 0.5f, -1.0f};
+		}
+
 		Vertex vertices[] = {
-			{{p1.x, p1.y, 0.0f}, {}, color, {}},
-			{{p2.x, p2.y, 0.0f}, {}, color, {}},
-			{{p3.x, p3.y, 0.0f}, {}, color, {}},
+			{{p1.x, p1.y, 0.0f}, {}, color, uv},
+			{{p2.x, p2.y, 0.0f}, {}, color, uv},
+			{{p3.x, p3.y, 0.0f}, {}, color, uv},
 		};
 
-		array_add(&renderer.batch_vertices, vertices[0]);
-		array_add(&renderer.batch_vertices, vertices[1]);
-		array_add(&renderer.batch_vertices, vertices[2]);
+		Vertex* dest = push_command(t.ID, MODE_TRIANGLES, 3);
+		memcpy(dest, vertices, sizeof(vertices));
 	}
 }
 
-void draw_circle(vec2 pos, float radius, vec4 color, int precision) {
-	for (int i = 0; i < precision; i++) {
-		float angle1 = (float)i       / (float)precision * 2.0f * glm::pi<float>();
-		float angle2 = (float)(i + 1) / (float)precision * 2.0f * glm::pi<float>();
-		vec2 p1 = pos + vec2{cosf(angle1), -sinf(angle1)} * radius;
-		vec2 p2 = pos + vec2{cosf(angle2), -sinf(angle2)} * radius;
-		draw_triangle(p1, p2, pos, color);
+// An axis-aligned quad around "center" with local coordinates in uv, for the SDF shapes.
+// Uses the stub texture, so it goes into the same batch as sprites.
+static void draw_shape(vec2 center, vec2 half_size, vec4 shape, vec4 color) {
+	// One extra unit on each side for the anti-aliased edge.
+	float hw = half_size.x + 1.0f;
+	float hh = half_size.y + 1.0f;
+
+	if (cull_circle(center, sqrtf(hw * hw + hh * hh))) {
+		return;
 	}
+
+	float x1 = center.x - hw;
+	float y1 = center.y - hh;
+	float x2 = center.x + hw;
+	float y2 = center.y + hh;
+
+	Texture t = renderer.stub_texture;
+	float layer = (float)t.layer;
+
+	Vertex vertices[] = {
+		{{x1, y1, 0.0f}, shape, color, {-hw, -hh, layer}},
+		{{x2, y1, 0.0f}, shape, color, { hw, -hh, layer}},
+		{{x2, y2, 0.0f}, shape, color, { hw,  hh, layer}},
+		{{x1, y2, 0.0f}, shape, color, {-hw,  hh, layer}},
+	};
+
+	Vertex* dest = push_command(t.ID, MODE_QUADS, 4);
+	memcpy(dest, vertices, sizeof(vertices));
+}
+
+void draw_circle(vec2 pos, float radius, vec4 color) {
+	draw_shape(pos, {radius, radius}, {SHAPE_CIRCLE, radius, -radius, 0}, color);
+}
+
+void draw_ring(vec2 pos, float radius, float thickness, vec4 color) {
+	draw_shape(pos, {radius, radius}, {SHAPE_CIRCLE, radius, radius - thickness, 0}, color);
+}
+
+void draw_rounded_rectangle(Rectf rect, float corner_radius, vec4 color) {
+	vec2 half_size = {rect.w / 2.0f, rect.h / 2.0f};
+	vec2 center = {rect.x + half_size.x, rect.y + half_size.y};
+
+	corner_radius = clamp(corner_radius, 0.0f, min(half_size.x, half_size.y));
+
+	draw_shape(center, half_size, {SHAPE_ROUNDED_RECT, half_size.x, half_size.y, corner_radius}, color);
 }
@@ -2,11 +2,21 @@
 
 #include "common.h"
 #include "texture.h"
+#include "util.h"
 
 /*
 * A basic 2D batch renderer.
 * 
-* Call break_batch() before making opengl calls or modifying renderer's matrices or renderer's current shader.
+* Draws aren't sent to the GPU right away. They're recorded into a queue with a sort key
+* (layer, shader, texture, mode), and break_batch() sorts the queue and merges neighbouring draws
+* with the same state into one draw call.
+* 
+* Draw order is only guaranteed between layers (renderer.layer) and between draws with the same
+* shader, texture and mode. If things overlap and have to be drawn in a certain order, put them on different layers.
+* 
+* Call break_batch() before making opengl calls or modifying renderer's matrices.
+* 
+* If window.software_renderer is set, batches go to the CPU rasterizer instead (see software_renderer.h).
 */
 
 constexpr size_t BATCH_MAX_QUADS    = 10'000;
@@ -15,11 +25,25 @@ constexpr size_t INDICES_PER_QUAD   = 6;
 constexpr size_t BATCH_MAX_VERTICES = (BATCH_MAX_QUADS * VERTICES_PER_QUAD);
 constexpr size_t BATCH_MAX_INDICES  = (BATCH_MAX_QUADS * INDICES_PER_QUAD);
 
+// The vertex buffer is a ring of segments, each big enough for one full batch.
+// Every frame starts writing into the next segment, so the GPU can still be reading
+// the previous frames' vertices while we write the current one.
+constexpr size_t BATCH_RING_SEGMENTS = 3;
+
+constexpr size_t QUEUE_MAX_COMMANDS = BATCH_MAX_QUADS;
+
+// Shapes drawn with a signed distance function instead of a texture (Vertex.shape.x).
+enum {
+	SHAPE_NONE,
+	SHAPE_CIRCLE,       // shape.y = radius, shape.z = inner radius (negative for a filled circle)
+	SHAPE_ROUNDED_RECT, // shape.y = half width, shape.z = half height, shape.w = corner radius
+};
+
 struct Vertex {
 	vec3 pos;
-	vec3 normal;
+	vec4 shape; // For SDF shapes uv.xy is the position relative to the shape's center.
 	vec4 color;
-	vec2 uv;
+	vec3 uv;    // z is the layer in texture_array, or -1
 };
 
 enum RenderMode {
@@ -28,20 +52,48 @@ enum RenderMode {
 	MODE_TRIANGLES,
 };
 
+// Sort key layout, from most to least significant:
+// 16 bits layer, 8 bits shader, 32 bits texture, 8 bits mode
+struct Draw_Command {
+	u64 key;
+	u32 first_vertex; // Index into queue_vertices
+	u32 vertex_count;
+};
+
+constexpr size_t MAX_SHADERS = 16;
+
 struct Batch_Renderer {
+	int layer;             // Set this before drawing. Reset to 0 every frame.
+	Shader current_shader; // Same. Doesn't require a break_batch() anymore.
+
+	bump_array<Draw_Command> queue;
+	bump_array<Vertex> queue_vertices;
+	Draw_Command* queue_temp; // For sorting
+
+	// The batch being built from the sorted queue.
 	u32 current_texture;
 	RenderMode current_mode;
+	u32 batch_program;
 	bump_array<Vertex> batch_vertices;
 
-	u32 texture_shader;  // These shaders should be handled by an asset system maybe
-	u32 sharp_bilinear_shader;
+	Shader texture_shader;  // These shaders should be handled by an asset system maybe
+	Shader sharp_bilinear_shader;
+
+	Shader shaders[MAX_SHADERS]; // All linked shaders, to get from a sort key back to the uniform locations.
+	int shader_count;
 
-	u32 current_shader;
+	u32 bound_program;  // To skip redundant glUseProgram calls
 
 	u32 batch_vao;
-	u32 batch_vbo;
+	u32 batch_vbo;  // BATCH_RING_SEGMENTS * BATCH_MAX_VERTICES vertices
 	u32 batch_ebo;
-	u32 stub_texture; // 1x1 white texture
+
+	Vertex* vbo_mapped;  // Not null if the vbo is persistently mapped (ARB_buffer_storage)
+	size_t vbo_segment;
+	size_t vbo_cursor;   // In vertices, from the start of the buffer
+	GLsync segment_fences[BATCH_RING_SEGMENTS];  // Only used with persistent mapping
+
+	Texture stub_texture; // 1x1 white texture
 
 	u32 game_texture;      // Game is renderer to a framebuffer, and then the framebuffer is
 	u32 game_framebuffer;  // rendered to the screen.
@@ -50,11 +102,21 @@ struct Batch_Renderer {
 	mat4 view_mat = {1};
 	mat4 model_mat = {1};
 
+	// What the camera sees, in the same units as the positions passed to draw functions.
+	// Sprites and shapes completely outside of it are skipped before generating vertices.
+	// Set by set_view_rect(). Culling is off if w is 0 (reset every frame).
+	// Assumes model_mat is identity.
+	Rectf view_rect;
+
 	int draw_calls;
 	size_t max_batch;
+	int culled;     // Sprites and shapes skipped by culling
+	int submitted;  // Sprites and shapes that made it into the queue
 
 	int curr_draw_calls;  // These values change during the frame, use draw_calls and max_batch for metrics
 	size_t curr_max_batch;
+	int curr_culled;
+	int curr_submitted;
 };
 
 extern Batch_Renderer renderer;
@@ -65,7 +127,10 @@ void deinit_renderer();
 void render_begin_frame(vec4 clear_color);
 void render_end_frame();
 
-void break_batch(); // makes the draw call
+void break_batch(); // sorts the queue and makes the draw calls
+
+// Breaks the batch and sets proj_mat and view_mat to look at "view" (y down), and view_rect for culling.
+void set_view_rect(Rectf view);
 
 void draw_texture(Texture t, Rect src = {},
 				  vec2 pos = {}, vec2 scale = {1, 1},
@@ -82,4 +147,9 @@ void draw_rectangle(Rectf rect, vec2 scale,
 
 void draw_triangle(vec2 p1, vec2 p2, vec2 p3, vec4 color);
 
-void draw_circle(vec2 pos, float radius, vec4 color, int precision = 12);
+// These are one quad each, anti-aliased, and batch together with sprites.
+void draw_circle(vec2 pos, float radius, vec4 color);
+
+void draw_ring(vec2 pos, float radius, float thickness, vec4 color);
+
+void draw_rounded_rectangle(Rectf rect, float corner_radius, vec4 color);
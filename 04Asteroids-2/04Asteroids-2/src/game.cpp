@@ -196,10 +196,9 @@ void Game::draw(float /*delta*/) {
 	float camera_left = camera.pos.x - camera_w / 2.0f;
 	float camera_top  = camera.pos.y - camera_h / 2.0f;
 
-	break_batch();
-	renderer.proj_mat = glm::ortho<float>(0, camera_w, camera_h, 0);
-	renderer.view_mat = glm::translate(mat4{1}, vec3{-camera_left, -camera_top, 0});
+	set_view_rect({camera_left, camera_top, camera_w, camera_h});
 
+	renderer.layer = LAYER_BACKGROUND;
 	{
 		const int size = 32;
 
@@ -222,21 +221,24 @@ void Game::draw(float /*delta*/) {
 		}
 	}
 
+	renderer.layer = LAYER_SHIPS;
 	draw_texture_centered(player_texture, player.pos, {1, 1}, player.dir);
 
-	For (b, p_bullets) {
-		draw_circle(b->pos, 8, color_white);
-	}
-
 	For (e, enemies) {
 		draw_texture_centered(player_texture, e->pos, {1, 1}, e->dir);
 	}
 
+	renderer.layer = LAYER_BULLETS;
+	For (b, p_bullets) {
+		draw_circle(b->pos, 8, color_white);
+	}
+
 	For (b, bullets) {
 		draw_circle(b->pos, 8, color_white);
 	}
 
 	if (show_hitboxes) {
+		renderer.layer = LAYER_HITBOXES;
 		draw_rectangle({camera_left - 1, camera_top - 1, camera_w + 2, camera_h + 2}, {0, 0, 0, 0.5f});
 
 		draw_circle(player.pos, player.radius, color_white);
@@ -247,14 +249,20 @@ void Game::draw(float /*delta*/) {
 	}
 
 	// draw gui
-	break_batch();
-	renderer.proj_mat = glm::ortho<float>(0, GAME_W, GAME_H, 0);
-	renderer.view_mat = {1};
+	set_view_rect({0, 0, GAME_W, GAME_H});
+	renderer.layer = LAYER_UI;
 
 	vec2 text_pos = {};
 
 	if (show_hitboxes) {
 		text_pos = draw_text(ms_gothic, "H - Show Hitboxes\n", text_pos);
+
+		if (!window.vsync) {
+			char buf[100];
+			string str = Sprintf(buf, "Pacing error: %.3fms avg, %.3fms max, %d missed\n",
+								 window.pacing_error_avg * 1000.0, window.pacing_error_max * 1000.0, window.pacing_missed);
+			text_pos = draw_text(ms_gothic, str, text_pos);
+		}
 	}
 	if (frame_advance) {
 		text_pos = draw_text(ms_gothic, "F5 - Next Frame\nF6 - Disable Frame Advance Mode\n", text_pos);
@@ -37,6 +37,15 @@ struct Enemy {
 	int fire_queue;
 };
 
+// Render layers (renderer.layer), back to front.
+enum {
+	LAYER_BACKGROUND,
+	LAYER_SHIPS,
+	LAYER_BULLETS,
+	LAYER_HITBOXES,
+	LAYER_UI,
+};
+
 struct Camera {
 	vec2 pos;
 	float zoom = 1;
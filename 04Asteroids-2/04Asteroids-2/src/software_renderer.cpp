@@ -0,0 +1,723 @@
+#include "software_renderer.h"
+
+#include "batch_renderer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SW_SSE2 1
+#include <emmintrin.h>
+#endif
+
+Software_Renderer sw;
+
+// Everything needed to rasterize a triangle, computed once at submission.
+struct Sw_Triangle {
+	// Edge functions: E(x, y) = a * (x - ox) + b * (y - oy). A pixel is inside if all three are >= 0
+	// (or > 0 for edges that aren't top or left, so shared edges aren't drawn twice).
+	// (ox, oy) is the edge's upper (then leftmost) end, whichever way the edge goes, so the two triangles
+	// that share an edge get exactly opposite values and a pixel on it goes to exactly one of them.
+	float a[3];
+	float b[3];
+	float ox[3];
+	float oy[3];
+	bool top_left[3];
+
+	// Attribute planes: f(x, y) = dx * x + dy * y + c. In order: r g b a u v.
+	float dx[6];
+	float dy[6];
+	float c0[6];
+
+	int min_x;
+	int min_y;
+	int max_x; // Exclusive
+	int max_y;
+
+	const Sw_Texture* texture;
+	int layer;
+
+	vec4 shape;        // See SHAPE_NONE
+	float shape_pixel; // Size of a pixel in shape units
+};
+
+//
+// 4-wide float vectors. SSE2 or plain arrays.
+//
+
+#ifdef SW_SSE2
+
+struct f32x4 { __m128 v; };
+
+static inline f32x4 splat(float f)                        { return {_mm_set1_ps(f)}; }
+static inline f32x4 load4(const float* p)                 { return {_mm_loadu_ps(p)}; }
+static inline void  store4(float* p, f32x4 a)             { _mm_storeu_ps(p, a.v); }
+static inline f32x4 operator+(f32x4 a, f32x4 b)           { return {_mm_add_ps(a.v, b.v)}; }
+static inline f32x4 operator-(f32x4 a, f32x4 b)           { return {_mm_sub_ps(a.v, b.v)}; }
+static inline f32x4 operator*(f32x4 a, f32x4 b)           { return {_mm_mul_ps(a.v, b.v)}; }
+static inline int   mask_ge(f32x4 a, f32x4 b)             { return _mm_movemask_ps(_mm_cmpge_ps(a.v, b.v)); }
+static inline int   mask_gt(f32x4 a, f32x4 b)             { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, b.v)); }
+
+#else
+
+struct f32x4 { float v[4]; };
+
+static inline f32x4 splat(float f)                        { return {{f, f, f, f}}; }
+static inline f32x4 load4(const float* p)                 { return {{p[0], p[1], p[2], p[3]}}; }
+static inline void  store4(float* p, f32x4 a)             { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+static inline f32x4 operator+(f32x4 a, f32x4 b)           { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+static inline f32x4 operator-(f32x4 a, f32x4 b)           { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+static inline f32x4 operator*(f32x4 a, f32x4 b)           { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+static inline int   mask_ge(f32x4 a, f32x4 b)             { int m = 0; for (int i = 0; i < 4; i++) m |= (a.v[i] >= b.v[i]) << i; return m; }
+static inline int   mask_gt(f32x4 a, f32x4 b)             { int m = 0; for (int i = 0; i < 4; i++) m |= (a.v[i] >  b.v[i]) << i; return m; }
+
+#endif
+
+static double get_seconds() {
+	return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
+//
+// Textures
+//
+
+static const Sw_Texture* get_texture(u32 texture) {
+	Assert(texture >= 1 && texture <= SW_MAX_TEXTURES);
+	const Sw_Texture* t = &sw.textures[texture - 1];
+	Assert(t->pixels);
+	return t;
+}
+
+u32 sw_create_texture(const void* pixel_data, int width, int height, int layers, int filter, int wrap) {
+	for (int i = 0; i < SW_MAX_TEXTURES; i++) {
+		Sw_Texture* t = &sw.textures[i];
+		if (t->pixels) continue;
+
+		size_t size = (size_t)width * height * layers * sizeof(u32);
+		t->pixels = (u32*) malloc(size);
+		if (pixel_data) {
+			memcpy(t->pixels, pixel_data, size);
+		} else {
+			memset(t->pixels, 0, size);
+		}
+
+		t->width    = width;
+		t->height   = height;
+		t->layers   = layers;
+		t->bilinear = (filter == GL_LINEAR);
+		t->wrap     = wrap;
+
+		return (u32)(i + 1);
+	}
+
+	panic_and_abort("Software renderer: too many textures.");
+}
+
+void sw_texture_sub_image(u32 texture, int x, int y, int layer, int width, int height, const void* pixel_data) {
+	Sw_Texture* t = (Sw_Texture*) get_texture(texture);
+
+	Assert(x >= 0 && x + width  <= t->width);
+	Assert(y >= 0 && y + height <= t->height);
+	Assert(layer >= 0 && layer < t->layers);
+
+	const u32* src = (const u32*) pixel_data;
+	u32* dest = t->pixels + (size_t)layer * t->width * t->height;
+
+	for (int row = 0; row < height; row++) {
+		memcpy(dest + (size_t)(y + row) * t->width + x, src + (size_t)row * width, width * sizeof(u32));
+	}
+}
+
+void sw_delete_texture(u32 texture) {
+	Sw_Texture* t = (Sw_Texture*) get_texture(texture);
+	free(t->pixels);
+	*t = {};
+}
+
+// Returns false for texels outside of a GL_CLAMP_TO_BORDER texture (border color is transparent black).
+static inline bool wrap_coord(int* x, int size, int wrap) {
+	if (*x >= 0 && *x < size) return true;
+
+	switch (wrap) {
+		case GL_REPEAT:        *x = ((*x % size) + size) % size; return true;
+		case GL_CLAMP_TO_EDGE: *x = clamp(*x, 0, size - 1);      return true;
+	}
+
+	return false;
+}
+
+static inline u32 fetch(const Sw_Texture* t, const u32* layer_pixels, int x, int y) {
+	if (!wrap_coord(&x, t->width,  t->wrap)) return 0;
+	if (!wrap_coord(&y, t->height, t->wrap)) return 0;
+
+	return layer_pixels[(size_t)y * t->width + x];
+}
+
+// Same as the SDF part of the texture shader. Returns the coverage in 0..1.
+static inline float shape_coverage(const Sw_Triangle* tri, float x, float y) {
+	float d;
+	if (tri->shape.x == SHAPE_CIRCLE) {
+		float len = sqrtf(x * x + y * y);
+		d = max(len - tri->shape.y, tri->shape.z - len);
+	} else {
+		float qx = fabsf(x) - tri->shape.y + tri->shape.w;
+		float qy = fabsf(y) - tri->shape.z + tri->shape.w;
+		float ox = max(qx, 0.0f);
+		float oy = max(qy, 0.0f);
+		d = sqrtf(ox * ox + oy * oy) + min(max(qx, qy), 0.0f) - tri->shape.w;
+	}
+
+	return clamp(0.5f - d / tri->shape_pixel, 0.0f, 1.0f);
+}
+
+// Returns the color in 0..1.
+static inline void sample(const Sw_Texture* t, int layer, float u, float v, float out[4]) {
+	const u32* layer_pixels = t->pixels + (size_t)layer * t->width * t->height;
+
+	if (!t->bilinear) {
+		u32 p = fetch(t, layer_pixels, (int)floorf(u * t->width), (int)floorf(v * t->height));
+
+		out[0] = ((p >>  0) & 0xff) * (1.0f / 255.0f);
+		out[1] = ((p >>  8) & 0xff) * (1.0f / 255.0f);
+		out[2] = ((p >> 16) & 0xff) * (1.0f / 255.0f);
+		out[3] = ((p >> 24) & 0xff) * (1.0f / 255.0f);
+		return;
+	}
+
+	float fx = u * t->width  - 0.5f;
+	float fy = v * t->height - 0.5f;
+
+	float x0f = floorf(fx);
+	float y0f = floorf(fy);
+
+	float wx = fx - x0f;
+	float wy = fy - y0f;
+
+	int x0 = (int)x0f;
+	int y0 = (int)y0f;
+
+	u32 p[4] = {
+		fetch(t, layer_pixels, x0,     y0),
+		fetch(t, layer_pixels, x0 + 1, y0),
+		fetch(t, layer_pixels, x0,     y0 + 1),
+		fetch(t, layer_pixels, x0 + 1, y0 + 1),
+	};
+
+	float w[4] = {
+		(1.0f - wx) * (1.0f - wy),
+		wx          * (1.0f - wy),
+		(1.0f - wx) * wy,
+		wx          * wy,
+	};
+
+	for (int c = 0; c < 4; c++) {
+		float sum = 0;
+		for (int i = 0; i < 4; i++) {
+			sum += ((p[i] >> (c * 8)) & 0xff) * w[i];
+		}
+		out[c] = sum * (1.0f / 255.0f);
+	}
+}
+
+//
+// Rasterization
+//
+
+static void raster_triangle(const Sw_Triangle* tri, int tile_x, int tile_y) {
+	int x0 = max(tri->min_x, tile_x);
+	int y0 = max(tri->min_y, tile_y);
+	int x1 = min(tri->max_x, min(tile_x + SW_TILE_SIZE, sw.width));
+	int y1 = min(tri->max_y, min(tile_y + SW_TILE_SIZE, sw.height));
+
+	if (x0 >= x1 || y0 >= y1) return;
+
+	static const float offsets[4] = {0.5f, 1.5f, 2.5f, 3.5f}; // Pixel centers
+
+	const f32x4 lane_offsets = load4(offsets);
+	const f32x4 zero = splat(0);
+	const f32x4 one  = splat(1);
+	const f32x4 full = splat(255);
+
+	for (int y = y0; y < y1; y++) {
+		float py = y + 0.5f;
+		u32* row = sw.framebuffer + (size_t)y * sw.pitch;
+
+		// Find the span of this row that's inside the triangle, so we don't walk the whole bounding box.
+		// It's padded by a pixel, the exact test is done per pixel below.
+		float span_min = (float)x0;
+		float span_max = (float)x1;
+		for (int e = 0; e < 3; e++) {
+			float row_c = tri->b[e] * (py - tri->oy[e]) - tri->a[e] * tri->ox[e];
+			if (tri->a[e] > 0) {
+				span_min = max(span_min, -row_c / tri->a[e] - 1.0f);
+			} else if (tri->a[e] < 0) {
+				span_max = min(span_max, -row_c / tri->a[e] + 1.0f);
+			} else if (row_c < 0) {
+				span_max = span_min;
+			}
+		}
+
+		if (span_min >= span_max) continue;
+
+		int row_x0 = (int)span_min;
+		int row_x1 = min((int)ceilf(span_max), x1);
+
+		// Groups of 4 pixels are aligned to 4. Tiles are too, so a group never crosses into another thread's tile.
+		row_x0 &= ~3;
+
+		for (int x = row_x0; x < row_x1; x += 4) {
+			f32x4 px = splat((float)x) + lane_offsets;
+			f32x4 pyv = splat(py);
+
+			int mask = 0xf;
+
+			// Lanes past the end of the span.
+			if (x + 4 > row_x1) mask &= (1 << (row_x1 - x)) - 1;
+
+			for (int e = 0; e < 3; e++) {
+				f32x4 E = splat(tri->a[e]) * (px - splat(tri->ox[e])) + splat(tri->b[e]) * (pyv - splat(tri->oy[e]));
+				mask &= tri->top_left[e] ? mask_ge(E, zero) : mask_gt(E, zero);
+			}
+
+			if (mask == 0) continue;
+
+			f32x4 attr[6];
+			for (int i = 0; i < 6; i++) {
+				attr[i] = splat(tri->dx[i]) * px + splat(tri->dy[i]) * pyv + splat(tri->c0[i]);
+			}
+
+			// Texture fetches are scalar.
+			float u[4];
+			float v[4];
+			store4(u, attr[4]);
+			store4(v, attr[5]);
+
+			alignas(16) float texel[4][4] = {}; // [channel][lane]
+			alignas(16) float dest[3][4]  = {};
+
+			for (int lane = 0; lane < 4; lane++) {
+				if (!(mask & (1 << lane))) continue;
+
+				float c[4];
+				if (tri->shape.x != SHAPE_NONE) {
+					c[0] = c[1] = c[2] = 1.0f;
+					c[3] = shape_coverage(tri, u[lane], v[lane]);
+				} else {
+					sample(tri->texture, tri->layer, u[lane], v[lane], c);
+				}
+
+				texel[0][lane] = c[0];
+				texel[1][lane] = c[1];
+				texel[2][lane] = c[2];
+				texel[3][lane] = c[3];
+
+				u32 d = row[x + lane];
+				dest[0][lane] = (float)((d >>  0) & 0xff);
+				dest[1][lane] = (float)((d >>  8) & 0xff);
+				dest[2][lane] = (float)((d >> 16) & 0xff);
+			}
+
+			// color = texel * vertex color
+			// dest  = color * color.a + dest * (1 - color.a)
+			f32x4 alpha = load4(texel[3]) * attr[3];
+			f32x4 inv_alpha = one - alpha;
+
+			float result[3][4];
+			for (int ch = 0; ch < 3; ch++) {
+				f32x4 src = load4(texel[ch]) * attr[ch] * full;
+				store4(result[ch], src * alpha + load4(dest[ch]) * inv_alpha);
+			}
+
+			for (int lane = 0; lane < 4; lane++) {
+				if (!(mask & (1 << lane))) continue;
+
+				u32 r = (u32) clamp(result[0][lane] + 0.5f, 0.0f, 255.0f);
+				u32 g = (u32) clamp(result[1][lane] + 0.5f, 0.0f, 255.0f);
+				u32 b = (u32) clamp(result[2][lane] + 0.5f, 0.0f, 255.0f);
+
+				// The GL backend renders into an RGB8 texture, so alpha is always 1.
+				row[x + lane] = r | (g << 8) | (b << 16) | 0xff000000;
+			}
+		}
+	}
+}
+
+static void raster_tile(int tile_index) {
+	const Sw_Tile* tile = &sw.tiles[tile_index];
+
+	int tile_x = (tile_index % sw.tiles_x) * SW_TILE_SIZE;
+	int tile_y = (tile_index / sw.tiles_x) * SW_TILE_SIZE;
+
+	for (size_t i = 0; i < tile->count; i++) {
+		raster_triangle(&sw.triangles[tile->triangles[i]], tile_x, tile_y);
+	}
+}
+
+static void process_tiles() {
+	int tile_count = sw.tiles_x * sw.tiles_y;
+
+	while (true) {
+		int i = SDL_AtomicAdd(&sw.next_tile, 1);
+		if (i >= tile_count) break;
+
+		if (sw.tiles[i].count > 0) {
+			raster_tile(i);
+		}
+	}
+}
+
+static int worker_proc(void* /*userdata*/) {
+	while (true) {
+		SDL_SemWait(sw.work_start);
+
+		if (sw.quit) break;
+
+		process_tiles();
+
+		SDL_SemPost(sw.work_done);
+	}
+
+	return 0;
+}
+
+void sw_finish() {
+	if (sw.triangle_count == 0) return;
+
+	double t = get_seconds();
+
+	SDL_AtomicSet(&sw.next_tile, 0);
+
+	for (int i = 0; i < sw.thread_count; i++) SDL_SemPost(sw.work_start);
+
+	process_tiles();
+
+	for (int i = 0; i < sw.thread_count; i++) SDL_SemWait(sw.work_done);
+
+	for (int i = 0; i < sw.tiles_x * sw.tiles_y; i++) {
+		sw.tiles[i].count = 0;
+	}
+
+	sw.total_triangles += sw.triangle_count;
+	sw.triangle_count = 0;
+
+	double elapsed = get_seconds() - t;
+	sw.total_raster_time += elapsed;
+	sw.raster_time_during_submit += elapsed;
+}
+
+//
+// Submission
+//
+
+static void submit_triangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, const mat4& MVP, const Sw_Texture* texture) {
+	vec2 p[3];
+	const Vertex* in[3] = {&v0, &v1, &v2};
+
+	for (int i = 0; i < 3; i++) {
+		vec4 ndc = MVP * vec4{in[i]->pos, 1.0f};
+
+		// Top row first, same as what ends up on the screen with the GL backend.
+		p[i].x = (ndc.x * 0.5f + 0.5f) * sw.width;
+		p[i].y = (0.5f - ndc.y * 0.5f) * sw.height;
+	}
+
+	float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+
+	if (fabsf(area) < 1e-6f) return;
+
+	// No culling, just make the winding consistent.
+	if (area < 0) {
+		vec2 temp_p = p[1];
+		p[1] = p[2];
+		p[2] = temp_p;
+
+		const Vertex* temp_v = in[1];
+		in[1] = in[2];
+		in[2] = temp_v;
+
+		area = -area;
+	}
+
+	int min_x = max((int)floorf(min(p[0].x, min(p[1].x, p[2].x))), 0);
+	int min_y = max((int)floorf(min(p[0].y, min(p[1].y, p[2].y))), 0);
+	int max_x = min((int)ceilf (max(p[0].x, max(p[1].x, p[2].x))), sw.width);
+	int max_y = min((int)ceilf (max(p[0].y, max(p[1].y, p[2].y))), sw.height);
+
+	if (min_x >= max_x || min_y >= max_y) return;
+
+	int tx0 = min_x / SW_TILE_SIZE;
+	int ty0 = min_y / SW_TILE_SIZE;
+	int tx1 = (max_x - 1) / SW_TILE_SIZE;
+	int ty1 = (max_y - 1) / SW_TILE_SIZE;
+
+	// Out of space? Rasterize what we have.
+	{
+		bool full = (sw.triangle_count == SW_MAX_TRIANGLES);
+		for (int ty = ty0; ty <= ty1 && !full; ty++) {
+			for (int tx = tx0; tx <= tx1; tx++) {
+				if (sw.tiles[ty * sw.tiles_x + tx].count == SW_TILE_MAX_TRIANGLES) {
+					full = true;
+					break;
+				}
+			}
+		}
+
+		if (full) {
+			sw_finish();
+		}
+	}
+
+	Sw_Triangle* tri = &sw.triangles[sw.triangle_count];
+
+	for (int e = 0; e < 3; e++) {
+		vec2 a = p[e];
+		vec2 b = p[(e + 1) % 3];
+
+		float dx = b.x - a.x;
+		float dy = b.y - a.y;
+
+		tri->a[e] = -dy;
+		tri->b[e] =  dx;
+
+		vec2 o = (a.y < b.y || (a.y == b.y && a.x < b.x)) ? a : b;
+		tri->ox[e] = o.x;
+		tri->oy[e] = o.y;
+
+		// Y goes down and the winding is clockwise on the screen.
+		tri->top_left[e] = (dy == 0 && dx > 0) || (dy < 0);
+	}
+
+	float attr[3][6];
+	for (int i = 0; i < 3; i++) {
+		attr[i][0] = in[i]->color.r;
+		attr[i][1] = in[i]->color.g;
+		attr[i][2] = in[i]->color.b;
+		attr[i][3] = in[i]->color.a;
+		attr[i][4] = in[i]->uv.x;
+		attr[i][5] = in[i]->uv.y;
+	}
+
+	float inv_area = 1.0f / area;
+	float x10 = p[1].x - p[0].x;
+	float y10 = p[1].y - p[0].y;
+	float x20 = p[2].x - p[0].x;
+	float y20 = p[2].y - p[0].y;
+
+	for (int i = 0; i < 6; i++) {
+		float f10 = attr[1][i] - attr[0][i];
+		float f20 = attr[2][i] - attr[0][i];
+
+		tri->dx[i] = (f10 * y20 - f20 * y10) * inv_area;
+		tri->dy[i] = (f20 * x10 - f10 * x20) * inv_area;
+		tri->c0[i] = attr[0][i] - tri->dx[i] * p[0].x - tri->dy[i] * p[0].y;
+	}
+
+	tri->min_x = min_x;
+	tri->min_y = min_y;
+	tri->max_x = max_x;
+	tri->max_y = max_y;
+
+	tri->texture = texture;
+	tri->layer   = clamp((int)(in[0]->uv.z + 0.5f), 0, texture->layers - 1); // -1 means a plain texture, same as layer 0
+
+	tri->shape = in[0]->shape;
+	{
+		// uv changes this much per pixel.
+		float along_x = sqrtf(tri->dx[4] * tri->dx[4] + tri->dx[5] * tri->dx[5]);
+		float along_y = sqrtf(tri->dy[4] * tri->dy[4] + tri->dy[5] * tri->dy[5]);
+		tri->shape_pixel = max(max(along_x, along_y), 1e-6f);
+	}
+
+	u32 index = (u32)sw.triangle_count++;
+
+	for (int ty = ty0; ty <= ty1; ty++) {
+		for (int tx = tx0; tx <= tx1; tx++) {
+			Sw_Tile* tile = &sw.tiles[ty * sw.tiles_x + tx];
+			tile->triangles[tile->count++] = index;
+		}
+	}
+}
+
+void sw_draw_quads(const Vertex* vertices, size_t count, const mat4& MVP, u32 texture) {
+	Assert(count % 4 == 0);
+
+	double t = get_seconds();
+	sw.raster_time_during_submit = 0;
+
+	const Sw_Texture* tex = get_texture(texture);
+
+	for (size_t i = 0; i < count; i += 4) {
+		submit_triangle(vertices[i + 0], vertices[i + 1], vertices[i + 2], MVP, tex);
+		submit_triangle(vertices[i + 2], vertices[i + 3], vertices[i + 0], MVP, tex);
+	}
+
+	sw.total_submit_time += get_seconds() - t - sw.raster_time_during_submit; // Don't count early rasterization
+}
+
+void sw_draw_triangles(const Vertex* vertices, size_t count, const mat4& MVP, u32 texture) {
+	Assert(count % 3 == 0);
+
+	double t = get_seconds();
+	sw.raster_time_during_submit = 0;
+
+	const Sw_Texture* tex = get_texture(texture);
+
+	for (size_t i = 0; i < count; i += 3) {
+		submit_triangle(vertices[i + 0], vertices[i + 1], vertices[i + 2], MVP, tex);
+	}
+
+	sw.total_submit_time += get_seconds() - t - sw.raster_time_during_submit; // Don't count early rasterization
+}
+
+void sw_clear(vec4 color) {
+	sw_finish();
+
+	u32 r = (u32) clamp(color.r * 255.0f + 0.5f, 0.0f, 255.0f);
+	u32 g = (u32) clamp(color.g * 255.0f + 0.5f, 0.0f, 255.0f);
+	u32 b = (u32) clamp(color.b * 255.0f + 0.5f, 0.0f, 255.0f);
+	u32 pixel = r | (g << 8) | (b << 16) | 0xff000000;
+
+	size_t count = (size_t)sw.pitch * sw.height;
+	for (size_t i = 0; i < count; i++) {
+		sw.framebuffer[i] = pixel;
+	}
+}
+
+//
+// Init
+//
+
+void sw_init(int width, int height) {
+	sw.width  = width;
+	sw.height = height;
+	sw.pitch  = (width + 3) & ~3;
+
+	sw.framebuffer = (u32*) calloc((size_t)sw.pitch * height, sizeof(u32));
+
+	sw.triangles = (Sw_Triangle*) malloc(SW_MAX_TRIANGLES * sizeof(Sw_Triangle));
+
+	sw.tiles_x = (width  + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+	sw.tiles_y = (height + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+
+	sw.tiles = (Sw_Tile*) calloc(sw.tiles_x * sw.tiles_y, sizeof(Sw_Tile));
+	for (int i = 0; i < sw.tiles_x * sw.tiles_y; i++) {
+		sw.tiles[i].triangles = (u32*) malloc(SW_TILE_MAX_TRIANGLES * sizeof(u32));
+	}
+
+	// Threads.
+	{
+		int threads = SDL_GetCPUCount();
+
+		char* env_threads = SDL_getenv("SOFTWARE_RENDERER_THREADS"); // @Leak
+		if (env_threads) {
+			threads = SDL_atoi(env_threads);
+		}
+
+		threads = clamp(threads, 1, SW_MAX_THREADS + 1);
+
+		sw.work_start = SDL_CreateSemaphore(0);
+		sw.work_done  = SDL_CreateSemaphore(0);
+
+		for (int i = 0; i < threads - 1; i++) {
+			SDL_Thread* thread = SDL_CreateThread(worker_proc, "Rasterizer", nullptr);
+			if (!thread) {
+				log_error("Couldn't create a rasterizer thread: %s", SDL_GetError());
+				break;
+			}
+			sw.threads[sw.thread_count++] = thread;
+		}
+	}
+
+	sw.dump_frames = SDL_getenv("DUMP_FRAMES");
+
+#ifdef SW_SSE2
+	const char* simd = "SSE2";
+#else
+	const char* simd = "no SIMD";
+#endif
+
+	log_info("Software renderer: %dx%d, %d threads, %s.", width, height, sw.thread_count + 1, simd);
+}
+
+void sw_deinit() {
+	if (sw.frames > 0) {
+		log_info("Software renderer: %llu frames, %.3f ms submit, %.3f ms raster, %llu triangles per frame.",
+				 (unsigned long long)sw.frames,
+				 sw.total_submit_time / sw.frames * 1000.0,
+				 sw.total_raster_time / sw.frames * 1000.0,
+				 (unsigned long long)(sw.total_triangles / sw.frames));
+	}
+
+	sw.quit = true;
+	for (int i = 0; i < sw.thread_count; i++) SDL_SemPost(sw.work_start);
+	for (int i = 0; i < sw.thread_count; i++) SDL_WaitThread(sw.threads[i], nullptr);
+
+	SDL_DestroySemaphore(sw.work_start);
+	SDL_DestroySemaphore(sw.work_done);
+
+	for (int i = 0; i < sw.tiles_x * sw.tiles_y; i++) {
+		free(sw.tiles[i].triangles);
+	}
+	free(sw.tiles);
+	free(sw.triangles);
+	free(sw.framebuffer);
+
+	for (int i = 0; i < SW_MAX_TEXTURES; i++) {
+		free(sw.textures[i].pixels);
+	}
+
+	sw = {};
+}
+
+//
+// Output
+//
+
+static SDL_Surface* create_framebuffer_surface() {
+	return SDL_CreateRGBSurfaceWithFormatFrom(sw.framebuffer, sw.width, sw.height, 32, sw.pitch * sizeof(u32), SDL_PIXELFORMAT_RGBA32);
+}
+
+bool sw_save_bmp(const char* fname) {
+	SDL_Surface* surface = create_framebuffer_surface();
+	if (!surface) return false;
+	defer { SDL_FreeSurface(surface); };
+
+	if (SDL_SaveBMP(surface, fname) != 0) {
+		log_error("Couldn't save %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	return true;
+}
+
+void sw_end_frame(SDL_Window* window) {
+	sw_finish();
+
+	if (sw.dump_frames) {
+		char fname[512];
+		stb_snprintf(fname, sizeof(fname), "%s%05llu.bmp", sw.dump_frames, (unsigned long long)sw.frames);
+		sw_save_bmp(fname);
+	}
+
+	sw.frames++;
+
+	if (!window) return;
+
+	SDL_Surface* window_surface = SDL_GetWindowSurface(window);
+	if (!window_surface) return;
+
+	SDL_Surface* surface = create_framebuffer_surface();
+	if (!surface) return;
+	defer { SDL_FreeSurface(surface); };
+
+	// Same letterboxing as the GL backend.
+	float xscale = window_surface->w / (float)sw.width;
+	float yscale = window_surface->h / (float)sw.height;
+	float scale = min(xscale, yscale);
+
+	SDL_Rect dest;
+	dest.w = (int) (sw.width  * scale);
+	dest.h = (int) (sw.height * scale);
+	dest.x = (window_surface->w - dest.w) / 2;
+	dest.y = (window_surface->h - dest.h) / 2;
+
+	SDL_FillRect(window_surface, nullptr, SDL_MapRGB(window_surface->format, 0, 0, 0));
+	SDL_BlitScaled(surface, nullptr, window_surface, &dest);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "common.h"
+
+/*
+* CPU backend for the batch renderer. Used instead of OpenGL when the "SOFTWARE_RENDERER" environment variable is set.
+*
+* Renders into a memory framebuffer (RGBA8, top row first). Doesn't need a GPU or a GL context,
+* so with "SDL_VIDEODRIVER=dummy" it runs headless.
+*
+* Triangles are set up and binned into screen tiles as they're submitted, and rasterized
+* on sw_finish(). A tile is always processed by one thread, in submission order, so the result doesn't
+* depend on the number of threads. Pixels are shaded 4 at a time (SSE2 if available).
+*
+* Blending is the same as the GL backend (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA),
+* sampling is nearest or bilinear depending on the texture's filter.
+*
+* Environment variables:
+* "SOFTWARE_RENDERER_THREADS" - number of threads, including the main thread.
+* "DUMP_FRAMES" - path prefix. Every frame is saved as <prefix>00000.bmp, <prefix>00001.bmp, ...
+*/
+
+struct Vertex;
+struct Sw_Triangle;
+
+constexpr int    SW_TILE_SIZE          = 64;
+constexpr size_t SW_MAX_TRIANGLES      = 64 * 1024; // Rasterizes early if there's more.
+constexpr size_t SW_TILE_MAX_TRIANGLES = 8 * 1024;
+constexpr int    SW_MAX_TEXTURES       = 256;
+constexpr int    SW_MAX_THREADS        = 16;
+
+struct Sw_Texture {
+	u32* pixels; // RGBA8, one layer after another. Null if the slot is free.
+	int width;
+	int height;
+	int layers;
+
+	bool bilinear;
+	int wrap; // GL_CLAMP_TO_BORDER, GL_CLAMP_TO_EDGE or GL_REPEAT
+};
+
+struct Sw_Tile {
+	u32* triangles; // Indices into Software_Renderer.triangles
+	size_t count;
+};
+
+struct Software_Renderer {
+	u32* framebuffer;
+	int width;
+	int height;
+	int pitch; // In pixels. Rounded up to 4, so a group of 4 pixels never spills into the next row.
+
+	Sw_Texture textures[SW_MAX_TEXTURES]; // Texture ID is index + 1
+
+	Sw_Triangle* triangles;
+	size_t triangle_count;
+
+	Sw_Tile* tiles;
+	int tiles_x;
+	int tiles_y;
+
+	SDL_Thread* threads[SW_MAX_THREADS];
+	int thread_count; // Not counting the main thread
+	SDL_sem* work_start;
+	SDL_sem* work_done;
+	SDL_atomic_t next_tile;
+	bool quit;
+
+	char* dump_frames; // @Leak
+
+	// For metrics
+	u64 frames;
+	u64 total_triangles;
+	double total_raster_time; // In seconds
+	double total_submit_time;
+	double raster_time_during_submit;
+};
+
+extern Software_Renderer sw;
+
+void sw_init(int width, int height);
+void sw_deinit();
+
+// Pixel data is RGBA8, can be null. Returns the texture ID (never 0).
+u32 sw_create_texture(const void* pixel_data, int width, int height, int layers, int filter, int wrap);
+void sw_texture_sub_image(u32 texture, int x, int y, int layer, int width, int height, const void* pixel_data);
+void sw_delete_texture(u32 texture);
+
+void sw_clear(vec4 color);
+
+// Quads are 4 vertices each (0 1 2, 2 3 0), triangles are 3.
+void sw_draw_quads    (const Vertex* vertices, size_t count, const mat4& MVP, u32 texture);
+void sw_draw_triangles(const Vertex* vertices, size_t count, const mat4& MVP, u32 texture);
+
+void sw_finish(); // Rasterizes everything submitted so far.
+
+// Finishes the frame, saves it if "DUMP_FRAMES" is set and copies it to the window surface, scaled to fit.
+// Window can be null.
+void sw_end_frame(SDL_Window* window);
+
+bool sw_save_bmp(const char* fname);
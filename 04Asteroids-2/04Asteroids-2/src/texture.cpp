@@ -1,8 +1,133 @@
 #include "texture.h"
 
 #include "package.h"
+#include "window_creation.h"
+#include "software_renderer.h"
 #include <stb/stb_image.h>
 
+Texture_Array texture_array;
+
+void init_texture_array() {
+	if (window.software_renderer) {
+		texture_array.ID = sw_create_texture(nullptr, TEXTURE_ARRAY_SIZE, TEXTURE_ARRAY_SIZE, TEXTURE_ARRAY_LAYERS,
+											 GL_NEAREST, GL_CLAMP_TO_BORDER);
+		return;
+	}
+
+	glGenTextures(1, &texture_array.ID);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array.ID);
+	defer { glBindTexture(GL_TEXTURE_2D_ARRAY, 0); };
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+
+	// Zero-filled, so the padding between textures reads like GL_CLAMP_TO_BORDER's border.
+	size_t size = (size_t)TEXTURE_ARRAY_SIZE * TEXTURE_ARRAY_SIZE * TEXTURE_ARRAY_LAYERS * 4;
+	void* zeroes = calloc(size, 1);
+	defer { free(zeroes); };
+
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8,
+				 TEXTURE_ARRAY_SIZE, TEXTURE_ARRAY_SIZE, TEXTURE_ARRAY_LAYERS,
+				 0, GL_RGBA, GL_UNSIGNED_BYTE, zeroes);
+}
+
+void deinit_texture_array() {
+	if (window.software_renderer) {
+		sw_delete_texture(texture_array.ID);
+	} else {
+		glDeleteTextures(1, &texture_array.ID);
+	}
+	texture_array = {};
+}
+
+// Finds a free spot for a w*h rectangle. Textures are put on shelves, left to right,
+// with 1 pixel of padding so nothing bleeds into the neighbours.
+static bool texture_array_alloc(int width, int height, int* out_layer, int* out_x, int* out_y) {
+	int w = width  + 1;
+	int h = height + 1;
+
+	if (w > TEXTURE_ARRAY_SIZE || h > TEXTURE_ARRAY_SIZE) {
+		return false;
+	}
+
+	Texture_Array* a = &texture_array;
+
+	while (a->layer < TEXTURE_ARRAY_LAYERS) {
+		// Next shelf.
+		if (a->shelf_x + w > TEXTURE_ARRAY_SIZE) {
+			a->shelf_x = 0;
+			a->shelf_y += a->shelf_h;
+			a->shelf_h = 0;
+		}
+
+		// Next layer.
+		if (a->shelf_y + h > TEXTURE_ARRAY_SIZE) {
+			a->layer++;
+			a->shelf_x = 0;
+			a->shelf_y = 0;
+			a->shelf_h = 0;
+			continue;
+		}
+
+		*out_layer = a->layer;
+		*out_x = a->shelf_x;
+		*out_y = a->shelf_y;
+
+		a->shelf_x += w;
+		a->shelf_h = max(a->shelf_h, h);
+		return true;
+	}
+
+	return false;
+}
+
+Texture create_texture(void* pixel_data, int width, int height,
+					   int filter, int wrap) {
+	if (texture_array.ID != 0 && filter == GL_NEAREST && wrap == GL_CLAMP_TO_BORDER) {
+		int layer;
+		int x;
+		int y;
+		if (texture_array_alloc(width, height, &layer, &x, &y)) {
+			if (window.software_renderer) {
+				sw_texture_sub_image(texture_array.ID, x, y, layer, width, height, pixel_data);
+			} else {
+				glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array.ID);
+				defer { glBindTexture(GL_TEXTURE_2D_ARRAY, 0); };
+
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel_data);
+			}
+
+			Texture result = {texture_array.ID, width, height};
+			result.layer = layer;
+			result.x = x;
+			result.y = y;
+			return result;
+		}
+	}
+
+	if (window.software_renderer) {
+		return {sw_create_texture(pixel_data, width, height, 1, filter, wrap), width, height};
+	}
+
+	u32 texture;
+	glGenTextures(1, &texture);
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	defer { glBindTexture(GL_TEXTURE_2D, 0); };
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel_data);
+
+	return {texture, width, height};
+}
+
 static bool is_png(u8* filedata, size_t filesize) {
 	static u8 magic[] = {137, 80, 78, 71, 13, 10, 26, 10};
 	if (filesize < sizeof(magic)) {
@@ -31,25 +156,6 @@ static bool is_qoi(u8* filedata, size_t filesize) {
 
 Texture load_texture_from_file(const char* fname,
 							   int filter, int wrap) {
-	auto create_texture = [&](void* pixel_data, int width, int height, int num_channels) -> Texture {
-		u32 texture;
-		glGenTextures(1, &texture);
-
-		glBindTexture(GL_TEXTURE_2D, texture);
-		defer { glBindTexture(GL_TEXTURE_2D, 0); };
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
-
-		Assert(num_channels == 4);
-
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel_data);
-
-		return {texture, width, height};
-	};
-
 	Texture result = {};
 
 	size_t filesize;
@@ -63,7 +169,9 @@ Texture load_texture_from_file(const char* fname,
 			void* pixel_data = stbi_load_from_memory(filedata, (int)filesize, &width, &height, &num_channels, 4);
 			defer { if (pixel_data) stbi_image_free(pixel_data); };
 
-			result = create_texture(pixel_data, width, height, num_channels);
+			if (pixel_data) {
+				result = create_texture(pixel_data, width, height, filter, wrap);
+			}
 		} else if (is_qoi(filedata, filesize)) {
 			//qoi_desc desc;
 			//void* pixel_data = qoi_decode(filedata, (int)filesize, &desc, 4);
@@ -71,7 +179,7 @@ Texture load_texture_from_file(const char* fname,
 
 			//// Assert(desc.colorspace == QOI_SRGB);
 
-			//result = create_texture(pixel_data, desc.width, desc.height, desc.channels);
+			//result = create_texture(pixel_data, desc.width, desc.height, filter, wrap);
 		}
 	}
 
@@ -83,7 +191,7 @@ Texture load_texture_from_file(const char* fname,
 		// Create a 1x1 stub texture
 		u32 white[1 * 1] = {0xffffffff};
 
-		result = create_texture(white, 1, 1, 4);
+		result = create_texture(white, 1, 1, filter, wrap);
 	}
 
 	return result;
@@ -6,7 +6,39 @@ struct Texture {
 	u32 ID;
 	int width;
 	int height;
+
+	int layer = -1;  // Layer in texture_array, or -1 if this is a standalone GL_TEXTURE_2D.
+	int x;           // Position inside the layer.
+	int y;
 };
 
+/*
+* Small textures (with GL_NEAREST and GL_CLAMP_TO_BORDER) are packed into one GL_TEXTURE_2D_ARRAY,
+* so the batch renderer can draw sprites, rectangles and text from different textures in one draw call.
+* 
+* For those textures, Texture.ID is the array's ID.
+*/
+constexpr int TEXTURE_ARRAY_SIZE   = 512;
+constexpr int TEXTURE_ARRAY_LAYERS = 4;
+
+struct Texture_Array {
+	u32 ID;
+
+	// Shelf packer state.
+	int layer;
+	int shelf_x;
+	int shelf_y;
+	int shelf_h;
+};
+
+extern Texture_Array texture_array;
+
+void init_texture_array(); // assumes opengl is initialized
+void deinit_texture_array();
+
+// Pixel data is RGBA8.
+Texture create_texture(void* pixel_data, int width, int height,
+					   int filter = GL_NEAREST, int wrap = GL_CLAMP_TO_BORDER);
+
 Texture load_texture_from_file(const char* fname,
 							   int filter = GL_NEAREST, int wrap = GL_CLAMP_TO_BORDER);
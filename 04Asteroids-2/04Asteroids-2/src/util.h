@@ -21,7 +21,19 @@ inline u32 compile_shader(GLenum type, const char* source) {
 	return shader;
 }
 
-inline u32 link_program(u32 vertex_shader, u32 fragment_shader) {
+struct Shader {
+	u32 ID;
+
+	// Uniform locations are looked up once here instead of every draw call.
+	// -1 if the program doesn't have that uniform (glUniform* ignores -1).
+	int u_MVP;
+	int u_SourceSize;
+	int u_Scale;
+	int u_Texture;
+	int u_TextureArray;
+};
+
+inline Shader link_program(u32 vertex_shader, u32 fragment_shader) {
 	u32 program = glCreateProgram();
 
 	glAttachShader(program, vertex_shader);
@@ -37,5 +49,14 @@ inline u32 link_program(u32 vertex_shader, u32 fragment_shader) {
 		log_error("Shader Link Error: %s", buf);
 	}
 
-	return program;
+	Shader result = {};
+	result.ID = program;
+
+	result.u_MVP        = glGetUniformLocation(program, "u_MVP");
+	result.u_SourceSize = glGetUniformLocation(program, "u_SourceSize");
+	result.u_Scale      = glGetUniformLocation(program, "u_Scale");
+	result.u_Texture      = glGetUniformLocation(program, "u_Texture");
+	result.u_TextureArray = glGetUniformLocation(program, "u_TextureArray");
+
+	return result;
 }
@@ -1,7 +1,23 @@
 #include "window_creation.h"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#elif defined(__linux__)
+#include <time.h>
+#include <errno.h>
+#endif
+
 Window window;
 
+constexpr double MIN_SPIN_MARGIN = 0.0002;
+constexpr double MAX_SPIN_MARGIN = 0.02;
+constexpr int PACING_REPORT_FRAMES = 60;
+
 
 #ifdef _DEBUG
 static void GLAPIENTRY gl_debug_callback(GLenum source,
@@ -58,6 +74,104 @@ static void GLAPIENTRY gl_debug_callback(GLenum source,
 #endif
 
 
+static void os_sleep(double seconds) {
+#ifdef _WIN32
+	if (window.high_res_timer) {
+		LARGE_INTEGER due;
+		due.QuadPart = -(LONGLONG)(seconds * 10'000'000.0); // Relative, in 100ns units
+		if (SetWaitableTimer(window.high_res_timer, &due, 0, nullptr, nullptr, FALSE)) {
+			WaitForSingleObject(window.high_res_timer, INFINITE);
+			return;
+		}
+	}
+	Sleep((DWORD)(seconds * 1000.0));
+#elif defined(__linux__)
+	timespec ts;
+	ts.tv_sec  = (time_t)seconds;
+	ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1'000'000'000.0);
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {}
+#else
+	SDL_Delay((u32)(seconds * 1000.0));
+#endif
+}
+
+// Measures how much a short OS sleep overshoots, for the initial spin margin.
+static void calibrate_sleep() {
+#ifdef _WIN32
+	// Only on Windows 10 1803 and newer. Otherwise falls back to Sleep().
+	window.high_res_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+
+	double worst = 0;
+	for (int i = 0; i < 8; i++) {
+		double t = get_time();
+		os_sleep(0.001);
+		worst = max(worst, get_time() - t);
+	}
+
+	window.spin_margin = clamp(worst - 0.001 + MIN_SPIN_MARGIN, MIN_SPIN_MARGIN, MAX_SPIN_MARGIN);
+
+	log_info("1ms sleep takes up to %.3fms, spin margin %.3fms.", worst * 1000.0, window.spin_margin * 1000.0);
+}
+
+static void add_pacing_sample(double error, bool missed) {
+	window.pacing_error_sum += error;
+	window.pacing_error_worst = max(window.pacing_error_worst, error);
+	window.pacing_missed_sum += missed;
+	window.pacing_missed_total += missed;
+	window.pacing_frames++;
+
+	if (window.pacing_frames >= PACING_REPORT_FRAMES) {
+		window.pacing_error_avg = window.pacing_error_sum / window.pacing_frames;
+		window.pacing_error_max = window.pacing_error_worst;
+		window.pacing_missed = window.pacing_missed_sum;
+
+		window.pacing_error_sum   = 0;
+		window.pacing_error_worst = 0;
+		window.pacing_missed_sum  = 0;
+		window.pacing_frames = 0;
+	}
+}
+
+/*
+* Sleeps until "spin_margin" before window.frame_end_time, then spins for the rest.
+* A sleep that overshoots the margin raises it to match, otherwise it creeps back down by 2% a frame.
+*/
+static void wait_for_frame_end() {
+	double time = get_time();
+
+	if (time >= window.frame_end_time) {
+		// Missed it. The next target is a period from now, the frames after this one don't try to make up for it.
+		add_pacing_sample(time - window.frame_end_time, true);
+		window.frame_end_time = time;
+		return;
+	}
+
+	double sleep_time = (window.frame_end_time - time) - window.spin_margin;
+	if (sleep_time > 0) {
+		os_sleep(sleep_time);
+
+		double now = get_time();
+		double oversleep = (now - time) - sleep_time;
+
+		double target = clamp(oversleep + MIN_SPIN_MARGIN, MIN_SPIN_MARGIN, MAX_SPIN_MARGIN);
+		if (target > window.spin_margin) {
+			window.spin_margin = target;
+		} else {
+			window.spin_margin += (target - window.spin_margin) * 0.02;
+		}
+
+		time = now;
+	}
+
+	// spinlock
+	while (time < window.frame_end_time) {
+		SDL_CPUPauseInstruction();
+		time = get_time();
+	}
+
+	add_pacing_sample(time - window.frame_end_time, false);
+}
 
 
 void init_window_and_opengl(const char* title,
@@ -72,10 +186,19 @@ void init_window_and_opengl(const char* title,
 		panic_and_abort("Couldn't initialize SDL: %s", SDL_GetError());
 	}
 
+	calibrate_sleep();
+
+	{
+		char* env_software_renderer = SDL_getenv("SOFTWARE_RENDERER"); // @Leak
+		if (env_software_renderer) {
+			window.software_renderer = (SDL_atoi(env_software_renderer) != 0);
+		}
+	}
+
 	window.handle = SDL_CreateWindow(title,
 									 SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
 									 width * init_window_scale, height * init_window_scale,
-									 SDL_WINDOW_OPENGL
+									 (window.software_renderer ? 0 : SDL_WINDOW_OPENGL)
 									 | SDL_WINDOW_RESIZABLE);
 	window.game_width  = width;
 	window.game_height = height;
@@ -94,6 +217,12 @@ void init_window_and_opengl(const char* title,
 
 	SDL_SetWindowMinimumSize(window.handle, width, height);
 
+	if (window.software_renderer) {
+		// Frame rate is limited by the sleep in swap_buffers.
+		window.vsync = false;
+		return;
+	}
+
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -146,8 +275,22 @@ void init_window_and_opengl(const char* title,
 }
 
 void deinit_window_and_opengl() {
-	SDL_GL_DeleteContext(window.gl_context);
-	window.gl_context = nullptr;
+	if (!window.vsync) {
+		log_info("Frame pacing error: %.3fms average, %.3fms max, %d missed frames.",
+				 window.pacing_error_avg * 1000.0, window.pacing_error_max * 1000.0, window.pacing_missed_total);
+	}
+
+#ifdef _WIN32
+	if (window.high_res_timer) {
+		CloseHandle(window.high_res_timer);
+		window.high_res_timer = nullptr;
+	}
+#endif
+
+	if (window.gl_context) {
+		SDL_GL_DeleteContext(window.gl_context);
+		window.gl_context = nullptr;
+	}
 
 	SDL_DestroyWindow(window.handle);
 	window.handle = nullptr;
@@ -189,13 +332,15 @@ static void handle_event(SDL_Event* ev) {
 void begin_frame() {
 	if (!window.prev_time_is_initialized) {
 		window.prev_time = get_time() - 1.0 / window.target_fps;
+		window.frame_end_time = get_time();
 
 		window.prev_time_is_initialized = true;
 	}
 
 	double time = get_time();
 
-	window.frame_end_time = time + (1.0 / window.target_fps);
+	// From the previous target rather than from now, so that the time spent waking up isn't added every frame.
+	window.frame_end_time += (1.0 / window.target_fps);
 
 	// Set delta.
 	{
@@ -222,18 +367,14 @@ void begin_frame() {
 }
 
 void swap_buffers() {
-	SDL_GL_SwapWindow(window.handle);
+	if (window.software_renderer) {
+		SDL_UpdateWindowSurface(window.handle);
+	} else {
+		SDL_GL_SwapWindow(window.handle);
+	}
 
 	if (!window.vsync) {
-		double time_left = window.frame_end_time - get_time();
-
-		if (time_left > 0.0) {
-			double sleep_time = time_left * 0.95;
-			SDL_Delay((u32)(sleep_time * 1000.0));
-
-			// spinlock
-			while (get_time() < window.frame_end_time) {}
-		}
+		wait_for_frame_end();
 	}
 }
 
@@ -14,9 +14,10 @@ struct Window {
 	// 
 
 	SDL_Window* handle;
-	SDL_GLContext gl_context;
+	SDL_GLContext gl_context; // Null with the software renderer.
 
 	bool vsync;
+	bool software_renderer; // See software_renderer.h
 
 	int game_width;
 	int game_height;
@@ -24,6 +25,13 @@ struct Window {
 	float fps; // For metrics
 	float delta; // NOTE: multiplied by 60
 
+	// How late frames end relative to the target, when vsync is off. In seconds, over the last 60 frames.
+	// A frame that ends after its target is a miss, and its lateness counts too.
+	double pacing_error_avg;
+	double pacing_error_max;
+	int pacing_missed; // Over the same frames
+	int pacing_missed_total;
+
 	// 
 	// Modify these
 	// 
@@ -41,6 +49,14 @@ struct Window {
 	double prev_time;
 	double frame_end_time;
 
+	double spin_margin;     // See wait_for_frame_end()
+	void* high_res_timer;   // Windows only
+
+	double pacing_error_sum;
+	double pacing_error_worst;
+	int pacing_missed_sum;
+	int pacing_frames;
+
 	bool prev_time_is_initialized;
 };
 
@@ -50,9 +66,13 @@ extern Window window;
 * If you pass "prefer_vsync" as false, then you may want to change "window.target_fps" after calling this function.
 * 
 * If vsync is false, then we do OS sleep + spinlock to keep the framerate.
+* The sleep is calibrated at startup and only the last fraction of a millisecond or so is spent spinning.
 * 
 * Vsync option can be overriden by an environment variable "USE_VSYNC".
 * 
+* If the "SOFTWARE_RENDERER" environment variable is set, no GL context is created and
+* the batch renderer renders on the CPU (see software_renderer.h).
+* 
 * Note that vsync is forced anyway on most OS's window managers in windowed mode and
 * it'll look bad if not in fullscreen mode.
 * (On Linux, you may want to search for a "disable compositor for fullscreen apps" option for your favourite DE.)
@@ -0,0 +1,246 @@
+#include "common.h"
+#include "window_creation.h"
+#include "batch_renderer.h"
+#include "software_renderer.h"
+#include "texture.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+/*
+* Tests for the batch renderer, on the software backend so they don't need a GPU or a display.
+*
+* "renderer_tests <test> [args]" runs one test, and returns non-zero if it failed.
+* CMakeLists.txt registers them with CTest.
+*
+* golden <file.bmp>
+*     Renders a scene with every kind of draw and compares it against the file.
+*     With the "UPDATE_GOLDEN" environment variable set, saves the scene to the file instead.
+*
+* layer_order
+*     Draws overlapping quads on random layers, with other draws in between so they don't merge,
+*     and checks that the top one on every layer wins, and the last one on the same layer.
+*/
+
+constexpr int TEST_W = 160;
+constexpr int TEST_H = 120;
+
+// Per channel. The SSE2 and the scalar shading paths can round differently.
+constexpr int GOLDEN_TOLERANCE = 2;
+
+static void begin_test_frame() {
+	render_begin_frame(color_black);
+	set_view_rect({0, 0, (float)TEST_W, (float)TEST_H});
+}
+
+static u32 get_pixel(int x, int y) {
+	return sw.framebuffer[x + y * sw.pitch];
+}
+
+static void draw_golden_scene() {
+	// 4x4 checkerboard, goes into the texture array.
+	u32 checker[16];
+	for (int i = 0; i < 16; i++) {
+		checker[i] = ((i % 4 + i / 4) % 2) ? 0xff'ff'ff'ff : 0xff'80'20'20;
+	}
+	Texture checker_texture = create_texture(checker, 4, 4);
+
+	// 2x2, bilinear, so it's a standalone texture.
+	u32 gradient[4] = {0xff'00'00'ff, 0xff'00'ff'00, 0xff'ff'00'00, 0x80'ff'ff'ff};
+	Texture gradient_texture = create_texture(gradient, 2, 2, GL_LINEAR, GL_CLAMP_TO_EDGE);
+
+	begin_test_frame();
+
+	draw_rectangle({10, 10, 40, 30}, color_red);
+	draw_rectangle({95, 30, 30, 20}, {1, 1}, {15, 10}, 30, {0, 1, 0, 0.5f});
+	draw_triangle({10, 110}, {60, 60}, {70, 110}, color_yellow);
+
+	draw_circle({120, 85}, 20, color_cornflower_blue);
+	draw_ring({120, 85}, 28, 3, color_white);
+	draw_rounded_rectangle({20, 45, 50, 30}, 8, {1, 0.5f, 0, 0.75f});
+
+	draw_texture(checker_texture, {}, {130, 5}, {6, 6});
+	draw_texture(gradient_texture, {}, {70, 60}, {16, 16}, {}, 15, {1, 1, 1, 0.9f});
+
+	render_end_frame();
+}
+
+static bool test_golden(const char* fname) {
+	draw_golden_scene();
+
+	if (SDL_getenv("UPDATE_GOLDEN")) {
+		if (!sw_save_bmp(fname)) return false;
+		log_info("Saved %s.", fname);
+		return true;
+	}
+
+	SDL_Surface* loaded = SDL_LoadBMP(fname);
+	if (!loaded) {
+		log_error("Couldn't load %s: %s", fname, SDL_GetError());
+		return false;
+	}
+	defer { SDL_FreeSurface(loaded); };
+
+	SDL_Surface* golden = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+	if (!golden) {
+		log_error("Couldn't convert %s: %s", fname, SDL_GetError());
+		return false;
+	}
+	defer { SDL_FreeSurface(golden); };
+
+	if (golden->w != sw.width || golden->h != sw.height) {
+		log_error("%s is %dx%d, the scene is %dx%d.", fname, golden->w, golden->h, sw.width, sw.height);
+		return false;
+	}
+
+	int differ = 0;
+	int max_diff = 0;
+	for (int y = 0; y < sw.height; y++) {
+		const u32* row = (const u32*) ((const u8*) golden->pixels + y * golden->pitch);
+
+		for (int x = 0; x < sw.width; x++) {
+			u32 a = get_pixel(x, y);
+			u32 b = row[x];
+
+			// Alpha isn't compared, the BMP might not keep it.
+			int diff = 0;
+			for (int shift = 0; shift < 24; shift += 8) {
+				int d = abs((int)((a >> shift) & 0xff) - (int)((b >> shift) & 0xff));
+				diff = max(diff, d);
+			}
+
+			if (diff > GOLDEN_TOLERANCE) differ++;
+			max_diff = max(max_diff, diff);
+		}
+	}
+
+	if (differ > 0) {
+		const char* actual_fname = "renderer_tests_actual.bmp";
+		sw_save_bmp(actual_fname);
+		log_error("%d pixels differ from %s by more than %d (up to %d). Saved the result to %s.",
+				  differ, fname, GOLDEN_TOLERANCE, max_diff, actual_fname);
+		return false;
+	}
+
+	return true;
+}
+
+constexpr int ORDER_CELL  = 8;
+constexpr int ORDER_CELLS = 16 * 12; // Covers the frame
+constexpr int ORDER_DRAWS = 6;       // Per cell
+
+static bool test_layer_order() {
+	struct Order_Draw {
+		int layer;
+		u8 red;
+	};
+
+	// Expected top draw of every cell.
+	u8 expected[ORDER_CELLS];
+
+	begin_test_frame();
+
+	u32 rng = 12345;
+	auto next_random = [&](u32 n) {
+		rng = rng * 1664525 + 1013904223;
+		return (rng >> 16) % n;
+	};
+
+	for (int cell = 0; cell < ORDER_CELLS; cell++) {
+		float x = (float)((cell % (TEST_W / ORDER_CELL)) * ORDER_CELL);
+		float y = (float)((cell / (TEST_W / ORDER_CELL)) * ORDER_CELL);
+
+		Order_Draw top = {INT_MIN, 0};
+
+		for (int i = 0; i < ORDER_DRAWS; i++) {
+			Order_Draw d;
+			d.layer = (int)next_random(5) - 2;
+			d.red = (u8)(40 * (i + 1));
+
+			renderer.layer = d.layer;
+			draw_rectangle({x, y, (float)ORDER_CELL, (float)ORDER_CELL}, {d.red / 255.0f, 0, 0, 1});
+
+			// Same layer wins if it's drawn later.
+			if (d.layer >= top.layer) top = d;
+
+			// A triangle below everything, so the next quad doesn't merge with this one
+			// and the queue has commands with other keys in between.
+			renderer.layer = -100;
+			draw_triangle({x, y}, {x + 1, y}, {x, y + 1}, color_white);
+		}
+
+		expected[cell] = top.red;
+	}
+
+	renderer.layer = 0;
+	render_end_frame();
+
+	int wrong = 0;
+	for (int cell = 0; cell < ORDER_CELLS; cell++) {
+		int x = (cell % (TEST_W / ORDER_CELL)) * ORDER_CELL + ORDER_CELL / 2;
+		int y = (cell / (TEST_W / ORDER_CELL)) * ORDER_CELL + ORDER_CELL / 2;
+
+		int red = (int)(get_pixel(x, y) & 0xff);
+		if (abs(red - (int)expected[cell]) > 1) {
+			if (wrong < 10) log_error("Cell %d: red is %d, should be %d.", cell, red, expected[cell]);
+			wrong++;
+		}
+	}
+
+	if (wrong > 0) {
+		log_error("%d of %d cells have the wrong draw on top.", wrong, ORDER_CELLS);
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		log_error("Usage: renderer_tests golden <file.bmp> | layer_order");
+		return 1;
+	}
+
+	window.software_renderer = true;
+	window.game_width  = TEST_W;
+	window.game_height = TEST_H;
+
+	init_renderer();
+	defer { deinit_renderer(); };
+
+	bool ok;
+	if (strcmp(argv[1], "golden") == 0 && argc >= 3) {
+		ok = test_golden(argv[2]);
+	} else if (strcmp(argv[1], "layer_order") == 0) {
+		ok = test_layer_order();
+	} else {
+		log_error("Unknown test \"%s\".", argv[1]);
+		return 1;
+	}
+
+	log_info("%s: %s", argv[1], ok ? "passed" : "FAILED");
+	return ok ? 0 : 1;
+}
+
+
+#pragma warning(push, 0)
+
+
+#define STB_SPRINTF_IMPLEMENTATION
+#include <stb/stb_sprintf.h>
+#undef STB_SPRINTF_IMPLEMENTATION
+
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_NO_STDIO
+#include <stb/stb_image.h>
+#undef STB_IMAGE_IMPLEMENTATION
+
+
+#define GLAD_GL_IMPLEMENTATION
+#include <glad/gl.h>
+#undef GLAD_GL_IMPLEMENTATION
+
+
+#pragma warning(pop)
@@ -0,0 +1,418 @@
+#include "AllocTracker.h"
+
+#include "stb_sprintf.h"
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <dbghelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#elif defined(__linux__)
+#include <execinfo.h>
+#include <dlfcn.h>
+#endif
+
+AllocTracker alloc_tracker;
+
+// Backtrace of the hook's caller. Inlined, so that the hook is the only frame to skip.
+SDL_FORCE_INLINE int capture_backtrace(void** frames) {
+#ifdef _WIN32
+	return (int) CaptureStackBackTrace(1, ALLOC_BACKTRACE_DEPTH, frames, nullptr);
+#elif defined(__linux__)
+	void* buf[ALLOC_BACKTRACE_DEPTH + 1];
+	int count = backtrace(buf, ALLOC_BACKTRACE_DEPTH + 1) - 1;
+	if (count <= 0) return 0;
+	memcpy(frames, buf + 1, count * sizeof(*frames));
+	return count;
+#else
+	return 0;
+#endif
+}
+
+static u32 ptr_slot(void* ptr) {
+	u64 x = u64(uintptr_t(ptr)) >> 4;
+	x *= 0x9E3779B97F4A7C15ull;
+	return u32(x >> 40) & (ALLOC_MAX_LIVE - 1);
+}
+
+// The functions below are called with the lock held.
+
+static int get_site(AllocTracker* t, void** frames, int count) {
+	u32 hash = 2166136261u;
+	for (int i = 0; i < count; i++) {
+		u64 a = u64(uintptr_t(frames[i]));
+		hash = (hash ^ u32(a)) * 16777619u;
+		hash = (hash ^ u32(a >> 32)) * 16777619u;
+	}
+	hash |= 1; // 0 is an empty slot
+
+	u32 i = hash & (ALLOC_MAX_SITES - 1);
+	for (int probe = 0; probe < ALLOC_MAX_SITES; probe++) {
+		AllocSite* s = &t->sites[i];
+		if (s->hash == 0) {
+			if (t->site_count >= ALLOC_MAX_SITES * 3 / 4) return -1;
+
+			s->hash = hash;
+			s->frame_count = count;
+			memcpy(s->frames, frames, count * sizeof(*frames));
+			t->site_count++;
+			return (int) i;
+		}
+		if (s->hash == hash && s->frame_count == count && memcmp(s->frames, frames, count * sizeof(*frames)) == 0) {
+			return (int) i;
+		}
+		i = (i + 1) & (ALLOC_MAX_SITES - 1);
+	}
+	return -1;
+}
+
+static bool live_remove(AllocTracker* t, void* ptr, AllocLiveEntry* out) {
+	const u32 mask = ALLOC_MAX_LIVE - 1;
+
+	u32 i = ptr_slot(ptr);
+	while (t->live_map[i].ptr != ptr) {
+		if (!t->live_map[i].ptr) return false; // Allocated before the hooks, or the map was full
+		i = (i + 1) & mask;
+	}
+	*out = t->live_map[i];
+
+	// Shift the entries after it back, so that lookups don't need tombstones.
+	u32 j = i;
+	while (true) {
+		j = (j + 1) & mask;
+		if (!t->live_map[j].ptr) break;
+
+		u32 home = ptr_slot(t->live_map[j].ptr);
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			t->live_map[i] = t->live_map[j];
+			i = j;
+		}
+	}
+	t->live_map[i].ptr = nullptr;
+
+	t->live--;
+	t->live_bytes -= out->size;
+	if (out->site >= 0) {
+		t->sites[out->site].live--;
+		t->sites[out->site].live_bytes -= out->size;
+	}
+	return true;
+}
+
+static void record_alloc(AllocTracker* t, void* ptr, usize size, void** frames, int count) {
+	int site = get_site(t, frames, count);
+
+	t->frame.allocs++;
+	t->frame.bytes_allocated += size;
+
+	if (site >= 0) {
+		AllocSite* s = &t->sites[site];
+		s->allocs++;
+		s->bytes += size;
+		s->frame_allocs++;
+		s->frame_bytes += size;
+	}
+
+	if (t->live >= ALLOC_MAX_LIVE * 3 / 4) {
+		t->live_map_full = true;
+		return;
+	}
+
+	u32 i = ptr_slot(ptr);
+	while (t->live_map[i].ptr) {
+		i = (i + 1) & (ALLOC_MAX_LIVE - 1);
+	}
+	t->live_map[i] = {ptr, size, site};
+
+	t->live++;
+	t->live_bytes += size;
+	if (site >= 0) {
+		t->sites[site].live++;
+		t->sites[site].live_bytes += size;
+	}
+}
+
+static void record_free(AllocTracker* t, void* ptr) {
+	AllocLiveEntry e;
+	if (live_remove(t, ptr, &e)) {
+		t->frame.frees++;
+		t->frame.bytes_freed += e.size;
+	}
+}
+
+// Frees and reallocs call the real allocator with the lock held, so that nobody else can get the address
+// and record it before we've removed it.
+
+static void* SDLCALL track_malloc(size_t size) {
+	AllocTracker* t = &alloc_tracker;
+
+	void* frames[ALLOC_BACKTRACE_DEPTH];
+	int count = capture_backtrace(frames);
+
+	void* ptr = t->real_malloc(size);
+	if (ptr) {
+		SDL_AtomicLock(&t->lock);
+		record_alloc(t, ptr, size, frames, count);
+		SDL_AtomicUnlock(&t->lock);
+	}
+	return ptr;
+}
+
+static void* SDLCALL track_calloc(size_t nmemb, size_t size) {
+	AllocTracker* t = &alloc_tracker;
+
+	void* frames[ALLOC_BACKTRACE_DEPTH];
+	int count = capture_backtrace(frames);
+
+	void* ptr = t->real_calloc(nmemb, size);
+	if (ptr) {
+		SDL_AtomicLock(&t->lock);
+		record_alloc(t, ptr, nmemb * size, frames, count);
+		SDL_AtomicUnlock(&t->lock);
+	}
+	return ptr;
+}
+
+static void* SDLCALL track_realloc(void* ptr, size_t size) {
+	AllocTracker* t = &alloc_tracker;
+
+	void* frames[ALLOC_BACKTRACE_DEPTH];
+	int count = capture_backtrace(frames);
+
+	SDL_AtomicLock(&t->lock);
+	void* result = t->real_realloc(ptr, size);
+	if (ptr && (result || size == 0)) {
+		record_free(t, ptr);
+	}
+	if (result) {
+		record_alloc(t, result, size, frames, count);
+	}
+	SDL_AtomicUnlock(&t->lock);
+
+	return result;
+}
+
+static void SDLCALL track_free(void* ptr) {
+	AllocTracker* t = &alloc_tracker;
+
+	if (!ptr) return;
+
+	SDL_AtomicLock(&t->lock);
+	record_free(t, ptr);
+	t->real_free(ptr);
+	SDL_AtomicUnlock(&t->lock);
+}
+
+void alloc_tracker_init() {
+	AllocTracker* t = &alloc_tracker;
+
+	const char* mode = SDL_getenv("ALLOC_TRACK");
+	if (!mode || SDL_strcmp(mode, "0") == 0) return;
+
+	SDL_GetMemoryFunctions(&t->real_malloc, &t->real_calloc, &t->real_realloc, &t->real_free);
+
+	// From the real allocator, so they don't count. Never freed, because SDL can still free things after main() returns.
+	t->sites    = (AllocSite*)      t->real_calloc(ALLOC_MAX_SITES, sizeof(AllocSite));
+	t->live_map = (AllocLiveEntry*) t->real_calloc(ALLOC_MAX_LIVE,  sizeof(AllocLiveEntry));
+	if (!t->sites || !t->live_map) {
+		SDL_Log("Allocation tracker: out of memory.");
+		return;
+	}
+
+	t->assert_steady = (SDL_strcmp(mode, "assert") == 0);
+
+	if (SDL_SetMemoryFunctions(track_malloc, track_calloc, track_realloc, track_free) != 0) {
+		SDL_Log("Allocation tracker: couldn't hook SDL's allocator: %s", SDL_GetError());
+		return;
+	}
+
+	t->enabled = true;
+
+	SDL_Log("Allocation tracker: on%s.", t->assert_steady ? ", steady-state frames must not allocate" : "");
+}
+
+#ifdef _WIN32
+static bool sym_initialized;
+#endif
+
+static void symbolize(void* addr, char* buf, int size) {
+#ifdef _WIN32
+	HANDLE process = GetCurrentProcess();
+	if (!sym_initialized) {
+		SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES);
+		SymInitialize(process, nullptr, TRUE);
+		sym_initialized = true;
+	}
+
+	alignas(SYMBOL_INFO) char sym_buf[sizeof(SYMBOL_INFO) + 256];
+	SYMBOL_INFO* sym = (SYMBOL_INFO*) sym_buf;
+	sym->SizeOfStruct = sizeof(SYMBOL_INFO);
+	sym->MaxNameLen = 256;
+
+	DWORD64 displacement = 0;
+	if (SymFromAddr(process, DWORD64(addr), &displacement, sym)) {
+		IMAGEHLP_LINE64 line = {};
+		line.SizeOfStruct = sizeof(line);
+		DWORD line_displacement = 0;
+		if (SymGetLineFromAddr64(process, DWORD64(addr), &line_displacement, &line)) {
+			const char* file = line.FileName;
+			for (const char* c = line.FileName; *c; c++) {
+				if (*c == '\\' || *c == '/') file = c + 1;
+			}
+			stb_snprintf(buf, size, "%s (%s:%u)", sym->Name, file, (unsigned) line.LineNumber);
+		} else {
+			stb_snprintf(buf, size, "%s", sym->Name);
+		}
+		return;
+	}
+#elif defined(__linux__)
+	Dl_info info;
+	if (dladdr(addr, &info) && info.dli_fname) {
+		const char* file = info.dli_fname;
+		for (const char* c = info.dli_fname; *c; c++) {
+			if (*c == '/') file = c + 1;
+		}
+		if (info.dli_sname) {
+			stb_snprintf(buf, size, "%s (%s)", info.dli_sname, file);
+		} else {
+			stb_snprintf(buf, size, "%s+0x%llx", file, (unsigned long long) ((u8*) addr - (u8*) info.dli_fbase));
+		}
+		return;
+	}
+#endif
+	stb_snprintf(buf, size, "%p", addr);
+}
+
+static bool in_game_module(void* addr) {
+#ifdef _WIN32
+	HMODULE module;
+	if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+							(LPCWSTR) addr, &module)) {
+		return false;
+	}
+	return module == GetModuleHandleW(nullptr);
+#elif defined(__linux__)
+	Dl_info info;
+	Dl_info self;
+	if (!dladdr(addr, &info) || !dladdr((void*) &alloc_tracker_init, &self)) return false;
+	return info.dli_fbase == self.dli_fbase;
+#else
+	return false;
+#endif
+}
+
+static void name_site(AllocSite* s) {
+	for (int i = 0; i < s->frame_count; i++) {
+		if (!in_game_module(s->frames[i])) continue;
+
+		symbolize(s->frames[i], s->name, sizeof(s->name));
+
+		// In debug builds ecalloc isn't inlined. Its caller is the interesting part.
+		if (SDL_strncmp(s->name, "ecalloc", 7) == 0) continue;
+		return;
+	}
+
+	if (s->frame_count > 0) {
+		symbolize(s->frames[0], s->name, sizeof(s->name));
+	} else {
+		SDL_strlcpy(s->name, "(no backtrace)", sizeof(s->name));
+	}
+}
+
+void alloc_tracker_end_frame(bool steady) {
+	AllocTracker* t = &alloc_tracker;
+	if (!t->enabled) return;
+
+	SDL_AtomicLock(&t->lock);
+	{
+		t->last = t->frame;
+		t->frame = {};
+
+		for (int i = 0; i < ALLOC_MAX_SITES; i++) {
+			AllocSite* s = &t->sites[i];
+			s->last_allocs = s->frame_allocs;
+			s->last_bytes  = s->frame_bytes;
+			s->frame_allocs = 0;
+			s->frame_bytes  = 0;
+		}
+	}
+	SDL_AtomicUnlock(&t->lock);
+
+	t->frame_index++;
+
+	// A site's backtrace doesn't change once it's in the table, so this doesn't need the lock.
+	for (int i = 0; i < ALLOC_MAX_SITES; i++) {
+		AllocSite* s = &t->sites[i];
+		if (s->last_allocs > 0 && !s->name[0]) name_site(s);
+	}
+
+	if (t->live_map_full) {
+		SDL_Log("Allocation tracker: more than %d live allocations, frees of the new ones won't be counted.", ALLOC_MAX_LIVE * 3 / 4);
+		t->live_map_full = false;
+	}
+
+	if (!steady) {
+		t->steady_frames = 0;
+		return;
+	}
+
+	t->steady_frames++;
+
+	if (t->assert_steady && t->steady_frames > ALLOC_STEADY_FRAMES && t->last.allocs > 0) {
+		SDL_Log("Frame %llu allocated %d times (%llu bytes) in steady-state gameplay:",
+				(unsigned long long) t->frame_index, t->last.allocs, (unsigned long long) t->last.bytes_allocated);
+		alloc_tracker_log_last_frame();
+
+		// Logging allocates too. Start over instead of failing every frame after this one.
+		t->steady_frames = 0;
+
+		SDL_assert_always(!"Allocation in a steady-state frame. The call sites are in the log.");
+	}
+}
+
+int alloc_tracker_top_sites(AllocSite** out, int max_sites) {
+	AllocTracker* t = &alloc_tracker;
+	int count = 0;
+
+	if (!t->enabled) return 0;
+
+	// Insertion sort by bytes, keeping the top max_sites.
+	for (int i = 0; i < ALLOC_MAX_SITES; i++) {
+		AllocSite* s = &t->sites[i];
+		if (s->last_allocs == 0) continue;
+
+		int j = (count < max_sites) ? count++ : max_sites;
+		while (j > 0 && out[j - 1]->last_bytes < s->last_bytes) {
+			if (j < max_sites) out[j] = out[j - 1];
+			j--;
+		}
+		if (j < max_sites) out[j] = s;
+	}
+
+	return count;
+}
+
+void alloc_tracker_log_last_frame() {
+	AllocTracker* t = &alloc_tracker;
+	if (!t->enabled) return;
+
+	for (int i = 0; i < ALLOC_MAX_SITES; i++) {
+		AllocSite* s = &t->sites[i];
+		if (s->last_allocs == 0) continue;
+
+		SDL_Log("  %d allocs, %llu bytes, %d live: %s",
+				s->last_allocs, (unsigned long long) s->last_bytes, s->live, s->name);
+
+		for (int j = 0; j < s->frame_count; j++) {
+			char buf[256];
+			symbolize(s->frames[j], buf, sizeof(buf));
+			SDL_Log("      %s", buf);
+		}
+	}
+
+	if (t->site_count >= ALLOC_MAX_SITES * 3 / 4) {
+		SDL_Log("  (the site table is full, some allocations aren't attributed)");
+	}
+}
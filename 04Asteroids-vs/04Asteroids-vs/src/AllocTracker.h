@@ -0,0 +1,94 @@
+#pragma once
+
+#include "common.h"
+#include <SDL.h>
+
+//
+// Counts heap allocations per frame and per call site.
+//
+// Hooks SDL's allocator with SDL_SetMemoryFunctions(), which SDL_ttf, SDL_image and SDL_mixer go through too.
+// The game's own allocations (ecalloc and friends) use SDL_malloc/SDL_free for the same reason.
+//
+// Off unless ALLOC_TRACK is set: "1" counts and shows the numbers in the debug overlay,
+// "assert" also fails every steady-state frame that allocates, after logging where the allocations came from.
+// A frame is steady if it's gameplay, nothing happened that's expected to allocate (window events, debug keys),
+// and the ALLOC_STEADY_FRAMES before it were steady too.
+//
+// A call site is the backtrace of the allocation. It's captured on every allocation to tell sites apart,
+// and kept the first time that site is seen.
+//
+
+#define ALLOC_BACKTRACE_DEPTH 12
+#define ALLOC_MAX_SITES 2048
+#define ALLOC_MAX_LIVE (1 << 18) // Live allocations we can remember the size of. Power of 2.
+#define ALLOC_STEADY_FRAMES 300
+#define ALLOC_OVERLAY_SITES 4
+
+struct AllocSite {
+	void* frames[ALLOC_BACKTRACE_DEPTH];
+	int frame_count;
+	u32 hash;
+
+	u64 allocs;
+	u64 bytes;
+	int live;
+	usize live_bytes;
+
+	int frame_allocs; // Being counted
+	usize frame_bytes;
+	int last_allocs;  // In the last finished frame
+	usize last_bytes;
+
+	char name[96]; // The first function up the backtrace that's in the game. Filled in on the main thread.
+};
+
+struct AllocFrameStats {
+	int allocs;
+	int frees;
+	usize bytes_allocated;
+	usize bytes_freed;
+};
+
+struct AllocLiveEntry {
+	void* ptr;
+	usize size;
+	int site;
+};
+
+struct AllocTracker {
+	bool enabled;
+	bool assert_steady;
+	int steady_frames;
+	u64 frame_index;
+
+	AllocFrameStats frame; // Being counted
+	AllocFrameStats last;  // The last finished frame
+	int live;
+	usize live_bytes;
+
+	AllocSite* sites;
+	int site_count;
+	AllocLiveEntry* live_map; // Open addressing, keyed by pointer
+	bool live_map_full;
+
+	SDL_SpinLock lock;
+
+	SDL_malloc_func  real_malloc;
+	SDL_calloc_func  real_calloc;
+	SDL_realloc_func real_realloc;
+	SDL_free_func    real_free;
+};
+
+extern AllocTracker alloc_tracker;
+
+// Call first thing in main(), before SDL allocates anything. Does nothing if ALLOC_TRACK isn't set.
+void alloc_tracker_init();
+
+// Call once per frame. steady is false if the frame was allowed to allocate.
+void alloc_tracker_end_frame(bool steady);
+
+// The sites that allocated the most bytes in the last finished frame.
+int alloc_tracker_top_sites(AllocSite** out, int max_sites);
+
+// Logs the sites that allocated in the last finished frame, with backtraces.
+void alloc_tracker_log_last_frame();
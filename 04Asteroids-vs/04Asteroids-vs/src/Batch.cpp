@@ -0,0 +1,182 @@
+#include "Batch.h"
+
+#include "World.h"
+#include "WorldHash.h"
+#include "Jobs.h"
+#include "ecalloc.h"
+#include "mathh.h"
+#include "stb_sprintf.h"
+
+static double get_time() {
+	return double(SDL_GetPerformanceCounter()) / double(SDL_GetPerformanceFrequency());
+}
+
+static void run_world(u64 seed, int frames, BatchResult* r) {
+	World w{};
+	w.Init(seed, true);
+
+	r->seed = seed;
+	r->death_frame = -1;
+
+	double t = get_time();
+
+	for (int i = 0; i < frames; i++) {
+		// The world's own parallel_for calls run right here, on this world's job.
+		w.Update(1.0f);
+
+		r->max_enemies = max(r->max_enemies, w.enemy_count);
+
+		// The stage script sets these up on its first update, they point into its stack.
+		if (w.ai_points) {
+			int points = *w.ai_points;
+			if (!r->has_ai) {
+				r->has_ai = true;
+				r->ai_min_points = points;
+				r->ai_max_points = points;
+			}
+			r->ai_points          = points;
+			r->ai_min_points      = min(r->ai_min_points, points);
+			r->ai_max_points      = max(r->ai_max_points, points);
+			r->ai_tick_wait_time  = *w.ai_tick_wait_time;
+			r->ai_tick_wait_timer = *w.ai_tick_wait_timer;
+		}
+
+		// Nothing left to learn from this seed.
+		if (w.player.flags & FLAG_INSTANCE_DEAD) {
+			r->death_frame = w.frame;
+			break;
+		}
+	}
+
+	r->seconds = get_time() - t;
+
+	WorldHash hash;
+	world_hash(&w, &hash);
+	r->hash = hash.total;
+
+	r->frames = w.frame;
+	r->level = w.player.level;
+	r->experience = w.player.experience;
+	r->enemies = w.enemy_count;
+
+	w.Quit();
+}
+
+static bool write_report(const char* fname, const BatchResult* results, int count) {
+	SDL_RWops* f = SDL_RWFromFile(fname, "wb");
+	if (!f) {
+		SDL_Log("Couldn't open %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	char buf[256];
+	auto write = [&](const char* s) {
+		SDL_RWwrite(f, s, SDL_strlen(s), 1);
+	};
+
+	write("seed,hash,frames,death_frame,level,experience,enemies,max_enemies,seconds,"
+		  "ai_points,ai_min_points,ai_max_points,ai_tick_wait_time,ai_tick_wait_timer\n");
+	for (int i = 0; i < count; i++) {
+		const BatchResult* r = &results[i];
+		stb_snprintf(buf, sizeof(buf), "%llu,%016llx,%d,%d,%d,%.1f,%d,%d,%.4f,",
+					 (unsigned long long) r->seed, (unsigned long long) r->hash, r->frames, r->death_frame,
+					 r->level, r->experience, r->enemies, r->max_enemies, r->seconds);
+		write(buf);
+
+		if (r->has_ai) {
+			stb_snprintf(buf, sizeof(buf), "%d,%d,%d,%d,%d\n",
+						 r->ai_points, r->ai_min_points, r->ai_max_points, r->ai_tick_wait_time, r->ai_tick_wait_timer);
+			write(buf);
+		} else {
+			write(",,,,\n");
+		}
+	}
+
+	SDL_RWclose(f);
+	SDL_Log("Wrote the batch report to %s.", fname);
+	return true;
+}
+
+int run_batch(int count, int frames, const char* report_fname) {
+	if (count <= 0) return 0;
+	if (frames <= 0) frames = BATCH_DEFAULT_FRAMES;
+
+	{
+		int threads = 0;
+		char* env_threads = SDL_getenv("JOB_THREADS");
+		if (env_threads) threads = SDL_atoi(env_threads);
+		jobs_init(threads);
+	}
+
+	SDL_Log("Batch: %d worlds, %d updates each, on %d threads.", count, frames, jobs.active_threads);
+
+	BatchResult* results = (BatchResult*) ecalloc(count, sizeof *results);
+
+	double t = get_time();
+
+	// One world per job. Each one only writes its own result.
+	ParallelFor(count, 1, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			run_world(u64(i) + 1, frames, &results[i]);
+		}
+	});
+
+	double took = get_time() - t;
+
+	int survived = 0;
+	double death_sum = 0.0;
+	double level_sum = 0.0;
+	int max_enemies = 0;
+	double updates = 0.0;
+	int ai_count = 0;
+	double ai_points_sum = 0.0;
+	int ai_max_points = 0;
+	for (int i = 0; i < count; i++) {
+		const BatchResult* r = &results[i];
+
+		char status[32] = "survived";
+		if (r->death_frame != -1) stb_snprintf(status, sizeof(status), "died at %d", r->death_frame);
+
+		char ai[64] = "";
+		if (r->has_ai) {
+			stb_snprintf(ai, sizeof(ai), "  ai points %4d (%d-%d) wait %d/%d",
+						 r->ai_points, r->ai_min_points, r->ai_max_points, r->ai_tick_wait_timer, r->ai_tick_wait_time);
+		}
+
+		SDL_Log("  seed %-6llu %016llx  %-15s  level %2d  enemies %4d (max %4d)  %7.1fms%s",
+				(unsigned long long) r->seed, (unsigned long long) r->hash, status,
+				r->level, r->enemies, r->max_enemies, 1000.0 * r->seconds, ai);
+		if (r->death_frame == -1) {
+			survived++;
+		} else {
+			death_sum += double(r->death_frame);
+		}
+		level_sum += double(r->level);
+		max_enemies = max(max_enemies, r->max_enemies);
+		updates += double(r->frames);
+
+		if (r->has_ai) {
+			ai_count++;
+			ai_points_sum += double(r->ai_points);
+			ai_max_points = max(ai_max_points, r->ai_max_points);
+		}
+	}
+
+	SDL_Log("%d of %d survived %d updates. Average level %.2f, max enemies %d.",
+			survived, count, frames, level_sum / double(count), max_enemies);
+	if (survived < count) {
+		SDL_Log("Died at update %.0f on average.", death_sum / double(count - survived));
+	}
+	if (ai_count > 0) {
+		SDL_Log("AI director: %.1f points left on average, at most %d.", ai_points_sum / double(ai_count), ai_max_points);
+	}
+	SDL_Log("Took %.2fs, %.0f world updates per second.", took, updates / took);
+
+	bool ok = true;
+	if (report_fname) ok = write_report(report_fname, results, count);
+
+	SDL_free(results);
+	jobs_quit();
+
+	return ok ? 0 : 1;
+}
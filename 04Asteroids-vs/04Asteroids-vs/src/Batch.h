@@ -0,0 +1,41 @@
+#pragma once
+
+#include "common.h"
+
+//
+// Runs many headless worlds at once, for looking at how the stage plays out over a lot of seeds.
+//
+// Run with "--batch N [--frames N] [--report file.csv]". Doesn't open a window or load anything.
+//
+// World i gets seed i + 1 and the normal stage script, with nobody at the controls, and updates with a fixed delta
+// for BATCH_DEFAULT_FRAMES (or --frames) updates, or until the player dies. Every world runs on one job, so the
+// results don't depend on the number of threads, and the same seed gives the same world hash on every run.
+//
+// If the stage has an AI director, its numbers are read after every update, and the report has their last values
+// and the range of its points. The AI columns are empty for stages without one.
+//
+
+#define BATCH_DEFAULT_FRAMES (GAME_FPS * 60 * 5) // 5 minutes of game time
+
+struct BatchResult {
+	u64 seed;
+	u64 hash;            // world_hash() total after the last update
+	int frames;          // Updates that moved the world
+	int death_frame;     // -1 if the player made it to the end
+	int level;
+	float experience;
+	int enemies;         // Left after the last update
+	int max_enemies;
+	double seconds;      // Wall time of the world's updates
+
+	// The AI director's, if the stage has one.
+	bool has_ai;
+	int ai_points;       // After the last update
+	int ai_min_points;
+	int ai_max_points;
+	int ai_tick_wait_time;
+	int ai_tick_wait_timer;
+};
+
+// Returns the exit code: 1 if the report couldn't be written.
+int run_batch(int count, int frames, const char* report_fname);
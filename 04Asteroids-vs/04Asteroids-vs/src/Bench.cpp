@@ -0,0 +1,378 @@
+#include "Bench.h"
+
+#include "Game.h"
+#include "Font.h"
+#include "ecalloc.h"
+#include "mathh.h"
+#include "stb_sprintf.h"
+
+#define BENCH_FIND_TARGETS 100 // Objects per find_closest() call
+#define BENCH_TEXTS 8
+
+struct BenchInputs {
+	float x1[BENCH_INPUTS];
+	float y1[BENCH_INPUTS];
+	float x2[BENCH_INPUTS];
+	float y2[BENCH_INPUTS];
+	float r1[BENCH_INPUTS];
+	float r2[BENCH_INPUTS];
+	float len[BENCH_INPUTS];
+	float dir1[BENCH_INPUTS];
+	float dir2[BENCH_INPUTS];
+	float frame_index[BENCH_INPUTS];
+	float delta[BENCH_INPUTS];
+
+	Enemy* enemies;
+
+	Font font;
+	GlyphData glyphs[95];
+	const char* texts[BENCH_TEXTS];
+
+	Sprite sprite;
+
+	xoshiro256plusplus rng;
+};
+
+static BenchInputs in;
+
+// Results go here, so the compiler can't drop the calls.
+static volatile float bench_sink;
+
+#define BENCH_INDEX(i) ((i) & (BENCH_INPUTS - 1))
+
+struct Benchmark {
+	const char* name;
+	float (*func)(int calls);
+};
+
+static const Benchmark benchmarks[] = {
+	{"lengthdir_x", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			int j = BENCH_INDEX(i);
+			acc += lengthdir_x(in.len[j], in.dir1[j]);
+		}
+		return acc;
+	}},
+	{"lengthdir_y", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			int j = BENCH_INDEX(i);
+			acc += lengthdir_y(in.len[j], in.dir1[j]);
+		}
+		return acc;
+	}},
+	{"point_direction", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			int j = BENCH_INDEX(i);
+			acc += point_direction(in.x1[j], in.y1[j], in.x2[j], in.y2[j]);
+		}
+		return acc;
+	}},
+	{"angle_difference", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			int j = BENCH_INDEX(i);
+			acc += angle_difference(in.dir1[j], in.dir2[j]);
+		}
+		return acc;
+	}},
+	{"point_distance_wrapped", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			int j = BENCH_INDEX(i);
+			acc += point_distance_wrapped(in.x1[j], in.y1[j], in.x2[j], in.y2[j]);
+		}
+		return acc;
+	}},
+	{"circle_vs_circle_wrapped", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			int j = BENCH_INDEX(i);
+			acc += circle_vs_circle_wrapped(in.x1[j], in.y1[j], in.r1[j], in.x2[j], in.y2[j], in.r2[j]);
+		}
+		return acc;
+	}},
+	{"find_closest (100 objects)", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			int j = BENCH_INDEX(i);
+			float rel_x, rel_y, dist;
+			if (find_closest(in.enemies, BENCH_FIND_TARGETS, in.x1[j], in.y1[j], &rel_x, &rel_y, &dist)) {
+				acc += dist;
+			}
+		}
+		return acc;
+	}},
+	{"MeasureText", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			SDL_Point size = MeasureText(&in.font, in.texts[i % BENCH_TEXTS]);
+			acc += float(size.x + size.y);
+		}
+		return acc;
+	}},
+	{"sprite_get_next_frame_index", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			int j = BENCH_INDEX(i);
+			acc += sprite_get_next_frame_index(&in.sprite, in.frame_index[j], in.delta[j]);
+		}
+		return acc;
+	}},
+	{"random_range (float)", [](int calls) {
+		float acc = 0.0f;
+		for (int i = 0; i < calls; i++) {
+			acc += random_range(&in.rng, 0.0f, 360.0f);
+		}
+		return acc;
+	}},
+	{"random_range (int)", [](int calls) {
+		int acc = 0;
+		for (int i = 0; i < calls; i++) {
+			acc += random_range(&in.rng, 0, 99);
+		}
+		return float(acc);
+	}},
+};
+
+static void init_inputs() {
+	xoshiro256plusplus rng;
+	random_seed(&rng, 12345);
+
+	for (int i = 0; i < BENCH_INPUTS; i++) {
+		in.x1[i] = random_range(&rng, 0.0f, MAP_W);
+		in.y1[i] = random_range(&rng, 0.0f, MAP_H);
+		in.x2[i] = random_range(&rng, 0.0f, MAP_W);
+		in.y2[i] = random_range(&rng, 0.0f, MAP_H);
+		in.r1[i] = random_range(&rng, 8.0f, 64.0f);
+		in.r2[i] = random_range(&rng, 8.0f, 64.0f);
+		in.len[i] = random_range(&rng, 0.0f, 20.0f);
+		in.dir1[i] = random_range(&rng, -720.0f, 720.0f);
+		in.dir2[i] = random_range(&rng, -720.0f, 720.0f);
+		in.frame_index[i] = random_range(&rng, 0.0f, 8.0f);
+		in.delta[i] = random_range(&rng, 0.5f, 2.0f);
+	}
+
+	// Some pairs close together, so the collision checks don't always take the same branch.
+	for (int i = 0; i < BENCH_INPUTS; i += 4) {
+		in.x2[i] = in.x1[i] + random_range(&rng, -64.0f, 64.0f);
+		in.y2[i] = in.y1[i] + random_range(&rng, -64.0f, 64.0f);
+	}
+
+	in.enemies = (Enemy*) ecalloc(BENCH_FIND_TARGETS, sizeof(Enemy));
+	for (int i = 0; i < BENCH_FIND_TARGETS; i++) {
+		in.enemies[i].x = random_range(&rng, 0.0f, MAP_W);
+		in.enemies[i].y = random_range(&rng, 0.0f, MAP_H);
+	}
+
+	// Monospace-ish metrics, like the 16pt UI font.
+	for (int i = 0; i < 95; i++) {
+		GlyphData* g = &in.glyphs[i];
+		g->src = {(i % 16) * 12, (i / 16) * 20, 8 + i % 3, 14};
+		g->xoffset = 1;
+		g->yoffset = 3;
+		g->advance = 10;
+	}
+	in.font.texture = (SDL_Texture*) &in.font; // Never drawn. MeasureText() only checks that there is one.
+	in.font.ptsize = 16;
+	in.font.height = 20;
+	in.font.ascent = 16;
+	in.font.descent = -4;
+	in.font.lineskip = 21;
+	in.font.glyphs = in.glyphs;
+
+	in.texts[0] = "Score: 1234567";
+	in.texts[1] = "x3";
+	in.texts[2] = "LEVEL UP!";
+	in.texts[3] = "Money: 250\nLevel: 12";
+	in.texts[4] = "Press Enter to start";
+	in.texts[5] = "+15";
+	in.texts[6] = "Upgrade: Homing bullets\nYour bullets follow the closest enemy.";
+	in.texts[7] = "FPS: 60  Update: 1.25ms  Draw: 2.50ms";
+
+	in.sprite.frame_count = 8;
+	in.sprite.loop_frame = 2;
+	in.sprite.anim_spd = 0.25f;
+
+	random_seed(&in.rng, 67890);
+}
+
+static double get_time() {
+	return double(SDL_GetPerformanceCounter()) / double(SDL_GetPerformanceFrequency());
+}
+
+static int compare_doubles(const void* a, const void* b) {
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+static BenchResult measure(const Benchmark& b) {
+	BenchResult result = {};
+	result.name = b.name;
+
+	// Double the calls until a sample is long enough for the timer.
+	int calls = 16;
+	while (calls < (1 << 28)) {
+		double t = get_time();
+		bench_sink = b.func(calls);
+		if (get_time() - t >= BENCH_SAMPLE_SECONDS) break;
+		calls *= 2;
+	}
+	result.calls_per_sample = calls;
+
+	for (int i = 0; i < BENCH_WARMUP_SAMPLES; i++) {
+		bench_sink = b.func(calls);
+	}
+
+	double samples[BENCH_SAMPLES];
+	for (int i = 0; i < BENCH_SAMPLES; i++) {
+		double t = get_time();
+		bench_sink = b.func(calls);
+		samples[i] = (get_time() - t) * 1'000'000'000.0 / double(calls);
+	}
+
+	SDL_qsort(samples, BENCH_SAMPLES, sizeof(*samples), compare_doubles);
+	result.median_ns = samples[BENCH_SAMPLES / 2];
+
+	for (int i = 0; i < BENCH_SAMPLES; i++) {
+		samples[i] = SDL_fabs(samples[i] - result.median_ns);
+	}
+	SDL_qsort(samples, BENCH_SAMPLES, sizeof(*samples), compare_doubles);
+	result.mad_ns = samples[BENCH_SAMPLES / 2];
+
+	return result;
+}
+
+static bool save_baseline(const char* fname, const BenchResult* results, int count) {
+	SDL_RWops* f = SDL_RWFromFile(fname, "wb");
+	if (!f) {
+		SDL_Log("Couldn't open %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	char buf[256];
+	auto write = [&](const char* s) {
+		SDL_RWwrite(f, s, SDL_strlen(s), 1);
+	};
+
+	write("name,median_ns,mad_ns\n");
+	for (int i = 0; i < count; i++) {
+		stb_snprintf(buf, sizeof(buf), "%s,%.4f,%.4f\n", results[i].name, results[i].median_ns, results[i].mad_ns);
+		write(buf);
+	}
+
+	SDL_RWclose(f);
+	SDL_Log("Saved the baseline to %s.", fname);
+	return true;
+}
+
+// Fills base[i] for every results[i] that the file has. The rest get a median of 0.
+static bool load_baseline(const char* fname, const BenchResult* results, BenchResult* base, int count) {
+	usize size;
+	char* text = (char*) SDL_LoadFile(fname, &size);
+	if (!text) {
+		SDL_Log("Couldn't load %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	const char* p = SDL_strchr(text, '\n'); // Skip the header
+	p = p ? p + 1 : text + size;
+
+	while (*p) {
+		const char* comma = SDL_strchr(p, ',');
+		const char* eol = SDL_strchr(p, '\n');
+		if (!eol) eol = text + size;
+		if (!comma || comma > eol) break;
+
+		usize name_len = usize(comma - p);
+		for (int i = 0; i < count; i++) {
+			if (SDL_strlen(results[i].name) == name_len && SDL_strncmp(results[i].name, p, name_len) == 0) {
+				char* end;
+				base[i].name = results[i].name;
+				base[i].median_ns = SDL_strtod(comma + 1, &end);
+				if (*end == ',') base[i].mad_ns = SDL_strtod(end + 1, &end);
+				break;
+			}
+		}
+
+		p = (*eol) ? eol + 1 : eol;
+	}
+
+	SDL_free(text);
+	return true;
+}
+
+int run_benchmarks(const char* baseline_fname, const char* save_fname) {
+	const int count = ArrayLength(benchmarks);
+
+	init_inputs();
+
+	BenchResult results[ArrayLength(benchmarks)];
+	BenchResult base[ArrayLength(benchmarks)] = {};
+
+	SDL_Log("Benchmarks: median of %d samples after %d warmup samples, about %.0fms each.",
+			BENCH_SAMPLES, BENCH_WARMUP_SAMPLES, BENCH_SAMPLE_SECONDS * 1000.0);
+
+	for (int i = 0; i < count; i++) {
+		results[i] = measure(benchmarks[i]);
+	}
+
+	int exit_code = 0;
+	bool have_base = false;
+	if (baseline_fname) {
+		if (load_baseline(baseline_fname, results, base, count)) {
+			have_base = true;
+		} else {
+			exit_code = 1;
+		}
+	}
+
+	int slower = 0;
+	for (int i = 0; i < count; i++) {
+		const BenchResult& r = results[i];
+
+		if (!have_base) {
+			SDL_Log("  %-28s %9.2f ns/op  +- %.2f", r.name, r.median_ns, r.mad_ns);
+			continue;
+		}
+
+		if (base[i].median_ns <= 0.0) {
+			SDL_Log("  %-28s %9.2f ns/op  +- %.2f  (not in the baseline)", r.name, r.median_ns, r.mad_ns);
+			continue;
+		}
+
+		double diff = r.median_ns - base[i].median_ns;
+		double change = diff / base[i].median_ns;
+		double noise = BENCH_NOISE_MADS * max(r.mad_ns, base[i].mad_ns);
+
+		const char* verdict = "";
+		if (SDL_fabs(change) > BENCH_MIN_CHANGE && SDL_fabs(diff) > noise) {
+			if (diff > 0.0) {
+				verdict = "  SLOWER";
+				slower++;
+			} else {
+				verdict = "  faster";
+			}
+		}
+
+		SDL_Log("  %-28s %9.2f ns/op  +- %.2f  (was %.2f, %+.1f%%)%s",
+				r.name, r.median_ns, r.mad_ns, base[i].median_ns, change * 100.0, verdict);
+	}
+
+	if (have_base) {
+		SDL_Log("%d of %d benchmarks got slower than %s.", slower, count, baseline_fname);
+		if (slower > 0) exit_code = 1;
+	}
+
+	if (save_fname) {
+		if (!save_baseline(save_fname, results, count)) exit_code = 1;
+	}
+
+	SDL_free(in.enemies);
+	in.enemies = nullptr;
+
+	return exit_code;
+}
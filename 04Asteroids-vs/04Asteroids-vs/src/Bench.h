@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common.h"
+
+//
+// Micro-benchmarks for the small functions that the update loops call thousands of times a frame.
+//
+// Run with "--bench [--baseline file.csv] [--save-baseline file.csv]". Doesn't open a window or load anything.
+//
+// Every benchmark is calibrated to take about BENCH_SAMPLE_SECONDS per sample, warmed up, then sampled
+// BENCH_SAMPLES times. Results are the median and the median absolute deviation, in nanoseconds per call.
+// Inputs come from fixed-seed tables, so runs are comparable across commits on the same machine.
+//
+// With a baseline, a benchmark counts as slower if it lost more than BENCH_MIN_CHANGE and more than
+// BENCH_NOISE_MADS times its MAD, so noise on tiny functions doesn't get reported as a regression.
+//
+
+#define BENCH_INPUTS 1024             // Power of 2. Calls cycle through this many inputs.
+#define BENCH_WARMUP_SAMPLES 5
+#define BENCH_SAMPLES 31
+#define BENCH_SAMPLE_SECONDS 0.002
+#define BENCH_MIN_CHANGE 0.05
+#define BENCH_NOISE_MADS 3.0
+
+struct BenchResult {
+	const char* name;
+	double median_ns;
+	double mad_ns;
+	int calls_per_sample;
+};
+
+// Returns the exit code: 1 if something got slower than the baseline, or a file couldn't be read or written.
+int run_benchmarks(const char* baseline_fname, const char* save_fname);
@@ -0,0 +1,102 @@
+#include "CoroArena.h"
+
+#include "ecalloc.h"
+#include "mathh.h"
+#include <string.h>
+
+static void* arena_malloc(usize size, void* allocator_data) {
+	CoroArena* a = (CoroArena*) allocator_data;
+
+	if (size > a->slot_size) {
+		return nullptr;
+	}
+
+	// First free slot, so that the same sequence of allocations always gets the same slots.
+	for (int i = 0; i < a->slot_count(); i++) {
+		if (!a->used[i]) {
+			a->used[i] = true;
+			u8* slot = a->get_slot(i);
+			memset(slot, 0, a->slot_size); // For untouched_stack()
+			return slot;
+		}
+	}
+
+	if (a->slot_count() >= a->max_slots || a->block_count == CORO_ARENA_MAX_BLOCKS) {
+		return nullptr;
+	}
+
+	int i = a->slot_count();
+	a->blocks[a->block_count++] = (u8*) ecalloc(CORO_ARENA_BLOCK_SLOTS, a->slot_size);
+	a->used[i] = true;
+	return a->get_slot(i);
+}
+
+static void arena_free(void* ptr, void* allocator_data) {
+	CoroArena* a = (CoroArena*) allocator_data;
+
+	for (int b = 0; b < a->block_count; b++) {
+		u8* block = a->blocks[b];
+		if (block <= (u8*) ptr && (u8*) ptr < block + CORO_ARENA_BLOCK_SLOTS * a->slot_size) {
+			int i = b * CORO_ARENA_BLOCK_SLOTS + int(((u8*) ptr - block) / a->slot_size);
+			a->used[i] = false;
+			return;
+		}
+	}
+
+	SDL_assert(!"Coroutine wasn't allocated from this arena.");
+}
+
+void CoroArena::Init(int _max_slots) {
+	max_slots = min(_max_slots, CORO_ARENA_MAX_BLOCKS * CORO_ARENA_BLOCK_SLOTS);
+
+	// All of our coroutines use the default stack size.
+	mco_desc desc = mco_desc_init(nullptr, 0);
+	slot_size = desc.coro_size;
+
+	used = (bool*) ecalloc(CORO_ARENA_MAX_BLOCKS * CORO_ARENA_BLOCK_SLOTS, sizeof *used);
+}
+
+void CoroArena::Free() {
+	for (int i = 0; i < block_count; i++) {
+		SDL_free(blocks[i]);
+		blocks[i] = nullptr;
+	}
+	block_count = 0;
+
+	SDL_free(used);
+	used = nullptr;
+}
+
+mco_coro* CoroArena::Create(void (*func)(mco_coro*)) {
+	mco_desc desc = mco_desc_init(func, 0);
+	desc.malloc_cb = arena_malloc;
+	desc.free_cb = arena_free;
+	desc.allocator_data = this;
+
+	mco_coro* co = nullptr;
+	mco_result res = mco_create(&co, &desc);
+	if (res != MCO_SUCCESS) {
+		SDL_Log("Couldn't create coroutine: %s", mco_result_description(res));
+		return nullptr;
+	}
+
+	u8* slot = (u8*) co;
+	if (!((u8*) co->stack_base >= slot && (u8*) co->stack_base + co->stack_size <= slot + slot_size)) {
+		stacks_outside = true;
+	}
+
+	return co;
+}
+
+usize CoroArena::untouched_stack(int index) {
+	mco_coro* co = (mco_coro*) get_slot(index);
+
+	// stack_base is 16 aligned and stack_size a multiple of 16.
+	const u64* words = (const u64*) co->stack_base;
+	usize count = co->stack_size / sizeof *words;
+
+	usize i = 0;
+	while (i < count && words[i] == 0) i++;
+
+	return i * sizeof *words;
+}
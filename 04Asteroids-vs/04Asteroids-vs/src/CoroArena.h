@@ -0,0 +1,40 @@
+#pragma once
+
+#include "common.h"
+#include "minicoro.h"
+#include <SDL.h>
+
+//
+// Allocator for a world's coroutines.
+//
+// Every coroutine gets a fixed-size, zeroed slot (the whole minicoro allocation: struct, context, storage and stack).
+// Slots come in blocks that are only freed in Free(), so a coroutine's address, and every pointer into its stack,
+// stays valid for as long as the world lives. That's what lets world_save_state() copy stacks out and back in as is.
+//
+
+#define CORO_ARENA_BLOCK_SLOTS 32
+#define CORO_ARENA_MAX_BLOCKS  64
+
+struct CoroArena {
+	u8* blocks[CORO_ARENA_MAX_BLOCKS];
+	int block_count;
+	int max_slots;
+	usize slot_size;
+	bool* used; // One per slot, CORO_ARENA_MAX_BLOCKS * CORO_ARENA_BLOCK_SLOTS
+
+	// Set if minicoro put a stack outside of its slot (Windows fibers). Saving state doesn't work then.
+	bool stacks_outside;
+
+	void Init(int _max_slots);
+	void Free();
+
+	// Returns null if all max_slots are taken.
+	mco_coro* Create(void (*func)(mco_coro*));
+
+	int slot_count() { return block_count * CORO_ARENA_BLOCK_SLOTS; }
+	u8* get_slot(int index) { return blocks[index / CORO_ARENA_BLOCK_SLOTS] + usize(index % CORO_ARENA_BLOCK_SLOTS) * slot_size; }
+
+	// Bytes at the bottom of slot "index"'s stack that were never written. Slots are handed out zeroed and the stack
+	// grows down, so that's the zeroes below the first non-zero word.
+	usize untouched_stack(int index);
+};
@@ -0,0 +1,193 @@
+#include "Counters.h"
+
+#include "World.h"
+#include "Assets.h"
+#include "ecalloc.h"
+#include "mathh.h"
+#include "stb_sprintf.h"
+#include <string.h>
+
+#define COUNTER_NAME(name, str) str,
+
+const char* const counter_names[COUNTER_COUNT] = {
+	EVENT_COUNTERS(COUNTER_NAME)
+	POOL_COUNTERS(COUNTER_NAME)
+};
+
+#undef COUNTER_NAME
+
+Counters counters;
+
+thread_local CounterThread* counters_this_thread;
+static thread_local bool this_thread_failed;
+
+CounterThread* counters_get_thread() {
+	if (counters_this_thread) return counters_this_thread;
+	if (this_thread_failed) return nullptr;
+
+	int index = SDL_AtomicAdd(&counters.thread_count, 1);
+	if (index >= COUNTERS_MAX_THREADS) {
+		SDL_AtomicAdd(&counters.thread_count, -1);
+		SDL_Log("Counters: too many threads.");
+		this_thread_failed = true;
+		return nullptr;
+	}
+
+	CounterThread* t = (CounterThread*) ecalloc(1, sizeof(CounterThread));
+	SDL_AtomicSetPtr((void**) &counters.threads[index], t);
+
+	counters_this_thread = t;
+	return t;
+}
+
+static u32 sum_totals(int counter) {
+	u32 sum = 0;
+	int count = SDL_AtomicGet(&counters.thread_count);
+	for (int i = 0; i < count; i++) {
+		// Can be a few adds behind the owning thread. Those show up in the next sample.
+		CounterThread* t = (CounterThread*) SDL_AtomicGetPtr((void**) &counters.threads[i]);
+		if (t) sum += t->totals[counter];
+	}
+	return sum;
+}
+
+void counters_sample(const World* w) {
+	int slot = counters.head;
+
+	for (int i = 0; i < COUNTER_EVENT_COUNT; i++) {
+		u32 total = sum_totals(i);
+		counters.history[i][slot] = total - counters.sampled[i];
+		counters.sampled[i] = total;
+	}
+
+	if (w) {
+		counters.history[COUNTER_ENEMIES]  [slot] = u32(w->enemy_count);
+		counters.history[COUNTER_BULLETS]  [slot] = u32(w->bullet_count);
+		counters.history[COUNTER_P_BULLETS][slot] = u32(w->p_bullet_count);
+		counters.history[COUNTER_ALLIES]   [slot] = u32(w->ally_count);
+		counters.history[COUNTER_CHESTS]   [slot] = u32(w->chest_count);
+		counters.history[COUNTER_PARTICLES][slot] = u32(w->particles.particle_count);
+	} else {
+		for (int i = COUNTER_EVENT_COUNT; i < COUNTER_COUNT; i++) {
+			counters.history[i][slot] = 0;
+		}
+	}
+
+	counters.head = (counters.head + 1) % COUNTERS_HISTORY_LEN;
+	if (counters.count < COUNTERS_HISTORY_LEN) counters.count++;
+
+	if (counters.csv) {
+		char buf[32];
+		int len = stb_snprintf(buf, sizeof(buf), "%llu", (unsigned long long) counters.total_samples);
+		SDL_RWwrite(counters.csv, buf, 1, len);
+		for (int i = 0; i < COUNTER_COUNT; i++) {
+			len = stb_snprintf(buf, sizeof(buf), ",%u", counters.history[i][slot]);
+			SDL_RWwrite(counters.csv, buf, 1, len);
+		}
+		SDL_RWwrite(counters.csv, "\n", 1, 1);
+	}
+
+	counters.total_samples++;
+}
+
+u32 counters_since_sample(int counter) {
+	return sum_totals(counter) - counters.sampled[counter];
+}
+
+u32 counters_last(int counter) {
+	if (counters.count == 0) return 0;
+	int slot = (counters.head + COUNTERS_HISTORY_LEN - 1) % COUNTERS_HISTORY_LEN;
+	return counters.history[counter][slot];
+}
+
+void counters_draw_graphs(SDL_Renderer* renderer, int x, int y, int w) {
+	const int columns = 2;
+	const int graph_w = w / columns;
+	const int graph_h = 32;
+	const int label_h = 14;
+	const int cell_h  = label_h + graph_h + 4;
+	const int rows = (COUNTER_COUNT + columns - 1) / columns;
+
+	{
+		SDL_Rect back = {x, y, w, rows * cell_h};
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 192);
+		SDL_RenderFillRect(renderer, &back);
+	}
+
+	static SDL_Point points[COUNTERS_HISTORY_LEN];
+
+	for (int c = 0; c < COUNTER_COUNT; c++) {
+		int cell_x = x + (c % columns) * graph_w;
+		int cell_y = y + (c / columns) * cell_h;
+
+		u32 max_value = 0;
+		for (int i = 0; i < counters.count; i++) {
+			max_value = max(max_value, counters.history[c][i]);
+		}
+
+		char buf[64];
+		stb_snprintf(buf, sizeof(buf), "%s: %u (max %u)", counter_names[c], counters_last(c), max_value);
+		DrawText(renderer, fnt_cp437, buf, cell_x + 2, cell_y);
+
+		// Oldest on the left, the newest sample at the right edge.
+		int graph_y = cell_y + label_h;
+		int first = (counters.head + COUNTERS_HISTORY_LEN - counters.count) % COUNTERS_HISTORY_LEN;
+		for (int i = 0; i < counters.count; i++) {
+			u32 value = counters.history[c][(first + i) % COUNTERS_HISTORY_LEN];
+			int offset = COUNTERS_HISTORY_LEN - counters.count + i;
+
+			points[i].x = cell_x + 2 + offset * (graph_w - 4) / COUNTERS_HISTORY_LEN;
+			points[i].y = graph_y + graph_h - 1 - (max_value ? int(u64(value) * u64(graph_h - 1) / max_value) : 0);
+		}
+
+		if (c < COUNTER_EVENT_COUNT) {
+			SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+		} else {
+			SDL_SetRenderDrawColor(renderer, 0, 255, 255, 255);
+		}
+		if (counters.count > 1) SDL_RenderDrawLines(renderer, points, counters.count);
+	}
+}
+
+bool counters_start_csv(const char* fname) {
+	counters_stop_csv();
+
+	counters.csv = SDL_RWFromFile(fname, "wb");
+	if (!counters.csv) {
+		SDL_Log("Couldn't open %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	const char* header = "frame";
+	SDL_RWwrite(counters.csv, header, 1, strlen(header));
+	for (int i = 0; i < COUNTER_COUNT; i++) {
+		SDL_RWwrite(counters.csv, ",", 1, 1);
+		SDL_RWwrite(counters.csv, counter_names[i], 1, strlen(counter_names[i]));
+	}
+	SDL_RWwrite(counters.csv, "\n", 1, 1);
+
+	SDL_Log("Recording counters to %s", fname);
+	return true;
+}
+
+void counters_stop_csv() {
+	if (counters.csv) {
+		SDL_RWclose(counters.csv);
+		counters.csv = nullptr;
+		SDL_Log("Stopped recording counters.");
+	}
+}
+
+void counters_free() {
+	counters_stop_csv();
+
+	int count = SDL_AtomicGet(&counters.thread_count);
+	for (int i = 0; i < count; i++) {
+		SDL_free(counters.threads[i]);
+		counters.threads[i] = nullptr;
+	}
+	SDL_AtomicSet(&counters.thread_count, 0);
+
+	// Only clears the calling thread's pointer. Call this at the very end.
+	counters_this_thread = nullptr;
+}
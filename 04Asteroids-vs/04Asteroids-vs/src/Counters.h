@@ -0,0 +1,103 @@
+#pragma once
+
+#include "common.h"
+#include <SDL.h>
+
+//
+// Named counters for the hot paths, sampled once per frame into a ring buffer.
+//
+// counter_add() adds to the calling thread's own block, no atomics or locks.
+// counters_sample() sums the blocks of all threads and records how much each counter went up since the last sample,
+// plus the occupancy of the object pools. It runs at the start of the main thread's frame, so with the simulation
+// on its own thread a sample can have zero or two world updates in it.
+//
+// The pause menu shows graphs of the history, and F8 records every sample as a line of CSV, next to the frame times.
+//
+
+#define COUNTERS_MAX_THREADS 32
+#define COUNTERS_HISTORY_LEN 600 // 10 seconds at 60 fps
+
+// Counted from the hot paths.
+#define EVENT_COUNTERS(X)                           \
+	X(COLLISION_TESTS,      "collision_tests")      \
+	X(FIND_CLOSEST_CALLS,   "find_closest_calls")   \
+	X(FIND_CLOSEST_SCANNED, "find_closest_scanned") \
+	X(CORO_RESUMES,         "coro_resumes")         \
+	X(DRAW_SPRITE,          "draw_sprite")          \
+	X(RENDER_GEOMETRY,      "render_geometry")      \
+	X(PARTICLES_SPAWNED,    "particles_spawned")    \
+	X(PARTICLES_EVICTED,    "particles_evicted")    \
+	X(SOUNDS_DROPPED,       "sounds_dropped")
+
+// Filled in from the world by counters_sample().
+#define POOL_COUNTERS(X)             \
+	X(ENEMIES,   "enemies")          \
+	X(BULLETS,   "bullets")          \
+	X(P_BULLETS, "player_bullets")   \
+	X(ALLIES,    "allies")           \
+	X(CHESTS,    "chests")           \
+	X(PARTICLES, "particles")
+
+#define COUNTER_ENUM(name, str) COUNTER_##name,
+#define COUNTER_ONE(name, str) + 1
+
+enum {
+	EVENT_COUNTERS(COUNTER_ENUM)
+	POOL_COUNTERS(COUNTER_ENUM)
+
+	COUNTER_COUNT,
+	COUNTER_EVENT_COUNT = 0 EVENT_COUNTERS(COUNTER_ONE) // The pools come after the events
+};
+
+#undef COUNTER_ONE
+#undef COUNTER_ENUM
+
+extern const char* const counter_names[COUNTER_COUNT];
+
+struct CounterThread {
+	u32 totals[COUNTER_EVENT_COUNT]; // Only go up, and wrap around
+};
+
+struct Counters {
+	CounterThread* threads[COUNTERS_MAX_THREADS];
+	SDL_atomic_t thread_count;
+
+	u32 sampled[COUNTER_EVENT_COUNT]; // Sums of the totals at the last sample
+
+	u32 history[COUNTER_COUNT][COUNTERS_HISTORY_LEN]; // One column per counter
+	int head;
+	int count;
+	u64 total_samples;
+
+	SDL_RWops* csv; // Not null while recording
+};
+
+extern Counters counters;
+
+extern thread_local CounterThread* counters_this_thread;
+
+CounterThread* counters_get_thread();
+
+inline void counter_add(int counter, u32 n = 1) {
+	CounterThread* t = counters_this_thread;
+	if (!t) t = counters_get_thread();
+	if (t) t->totals[counter] += n;
+}
+
+struct World;
+
+// Call once per frame. w is the world to take the pool sizes from, can be null.
+void counters_sample(const World* w);
+
+// How much an event counter went up since the last sample, on all threads.
+u32 counters_since_sample(int counter);
+
+// The latest sample.
+u32 counters_last(int counter);
+
+void counters_draw_graphs(SDL_Renderer* renderer, int x, int y, int w);
+
+bool counters_start_csv(const char* fname);
+void counters_stop_csv();
+
+void counters_free();
@@ -0,0 +1,921 @@
+#include "DrawCapture.h"
+
+#include "Game.h"
+#include "Assets.h"
+#include "ecalloc.h"
+#include "mathh.h"
+#include "stb_sprintf.h"
+#include <string.h>
+
+const char* const draw_cmd_names[DRAW_CMD_TYPE_COUNT] = {
+	"target",
+	"logical_size",
+	"scale",
+	"clear",
+	"copy",
+	"geometry",
+	"fill_rect",
+	"draw_rect",
+	"draw_point"
+};
+
+const char* const draw_src_names[DRAW_SRC_COUNT] = {
+	"state",
+	"sprite",
+	"text",
+	"background",
+	"circle",
+	"ui",
+	"map",
+	"screen"
+};
+
+DrawCapture draw_capture;
+
+void draw_capture_request(bool spike) {
+	DrawCapture* c = &draw_capture;
+
+	if (spike) {
+		c->spike = !c->spike;
+		c->warmup_count = 0;
+		if (c->spike) {
+			SDL_Log("Draw capture: measuring %d frames, then keeping the first one that draws %.1fx slower.",
+					DRAW_CAPTURE_SPIKE_WARMUP, DRAW_CAPTURE_SPIKE_FACTOR);
+		} else {
+			SDL_Log("Draw capture: stopped waiting for a spike.");
+		}
+	} else {
+		c->requested = true;
+	}
+}
+
+static int find_texture(SDL_Texture* texture) {
+	DrawCapture* c = &draw_capture;
+
+	if (!texture) return -1;
+
+	for (int i = 0; i < c->texture_count; i++) {
+		if (c->texture_ptrs[i] == texture) return i;
+	}
+
+	if (c->texture_count == DRAW_CAPTURE_MAX_TEXTURES) {
+		c->truncated = true;
+		return -1;
+	}
+
+	int index = c->texture_count++;
+	c->texture_ptrs[index] = texture;
+
+	DrawCaptureTexture* t = &c->textures[index];
+	*t = {};
+	SDL_QueryTexture(texture, &t->format, &t->access, &t->w, &t->h);
+
+	const char* name = asset_texture_name(texture);
+	if (!name) {
+		if (texture == game->game_texture) {
+			name = "game_texture";
+		} else if (game->draw_world && texture == game->draw_world->interface_map_texture) {
+			name = "interface_map";
+		}
+	}
+	if (name) SDL_strlcpy(t->name, name, sizeof(t->name));
+
+	return index;
+}
+
+static DrawCommand* add_command(int type, int source, u64 start, u64 end) {
+	DrawCapture* c = &draw_capture;
+
+	if (c->command_count == DRAW_CAPTURE_MAX_COMMANDS) {
+		c->truncated = true;
+		return nullptr;
+	}
+
+	DrawCommand* cmd = &c->commands[c->command_count++];
+	*cmd = {};
+	cmd->type    = u8(type);
+	cmd->source  = u8(source);
+	cmd->texture = -1;
+	cmd->start   = start - c->frame_start;
+	cmd->end     = end   - c->frame_start;
+	return cmd;
+}
+
+static void get_draw_state(SDL_Renderer* renderer, DrawCommand* cmd) {
+	SDL_GetRenderDrawColor(renderer, &cmd->color.r, &cmd->color.g, &cmd->color.b, &cmd->color.a);
+
+	SDL_BlendMode blend;
+	SDL_GetRenderDrawBlendMode(renderer, &blend);
+	cmd->blend = u8(blend);
+}
+
+static void get_texture_state(SDL_Texture* texture, DrawCommand* cmd) {
+	cmd->texture = i16(find_texture(texture));
+	if (!texture) return;
+
+	SDL_GetTextureColorMod(texture, &cmd->color.r, &cmd->color.g, &cmd->color.b);
+	SDL_GetTextureAlphaMod(texture, &cmd->color.a);
+
+	SDL_BlendMode blend;
+	SDL_GetTextureBlendMode(texture, &blend);
+	cmd->blend = u8(blend);
+}
+
+int capture_copy(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect* dest,
+				 double angle, const SDL_FPoint* center, SDL_RendererFlip flip, int source) {
+	u64 start = SDL_GetPerformanceCounter();
+	int result = SDL_RenderCopyExF(renderer, texture, src, dest, angle, center, flip);
+	u64 end = SDL_GetPerformanceCounter();
+
+	DrawCommand* cmd = add_command(DRAW_CMD_COPY, source, start, end);
+	if (!cmd) return result;
+
+	get_texture_state(texture, cmd);
+
+	if (src) {
+		cmd->flags |= DRAW_CMD_HAS_SRC;
+		cmd->src = *src;
+	}
+	if (dest) {
+		cmd->flags |= DRAW_CMD_HAS_DEST;
+		cmd->dest = *dest;
+	}
+	if (center) {
+		cmd->flags |= DRAW_CMD_HAS_CENTER;
+		cmd->center = *center;
+	}
+	cmd->angle = float(angle);
+	cmd->flip = u8(flip);
+
+	return result;
+}
+
+int capture_geometry(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Vertex* vertices, int count, int source) {
+	u64 start = SDL_GetPerformanceCounter();
+	int result = SDL_RenderGeometry(renderer, texture, vertices, count, nullptr, 0);
+	u64 end = SDL_GetPerformanceCounter();
+
+	DrawCapture* c = &draw_capture;
+	if (c->vertex_count + count > DRAW_CAPTURE_MAX_VERTICES) {
+		c->truncated = true;
+		return result;
+	}
+
+	DrawCommand* cmd = add_command(DRAW_CMD_GEOMETRY, source, start, end);
+	if (!cmd) return result;
+
+	if (texture) {
+		get_texture_state(texture, cmd);
+	} else {
+		get_draw_state(renderer, cmd);
+	}
+
+	cmd->vertex_first = c->vertex_count;
+	cmd->vertex_count = count;
+	memcpy(&c->vertices[c->vertex_count], vertices, count * sizeof(*vertices));
+	c->vertex_count += count;
+
+	return result;
+}
+
+int capture_rect(SDL_Renderer* renderer, int type, const SDL_Rect* rect, int source) {
+	u64 start = SDL_GetPerformanceCounter();
+	int result = (type == DRAW_CMD_FILL_RECT) ? SDL_RenderFillRect(renderer, rect) : SDL_RenderDrawRect(renderer, rect);
+	u64 end = SDL_GetPerformanceCounter();
+
+	DrawCommand* cmd = add_command(type, source, start, end);
+	if (!cmd) return result;
+
+	get_draw_state(renderer, cmd);
+	if (rect) {
+		cmd->flags |= DRAW_CMD_HAS_DEST;
+		cmd->dest = {float(rect->x), float(rect->y), float(rect->w), float(rect->h)};
+	}
+
+	return result;
+}
+
+int capture_point(SDL_Renderer* renderer, int x, int y, int source) {
+	u64 start = SDL_GetPerformanceCounter();
+	int result = SDL_RenderDrawPoint(renderer, x, y);
+	u64 end = SDL_GetPerformanceCounter();
+
+	DrawCommand* cmd = add_command(DRAW_CMD_DRAW_POINT, source, start, end);
+	if (!cmd) return result;
+
+	get_draw_state(renderer, cmd);
+	cmd->flags |= DRAW_CMD_HAS_DEST;
+	cmd->dest = {float(x), float(y), 1.0f, 1.0f};
+
+	return result;
+}
+
+int capture_clear(SDL_Renderer* renderer, int source) {
+	u64 start = SDL_GetPerformanceCounter();
+	int result = SDL_RenderClear(renderer);
+	u64 end = SDL_GetPerformanceCounter();
+
+	DrawCommand* cmd = add_command(DRAW_CMD_CLEAR, source, start, end);
+	if (cmd) get_draw_state(renderer, cmd);
+
+	return result;
+}
+
+int capture_set_target(SDL_Renderer* renderer, SDL_Texture* texture) {
+	u64 start = SDL_GetPerformanceCounter();
+	int result = SDL_SetRenderTarget(renderer, texture);
+	u64 end = SDL_GetPerformanceCounter();
+
+	DrawCommand* cmd = add_command(DRAW_CMD_TARGET, DRAW_SRC_STATE, start, end);
+	if (cmd) cmd->texture = i16(find_texture(texture));
+
+	return result;
+}
+
+int capture_set_logical_size(SDL_Renderer* renderer, int w, int h) {
+	u64 start = SDL_GetPerformanceCounter();
+	int result = SDL_RenderSetLogicalSize(renderer, w, h);
+	u64 end = SDL_GetPerformanceCounter();
+
+	DrawCommand* cmd = add_command(DRAW_CMD_LOGICAL_SIZE, DRAW_SRC_STATE, start, end);
+	if (cmd) {
+		cmd->src.w = w;
+		cmd->src.h = h;
+	}
+
+	return result;
+}
+
+int capture_set_scale(SDL_Renderer* renderer, float x, float y) {
+	u64 start = SDL_GetPerformanceCounter();
+	int result = SDL_RenderSetScale(renderer, x, y);
+	u64 end = SDL_GetPerformanceCounter();
+
+	DrawCommand* cmd = add_command(DRAW_CMD_SCALE, DRAW_SRC_STATE, start, end);
+	if (cmd) {
+		cmd->dest.x = x;
+		cmd->dest.y = y;
+	}
+
+	return result;
+}
+
+void draw_capture_begin_frame(SDL_Renderer* renderer) {
+	DrawCapture* c = &draw_capture;
+
+	if (!c->requested && !c->spike) return;
+
+	if (!c->commands) {
+		c->commands = (DrawCommand*) ecalloc(DRAW_CAPTURE_MAX_COMMANDS, sizeof(DrawCommand));
+		c->vertices = (SDL_Vertex*) ecalloc(DRAW_CAPTURE_MAX_VERTICES, sizeof(SDL_Vertex));
+	}
+
+	c->texture_count = 0;
+	c->command_count = 0;
+	c->vertex_count = 0;
+	c->truncated = false;
+
+	// The previous frame ended on the screen, so this is the window's size.
+	SDL_GetRendererOutputSize(renderer, &c->output_w, &c->output_h);
+
+	c->frame_start = SDL_GetPerformanceCounter();
+	c->recording = true;
+
+	// The replay starts from a new renderer. Put it where this frame starts from.
+	{
+		u64 t = c->frame_start;
+
+		DrawCommand* cmd = add_command(DRAW_CMD_TARGET, DRAW_SRC_STATE, t, t);
+		cmd->texture = i16(find_texture(SDL_GetRenderTarget(renderer)));
+
+		cmd = add_command(DRAW_CMD_LOGICAL_SIZE, DRAW_SRC_STATE, t, t);
+		SDL_RenderGetLogicalSize(renderer, &cmd->src.w, &cmd->src.h);
+
+		cmd = add_command(DRAW_CMD_SCALE, DRAW_SRC_STATE, t, t);
+		SDL_RenderGetScale(renderer, &cmd->dest.x, &cmd->dest.y);
+	}
+}
+
+static bool write_capture(const char* fname, double draw_ms, u64 frame) {
+	DrawCapture* c = &draw_capture;
+
+	SDL_RWops* f = SDL_RWFromFile(fname, "wb");
+	if (!f) {
+		SDL_Log("Couldn't open %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	DrawCaptureHeader header = {};
+	header.magic         = DRAW_CAPTURE_MAGIC;
+	header.version       = DRAW_CAPTURE_VERSION;
+	header.command_size  = sizeof(DrawCommand);
+	header.output_w      = c->output_w;
+	header.output_h      = c->output_h;
+	header.texture_count = c->texture_count;
+	header.command_count = c->command_count;
+	header.vertex_count  = c->vertex_count;
+	header.truncated     = c->truncated;
+	header.frequency     = SDL_GetPerformanceFrequency();
+	header.frame         = frame;
+	header.draw_ms       = draw_ms;
+
+	SDL_RWwrite(f, &header, sizeof(header), 1);
+	SDL_RWwrite(f, c->textures, sizeof(*c->textures), c->texture_count);
+	SDL_RWwrite(f, c->commands, sizeof(*c->commands), c->command_count);
+	SDL_RWwrite(f, c->vertices, sizeof(*c->vertices), c->vertex_count);
+	SDL_RWclose(f);
+
+	SDL_Log("Draw capture: %d commands, %d vertices, %d textures, %.2fms to draw%s. Written to %s",
+			c->command_count, c->vertex_count, c->texture_count, draw_ms,
+			c->truncated ? " (ran out of room, the frame isn't all there)" : "", fname);
+	return true;
+}
+
+static int compare_double(const void* a, const void* b) {
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+void draw_capture_end_frame(double draw_ms, u64 frame) {
+	DrawCapture* c = &draw_capture;
+
+	if (!c->recording) return;
+	c->recording = false;
+
+	bool keep = false;
+
+	if (c->requested) {
+		c->requested = false;
+		keep = true;
+	} else if (c->spike) {
+		// The median is taken while recording, so the recording doesn't count as a spike.
+		if (c->warmup_count < DRAW_CAPTURE_SPIKE_WARMUP) {
+			c->warmup[c->warmup_count++] = draw_ms;
+			if (c->warmup_count == DRAW_CAPTURE_SPIKE_WARMUP) {
+				SDL_qsort(c->warmup, DRAW_CAPTURE_SPIKE_WARMUP, sizeof(*c->warmup), compare_double);
+				c->spike_threshold = c->warmup[DRAW_CAPTURE_SPIKE_WARMUP / 2] * DRAW_CAPTURE_SPIKE_FACTOR;
+				SDL_Log("Draw capture: waiting for a frame that takes over %.2fms to draw.", c->spike_threshold);
+			}
+		} else if (draw_ms > c->spike_threshold) {
+			c->spike = false;
+			keep = true;
+		}
+	}
+
+	if (keep) {
+		char fname[64];
+		stb_snprintf(fname, sizeof(fname), "drawcap_%u.bin", SDL_GetTicks());
+		write_capture(fname, draw_ms, frame);
+	}
+}
+
+void draw_capture_free() {
+	SDL_free(draw_capture.commands);
+	SDL_free(draw_capture.vertices);
+	draw_capture = {};
+}
+
+//
+// Replay.
+//
+
+struct DrawReplay {
+	const DrawCaptureHeader* header;
+	const DrawCaptureTexture* textures;
+	const DrawCommand* commands;
+	const SDL_Vertex* vertices;
+
+	SDL_Renderer* renderer;
+	SDL_Texture* replay_textures[DRAW_CAPTURE_MAX_TEXTURES];
+	bool owned[DRAW_CAPTURE_MAX_TEXTURES];
+
+	// Overdraw: a count per pixel in the red channel of each target, one more for every layer drawn over it.
+	bool overdraw;
+	SDL_Texture* counts[DRAW_CAPTURE_MAX_TEXTURES];
+	SDL_Texture* white;
+	SDL_Vertex* scratch;
+};
+
+static bool validate_capture(const void* data, usize size, DrawReplay* r) {
+	if (size < sizeof(DrawCaptureHeader)) {
+		SDL_Log("Not a draw capture.");
+		return false;
+	}
+
+	const DrawCaptureHeader* h = (const DrawCaptureHeader*) data;
+	if (h->magic != DRAW_CAPTURE_MAGIC) {
+		SDL_Log("Not a draw capture.");
+		return false;
+	}
+	if (h->version != DRAW_CAPTURE_VERSION || h->command_size != sizeof(DrawCommand)) {
+		SDL_Log("The capture is from a different build (version %u, this one reads version %u).",
+				h->version, DRAW_CAPTURE_VERSION);
+		return false;
+	}
+	if (h->texture_count < 0 || h->texture_count > DRAW_CAPTURE_MAX_TEXTURES
+		|| h->command_count < 0 || h->command_count > DRAW_CAPTURE_MAX_COMMANDS
+		|| h->vertex_count  < 0 || h->vertex_count  > DRAW_CAPTURE_MAX_VERTICES
+		|| h->output_w <= 0 || h->output_h <= 0) {
+		SDL_Log("The capture is damaged.");
+		return false;
+	}
+
+	usize expected = sizeof(DrawCaptureHeader)
+		+ usize(h->texture_count) * sizeof(DrawCaptureTexture)
+		+ usize(h->command_count) * sizeof(DrawCommand)
+		+ usize(h->vertex_count)  * sizeof(SDL_Vertex);
+	if (size != expected) {
+		SDL_Log("The capture is damaged (%u bytes, expected %u).", (u32) size, (u32) expected);
+		return false;
+	}
+
+	const u8* p = (const u8*) data + sizeof(DrawCaptureHeader);
+	r->header = h;
+	r->textures = (const DrawCaptureTexture*) p;
+	p += h->texture_count * sizeof(DrawCaptureTexture);
+	r->commands = (const DrawCommand*) p;
+	p += h->command_count * sizeof(DrawCommand);
+	r->vertices = (const SDL_Vertex*) p;
+
+	for (int i = 0; i < h->command_count; i++) {
+		const DrawCommand* cmd = &r->commands[i];
+		if (cmd->type >= DRAW_CMD_TYPE_COUNT || cmd->source >= DRAW_SRC_COUNT
+			|| cmd->texture < -1 || cmd->texture >= h->texture_count
+			|| cmd->vertex_first < 0 || cmd->vertex_count < 0
+			|| cmd->vertex_first + cmd->vertex_count > h->vertex_count) {
+			SDL_Log("The capture is damaged (command %d).", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void reset_renderer(DrawReplay* r) {
+	SDL_Renderer* renderer = r->renderer;
+	SDL_SetRenderTarget(renderer, nullptr);
+	SDL_RenderSetLogicalSize(renderer, 0, 0);
+	SDL_RenderSetScale(renderer, 1.0f, 1.0f);
+
+	if (r->overdraw) {
+		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_ADD);
+		SDL_SetRenderDrawColor(renderer, 1, 1, 1, 255);
+	} else {
+		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+	}
+}
+
+static void replay_command(DrawReplay* r, const DrawCommand* cmd) {
+	SDL_Renderer* renderer = r->renderer;
+
+	SDL_Texture* texture = (cmd->texture >= 0) ? r->replay_textures[cmd->texture] : nullptr;
+	const SDL_Rect* src = (cmd->flags & DRAW_CMD_HAS_SRC) ? &cmd->src : nullptr;
+	const SDL_FRect* dest = (cmd->flags & DRAW_CMD_HAS_DEST) ? &cmd->dest : nullptr;
+	SDL_Rect rect = {int(cmd->dest.x), int(cmd->dest.y), int(cmd->dest.w), int(cmd->dest.h)};
+
+	// Untextured draws use the draw state. In the overdraw pass it stays at adding one.
+	bool draws = (cmd->type != DRAW_CMD_TARGET && cmd->type != DRAW_CMD_LOGICAL_SIZE && cmd->type != DRAW_CMD_SCALE);
+	if (!r->overdraw && draws && !texture) {
+		SDL_SetRenderDrawColor(renderer, cmd->color.r, cmd->color.g, cmd->color.b, cmd->color.a);
+		SDL_SetRenderDrawBlendMode(renderer, (SDL_BlendMode) cmd->blend);
+	}
+
+	switch (cmd->type) {
+		case DRAW_CMD_TARGET: {
+			if (r->overdraw) texture = (cmd->texture >= 0) ? r->counts[cmd->texture] : nullptr;
+			SDL_SetRenderTarget(renderer, texture);
+			break;
+		}
+
+		case DRAW_CMD_LOGICAL_SIZE: {
+			SDL_RenderSetLogicalSize(renderer, cmd->src.w, cmd->src.h);
+			break;
+		}
+
+		case DRAW_CMD_SCALE: {
+			SDL_RenderSetScale(renderer, cmd->dest.x, cmd->dest.y);
+			break;
+		}
+
+		case DRAW_CMD_CLEAR: {
+			// A clear overwrites, so it would reset the counts.
+			if (r->overdraw) {
+				SDL_RenderFillRect(renderer, nullptr);
+			} else {
+				SDL_RenderClear(renderer);
+			}
+			break;
+		}
+
+		case DRAW_CMD_COPY: {
+			if (!texture) break;
+
+			if (r->overdraw) {
+				texture = r->white;
+				src = nullptr;
+			} else {
+				SDL_SetTextureColorMod(texture, cmd->color.r, cmd->color.g, cmd->color.b);
+				SDL_SetTextureAlphaMod(texture, cmd->color.a);
+				SDL_SetTextureBlendMode(texture, (SDL_BlendMode) cmd->blend);
+			}
+
+			const SDL_FPoint* center = (cmd->flags & DRAW_CMD_HAS_CENTER) ? &cmd->center : nullptr;
+			SDL_RenderCopyExF(renderer, texture, src, dest, double(cmd->angle), center, (SDL_RendererFlip) cmd->flip);
+			break;
+		}
+
+		case DRAW_CMD_GEOMETRY: {
+			const SDL_Vertex* vertices = &r->vertices[cmd->vertex_first];
+
+			if (r->overdraw) {
+				for (int i = 0; i < cmd->vertex_count; i++) {
+					r->scratch[i] = vertices[i];
+					r->scratch[i].color = {1, 1, 1, 255};
+				}
+				vertices = r->scratch;
+				texture = nullptr;
+			} else if (texture) {
+				SDL_SetTextureColorMod(texture, cmd->color.r, cmd->color.g, cmd->color.b);
+				SDL_SetTextureAlphaMod(texture, cmd->color.a);
+				SDL_SetTextureBlendMode(texture, (SDL_BlendMode) cmd->blend);
+			}
+
+			SDL_RenderGeometry(renderer, texture, vertices, cmd->vertex_count, nullptr, 0);
+			break;
+		}
+
+		case DRAW_CMD_FILL_RECT: {
+			SDL_RenderFillRect(renderer, dest ? &rect : nullptr);
+			break;
+		}
+
+		case DRAW_CMD_DRAW_RECT: {
+			SDL_RenderDrawRect(renderer, dest ? &rect : nullptr);
+			break;
+		}
+
+		case DRAW_CMD_DRAW_POINT: {
+			SDL_RenderDrawPoint(renderer, rect.x, rect.y);
+			break;
+		}
+	}
+}
+
+static const char* replay_texture_name(DrawReplay* r, int index) {
+	if (index < 0) return "-";
+	if (r->textures[index].name[0]) return r->textures[index].name;
+	return "?";
+}
+
+struct ReplayCost {
+	int index;
+	double ms;
+};
+
+static int compare_cost(const void* a, const void* b) {
+	double x = ((const ReplayCost*) a)->ms;
+	double y = ((const ReplayCost*) b)->ms;
+	return (x < y) - (x > y); // Most expensive first
+}
+
+static void report_timing(DrawReplay* r, const double* replay_ms) {
+	const DrawCaptureHeader* h = r->header;
+	double to_ms = 1000.0 / double(h->frequency);
+
+	struct Totals {
+		int count;
+		double game_ms;
+		double replay_ms;
+	};
+	Totals by_type[DRAW_CMD_TYPE_COUNT] = {};
+	Totals by_source[DRAW_SRC_COUNT] = {};
+	Totals total = {};
+
+	for (int i = 0; i < h->command_count; i++) {
+		const DrawCommand* cmd = &r->commands[i];
+		double game_ms = double(cmd->end - cmd->start) * to_ms;
+
+		Totals* t[3] = {&by_type[cmd->type], &by_source[cmd->source], &total};
+		for (int j = 0; j < 3; j++) {
+			t[j]->count++;
+			t[j]->game_ms += game_ms;
+			t[j]->replay_ms += replay_ms[i];
+		}
+	}
+
+	SDL_Log("                   count   game ms  replay ms");
+	for (int i = 0; i < DRAW_CMD_TYPE_COUNT; i++) {
+		if (by_type[i].count == 0) continue;
+		SDL_Log("  %-14s %7d  %8.3f  %9.3f", draw_cmd_names[i], by_type[i].count, by_type[i].game_ms, by_type[i].replay_ms);
+	}
+	for (int i = 0; i < DRAW_SRC_COUNT; i++) {
+		if (by_source[i].count == 0) continue;
+		SDL_Log("  %-14s %7d  %8.3f  %9.3f", draw_src_names[i], by_source[i].count, by_source[i].game_ms, by_source[i].replay_ms);
+	}
+	SDL_Log("  %-14s %7d  %8.3f  %9.3f", "total", total.count, total.game_ms, total.replay_ms);
+
+	{
+		// Changes between one draw and the next that a batching renderer would have to break a batch for.
+		int targets = 0;
+		int logical_sizes = 0;
+		int scales = 0;
+		int textures = 0;
+		int color_mods = 0;
+		int blends = 0;
+		int draw_colors = 0;
+
+		const DrawCommand* prev_textured = nullptr;
+		const DrawCommand* prev_untextured = nullptr;
+		int prev_blend = -1;
+
+		for (int i = 0; i < h->command_count; i++) {
+			const DrawCommand* cmd = &r->commands[i];
+
+			switch (cmd->type) {
+				case DRAW_CMD_TARGET:       targets++;       continue;
+				case DRAW_CMD_LOGICAL_SIZE: logical_sizes++; continue;
+				case DRAW_CMD_SCALE:        scales++;        continue;
+			}
+
+			if (prev_blend != -1 && cmd->blend != prev_blend) blends++;
+			prev_blend = cmd->blend;
+
+			bool textured = (cmd->type == DRAW_CMD_COPY || cmd->type == DRAW_CMD_GEOMETRY) && cmd->texture >= 0;
+			if (textured) {
+				if (prev_textured) {
+					if (cmd->texture != prev_textured->texture) {
+						textures++;
+					} else if (memcmp(&cmd->color, &prev_textured->color, sizeof(cmd->color)) != 0) {
+						color_mods++;
+					}
+				}
+				prev_textured = cmd;
+			} else {
+				if (prev_untextured && memcmp(&cmd->color, &prev_untextured->color, sizeof(cmd->color)) != 0) {
+					draw_colors++;
+				}
+				prev_untextured = cmd;
+			}
+		}
+
+		SDL_Log("state changes: %d targets, %d logical sizes, %d scales, %d textures, %d color mods (same texture), %d blend modes, %d draw colors",
+				targets, logical_sizes, scales, textures, color_mods, blends, draw_colors);
+	}
+
+	{
+		ReplayCost* costs = (ReplayCost*) ecalloc(max(h->command_count, 1), sizeof(ReplayCost));
+		for (int i = 0; i < h->command_count; i++) {
+			costs[i] = {i, replay_ms[i]};
+		}
+		SDL_qsort(costs, h->command_count, sizeof(*costs), compare_cost);
+
+		SDL_Log("most expensive in the replay:");
+		SDL_Log("      #  type         source      replay us  game us  texture                 dest");
+		int top = min(h->command_count, DRAW_REPLAY_TOP);
+		for (int i = 0; i < top; i++) {
+			const DrawCommand* cmd = &r->commands[costs[i].index];
+			SDL_Log("  %5d  %-12s %-10s %9.1f %8.1f  %-22s  %.0f,%.0f %.0fx%.0f",
+					costs[i].index, draw_cmd_names[cmd->type], draw_src_names[cmd->source],
+					costs[i].ms * 1000.0, double(cmd->end - cmd->start) * to_ms * 1000.0,
+					replay_texture_name(r, cmd->texture),
+					cmd->dest.x, cmd->dest.y, cmd->dest.w, cmd->dest.h);
+		}
+
+		SDL_free(costs);
+	}
+}
+
+static SDL_Color heat_color(int layers) {
+	static const SDL_Color ramp[] = {
+		{  0,   0,   0, 255},
+		{  0,   0, 128, 255},
+		{  0,   0, 255, 255},
+		{  0, 255, 255, 255},
+		{  0, 255,   0, 255},
+		{255, 255,   0, 255},
+		{255, 128,   0, 255},
+		{255,   0,   0, 255},
+		{255, 255, 255, 255}
+	};
+	return ramp[min(layers, (int) ArrayLength(ramp) - 1)];
+}
+
+// Reads the counts of the current target. Writes a heat map next to the capture.
+static void report_overdraw(DrawReplay* r, const char* fname, const char* target_name, int w, int h) {
+	SDL_Renderer* renderer = r->renderer;
+
+	SDL_RenderSetLogicalSize(renderer, 0, 0);
+
+	u32* pixels = (u32*) ecalloc(usize(w) * usize(h), sizeof(u32));
+	if (SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_ARGB8888, pixels, w * int(sizeof(u32))) != 0) {
+		SDL_Log("  %-14s couldn't read the pixels: %s", target_name, SDL_GetError());
+		SDL_free(pixels);
+		return;
+	}
+
+	u64 total = 0;
+	int covered = 0;
+	int deep = 0;
+	int max_layers = 0;
+
+	SDL_Surface* heat = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			int layers = (pixels[y * w + x] >> 16) & 0xFF;
+
+			total += layers;
+			if (layers > 0) covered++;
+			if (layers >= 4) deep++;
+			max_layers = max(max_layers, layers);
+
+			if (heat) {
+				SDL_Color c = heat_color(layers);
+				u32* row = (u32*) ((u8*) heat->pixels + y * heat->pitch);
+				row[x] = SDL_MapRGBA(heat->format, c.r, c.g, c.b, c.a);
+			}
+		}
+	}
+
+	char heat_fname[256];
+	stb_snprintf(heat_fname, sizeof(heat_fname), "%s.overdraw_%s.bmp", fname, target_name);
+	if (heat && SDL_SaveBMP(heat, heat_fname) != 0) {
+		SDL_Log("Couldn't write %s: %s", heat_fname, SDL_GetError());
+	}
+
+	int pixel_count = w * h;
+	SDL_Log("  %-14s %4dx%-4d  %5.2f layers per pixel, %5.2f per covered pixel, max %d%s, %4.1f%% at 4 or more -> %s",
+			target_name, w, h,
+			double(total) / double(pixel_count),
+			covered ? double(total) / double(covered) : 0.0,
+			max_layers, (max_layers == 255) ? " (saturated)" : "",
+			100.0 * double(deep) / double(pixel_count),
+			heat_fname);
+
+	if (heat) SDL_FreeSurface(heat);
+	SDL_free(pixels);
+}
+
+int draw_replay(const char* fname) {
+	usize size;
+	void* data = SDL_LoadFile(fname, &size);
+	if (!data) {
+		SDL_Log("Couldn't read %s: %s", fname, SDL_GetError());
+		return 1;
+	}
+
+	DrawReplay* r = (DrawReplay*) ecalloc(1, sizeof(DrawReplay));
+	if (!validate_capture(data, size, r)) {
+		SDL_free(r);
+		SDL_free(data);
+		return 1;
+	}
+
+	const DrawCaptureHeader* h = r->header;
+
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, h->output_w, h->output_h, 32, SDL_PIXELFORMAT_ARGB8888);
+	r->renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+	if (!r->renderer) {
+		SDL_Log("Couldn't create a software renderer: %s", SDL_GetError());
+		if (surface) SDL_FreeSurface(surface);
+		SDL_free(r);
+		SDL_free(data);
+		return 1;
+	}
+	SDL_Renderer* renderer = r->renderer;
+
+	// The assets load into whatever game->renderer is.
+	game->renderer = renderer;
+	bool assets_loaded = load_all_assets();
+
+	int blank = 0;
+	for (int i = 0; i < h->texture_count; i++) {
+		const DrawCaptureTexture* t = &r->textures[i];
+
+		SDL_Texture* texture = nullptr;
+		if (t->access == SDL_TEXTUREACCESS_TARGET) {
+			texture = SDL_CreateTexture(renderer, t->format, SDL_TEXTUREACCESS_TARGET, t->w, t->h);
+			r->owned[i] = true;
+		} else if (t->name[0]) {
+			texture = asset_find_texture(t->name);
+		}
+
+		if (!texture) {
+			// Same size, so that the pixels drawn are the same.
+			texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, max(t->w, 1), max(t->h, 1));
+			SDL_SetRenderTarget(renderer, texture);
+			SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+			SDL_RenderClear(renderer);
+			SDL_SetRenderTarget(renderer, nullptr);
+			r->owned[i] = true;
+			blank++;
+		}
+
+		r->replay_textures[i] = texture;
+	}
+
+	SDL_Log("Replaying %s: frame %llu, %dx%d, %d commands, %d vertices, %d textures, %.2fms to draw in the game.",
+			fname, (unsigned long long) h->frame, h->output_w, h->output_h,
+			h->command_count, h->vertex_count, h->texture_count, h->draw_ms);
+	if (h->truncated) SDL_Log("The capture ran out of room, the frame isn't all there.");
+	if (!assets_loaded || blank > 0) {
+		SDL_Log("%d textures are drawn blank. Run this from the game's directory to draw with the assets.", blank);
+	}
+
+	{
+		// Flushing after each command makes the software renderer do the work of that command right away.
+		double* replay_ms = (double*) ecalloc(max(h->command_count, 1), sizeof(double));
+		for (int i = 0; i < h->command_count; i++) {
+			replay_ms[i] = 1e9;
+		}
+
+		double to_ms = 1000.0 / double(SDL_GetPerformanceFrequency());
+		for (int run = 0; run < DRAW_REPLAY_RUNS; run++) {
+			reset_renderer(r);
+			for (int i = 0; i < h->command_count; i++) {
+				u64 start = SDL_GetPerformanceCounter();
+				replay_command(r, &r->commands[i]);
+				SDL_RenderFlush(renderer);
+				u64 end = SDL_GetPerformanceCounter();
+				replay_ms[i] = min(replay_ms[i], double(end - start) * to_ms);
+			}
+		}
+
+		report_timing(r, replay_ms);
+		SDL_free(replay_ms);
+	}
+
+	{
+		r->overdraw = true;
+
+		int max_vertices = 1;
+		for (int i = 0; i < h->command_count; i++) {
+			max_vertices = max(max_vertices, r->commands[i].vertex_count);
+		}
+		r->scratch = (SDL_Vertex*) ecalloc(max_vertices, sizeof(SDL_Vertex));
+
+		r->white = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 1, 1);
+		u32 white_pixel = 0xFFFFFFFF;
+		SDL_UpdateTexture(r->white, nullptr, &white_pixel, sizeof(white_pixel));
+		SDL_SetTextureBlendMode(r->white, SDL_BLENDMODE_ADD);
+		SDL_SetTextureColorMod(r->white, 1, 1, 1);
+
+		for (int i = 0; i < h->texture_count; i++) {
+			const DrawCaptureTexture* t = &r->textures[i];
+			if (t->access != SDL_TEXTUREACCESS_TARGET) continue;
+
+			r->counts[i] = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, t->w, t->h);
+			SDL_SetRenderTarget(renderer, r->counts[i]);
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+			SDL_RenderClear(renderer);
+		}
+		SDL_SetRenderTarget(renderer, nullptr);
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+		SDL_RenderClear(renderer);
+
+		reset_renderer(r);
+		for (int i = 0; i < h->command_count; i++) {
+			replay_command(r, &r->commands[i]);
+		}
+		SDL_RenderFlush(renderer);
+
+		SDL_Log("overdraw:");
+		SDL_SetRenderTarget(renderer, nullptr);
+		report_overdraw(r, fname, "screen", h->output_w, h->output_h);
+		for (int i = 0; i < h->texture_count; i++) {
+			if (!r->counts[i]) continue;
+
+			const DrawCaptureTexture* t = &r->textures[i];
+			char name[64];
+			if (t->name[0]) {
+				SDL_strlcpy(name, t->name, sizeof(name));
+			} else {
+				stb_snprintf(name, sizeof(name), "target%d", i);
+			}
+
+			SDL_SetRenderTarget(renderer, r->counts[i]);
+			report_overdraw(r, fname, name, t->w, t->h);
+		}
+		SDL_SetRenderTarget(renderer, nullptr);
+
+		for (int i = 0; i < h->texture_count; i++) {
+			if (r->counts[i]) SDL_DestroyTexture(r->counts[i]);
+		}
+		SDL_DestroyTexture(r->white);
+		SDL_free(r->scratch);
+	}
+
+	for (int i = 0; i < h->texture_count; i++) {
+		if (r->owned[i]) SDL_DestroyTexture(r->replay_textures[i]);
+	}
+	free_all_assets();
+
+	SDL_DestroyRenderer(renderer);
+	game->renderer = nullptr;
+	SDL_FreeSurface(surface);
+
+	SDL_free(r);
+	SDL_free(data);
+	return 0;
+}
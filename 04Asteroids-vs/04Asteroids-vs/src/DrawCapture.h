@@ -0,0 +1,216 @@
+#pragma once
+
+#include "common.h"
+#include <SDL.h>
+
+//
+// Records the render calls of one frame into a file, and replays such a file offline.
+//
+// The SDL calls that draw the game go through the render_* wrappers below. Normally a wrapper is just the SDL call
+// and a check of draw_capture.recording. While recording, it also notes the arguments, the state the call takes from
+// elsewhere (texture color and alpha mod, blend mode, draw color) and how long the call took on the CPU.
+//
+// F3 records the next frame into drawcap_<ticks>.bin. Shift+F3 records every frame until the draw time of one is
+// over DRAW_CAPTURE_SPIKE_FACTOR times the median of the first DRAW_CAPTURE_SPIKE_WARMUP, and keeps that one.
+//
+// SDL batches render calls, so the time of a call in the game is mostly queueing it, and the work lands on whatever
+// flushes the batch (a target switch, the present). "--replay-draw file" re-issues the calls on a software renderer,
+// flushing after each one, and logs call counts, state changes, the most expensive calls and overdraw per pixel.
+// It draws with the game's assets if it's run from the game's directory, and with blank textures if not.
+//
+
+#define DRAW_CAPTURE_MAGIC 0x50414344 // "DCAP"
+#define DRAW_CAPTURE_VERSION 1
+#define DRAW_CAPTURE_MAX_COMMANDS (1 << 16)
+#define DRAW_CAPTURE_MAX_VERTICES (1 << 18)
+#define DRAW_CAPTURE_MAX_TEXTURES 64
+#define DRAW_CAPTURE_SPIKE_WARMUP 60
+#define DRAW_CAPTURE_SPIKE_FACTOR 2.0
+#define DRAW_REPLAY_RUNS 5 // Each command keeps its fastest run
+#define DRAW_REPLAY_TOP 15
+
+enum {
+	DRAW_CMD_TARGET,
+	DRAW_CMD_LOGICAL_SIZE,
+	DRAW_CMD_SCALE,
+	DRAW_CMD_CLEAR,
+	DRAW_CMD_COPY,
+	DRAW_CMD_GEOMETRY,
+	DRAW_CMD_FILL_RECT,
+	DRAW_CMD_DRAW_RECT,
+	DRAW_CMD_DRAW_POINT,
+
+	DRAW_CMD_TYPE_COUNT
+};
+
+// What the call was drawing.
+enum {
+	DRAW_SRC_STATE,
+	DRAW_SRC_SPRITE,
+	DRAW_SRC_TEXT,
+	DRAW_SRC_BACKGROUND,
+	DRAW_SRC_CIRCLE,
+	DRAW_SRC_UI,
+	DRAW_SRC_MAP,
+	DRAW_SRC_SCREEN,
+
+	DRAW_SRC_COUNT
+};
+
+extern const char* const draw_cmd_names[DRAW_CMD_TYPE_COUNT];
+extern const char* const draw_src_names[DRAW_SRC_COUNT];
+
+enum {
+	DRAW_CMD_HAS_SRC    = 0x01,
+	DRAW_CMD_HAS_DEST   = 0x02,
+	DRAW_CMD_HAS_CENTER = 0x04
+};
+
+// Written to the file as is.
+struct DrawCommand {
+	u8 type;
+	u8 source;
+	u8 flags;
+	u8 blend;         // Of the texture, or the draw blend mode for untextured calls
+	i16 texture;      // Index into the texture table. -1 for none, or the screen for DRAW_CMD_TARGET.
+	u8 flip;
+	u8 pad;
+	SDL_Color color;  // Color and alpha mod of the texture, or the draw color
+	SDL_Rect src;     // Also the size for DRAW_CMD_LOGICAL_SIZE
+	SDL_FRect dest;   // Also the scale for DRAW_CMD_SCALE, in x and y
+	float angle;
+	SDL_FPoint center;
+	int vertex_first;
+	int vertex_count;
+	u64 start;        // SDL_GetPerformanceCounter(), from the start of the frame
+	u64 end;
+};
+
+struct DrawCaptureTexture {
+	char name[48]; // Asset path or render target name, empty if unknown
+	u32 format;
+	int access;
+	int w;
+	int h;
+};
+
+struct DrawCaptureHeader {
+	u32 magic;
+	u32 version;
+	u32 command_size; // sizeof(DrawCommand)
+	int output_w;
+	int output_h;
+	int texture_count;
+	int command_count;
+	int vertex_count;
+	u32 truncated;    // Ran out of room, the frame isn't all there
+	u64 frequency;    // SDL_GetPerformanceFrequency()
+	u64 frame;
+	double draw_ms;
+
+	// Followed by the textures, the commands and the vertices.
+};
+
+struct DrawCapture {
+	bool recording; // This frame
+	bool requested; // The next frame
+	bool spike;     // Every frame until a spike
+
+	u64 frame_start;
+	int output_w;
+	int output_h;
+
+	SDL_Texture* texture_ptrs[DRAW_CAPTURE_MAX_TEXTURES];
+	DrawCaptureTexture textures[DRAW_CAPTURE_MAX_TEXTURES];
+	int texture_count;
+
+	DrawCommand* commands;
+	int command_count;
+	SDL_Vertex* vertices;
+	int vertex_count;
+	bool truncated;
+
+	double warmup[DRAW_CAPTURE_SPIKE_WARMUP];
+	int warmup_count;
+	double spike_threshold;
+};
+
+extern DrawCapture draw_capture;
+
+void draw_capture_request(bool spike);
+
+// Around everything Game::Draw() renders, before the present.
+void draw_capture_begin_frame(SDL_Renderer* renderer);
+void draw_capture_end_frame(double draw_ms, u64 frame);
+
+void draw_capture_free();
+
+// Returns the exit code.
+int draw_replay(const char* fname);
+
+// Do the call and record it.
+int capture_copy(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect* dest,
+				 double angle, const SDL_FPoint* center, SDL_RendererFlip flip, int source);
+int capture_geometry(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Vertex* vertices, int count, int source);
+int capture_rect(SDL_Renderer* renderer, int type, const SDL_Rect* rect, int source);
+int capture_point(SDL_Renderer* renderer, int x, int y, int source);
+int capture_clear(SDL_Renderer* renderer, int source);
+int capture_set_target(SDL_Renderer* renderer, SDL_Texture* texture);
+int capture_set_logical_size(SDL_Renderer* renderer, int w, int h);
+int capture_set_scale(SDL_Renderer* renderer, float x, float y);
+
+inline int render_copy(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect* dest,
+					   int source) {
+	if (!draw_capture.recording) return SDL_RenderCopy(renderer, texture, src, dest);
+
+	SDL_FRect fdest;
+	if (dest) fdest = {float(dest->x), float(dest->y), float(dest->w), float(dest->h)};
+	return capture_copy(renderer, texture, src, dest ? &fdest : nullptr, 0.0, nullptr, SDL_FLIP_NONE, source);
+}
+
+inline int render_copy_ex(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect* dest,
+						  double angle, const SDL_FPoint* center, SDL_RendererFlip flip, int source) {
+	if (!draw_capture.recording) return SDL_RenderCopyExF(renderer, texture, src, dest, angle, center, flip);
+	return capture_copy(renderer, texture, src, dest, angle, center, flip, source);
+}
+
+inline int render_geometry(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Vertex* vertices, int count,
+						   int source) {
+	if (!draw_capture.recording) return SDL_RenderGeometry(renderer, texture, vertices, count, nullptr, 0);
+	return capture_geometry(renderer, texture, vertices, count, source);
+}
+
+inline int render_fill_rect(SDL_Renderer* renderer, const SDL_Rect* rect, int source) {
+	if (!draw_capture.recording) return SDL_RenderFillRect(renderer, rect);
+	return capture_rect(renderer, DRAW_CMD_FILL_RECT, rect, source);
+}
+
+inline int render_draw_rect(SDL_Renderer* renderer, const SDL_Rect* rect, int source) {
+	if (!draw_capture.recording) return SDL_RenderDrawRect(renderer, rect);
+	return capture_rect(renderer, DRAW_CMD_DRAW_RECT, rect, source);
+}
+
+inline int render_draw_point(SDL_Renderer* renderer, int x, int y, int source) {
+	if (!draw_capture.recording) return SDL_RenderDrawPoint(renderer, x, y);
+	return capture_point(renderer, x, y, source);
+}
+
+inline int render_clear(SDL_Renderer* renderer, int source) {
+	if (!draw_capture.recording) return SDL_RenderClear(renderer);
+	return capture_clear(renderer, source);
+}
+
+inline int render_set_target(SDL_Renderer* renderer, SDL_Texture* texture) {
+	if (!draw_capture.recording) return SDL_SetRenderTarget(renderer, texture);
+	return capture_set_target(renderer, texture);
+}
+
+inline int render_set_logical_size(SDL_Renderer* renderer, int w, int h) {
+	if (!draw_capture.recording) return SDL_RenderSetLogicalSize(renderer, w, h);
+	return capture_set_logical_size(renderer, w, h);
+}
+
+inline int render_set_scale(SDL_Renderer* renderer, float x, float y) {
+	if (!draw_capture.recording) return SDL_RenderSetScale(renderer, x, y);
+	return capture_set_scale(renderer, x, y);
+}
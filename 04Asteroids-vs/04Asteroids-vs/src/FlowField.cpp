@@ -0,0 +1,112 @@
+#include "FlowField.h"
+
+#include "World.h"
+#include "Profiler.h"
+#include "ecalloc.h"
+#include "mathh.h"
+
+struct FlowGrid {
+	int touched_count; // Cells that have ships in them, cleared by the next Build()
+	int touched[MAX_ENEMIES];
+	FlowCell cells[FLOW_W * FLOW_H];
+};
+
+static int flow_cell_x(float x) { return clamp(int(x / FLOW_CELL), 0, FLOW_W - 1); }
+static int flow_cell_y(float y) { return clamp(int(y / FLOW_CELL), 0, FLOW_H - 1); }
+
+static bool is_ship(const Enemy* e) {
+	return TYPE_ENEMY <= e->type && e->type < TYPE_BOSS;
+}
+
+void FlowField::Init() {
+	grid = (FlowGrid*) ecalloc(1, sizeof *grid);
+}
+
+void FlowField::Free() {
+	SDL_free(grid);
+	grid = nullptr;
+}
+
+void FlowField::Build(const World* w) {
+	if (!separation) return;
+
+	PROFILE_SCOPE("FlowField::Build");
+
+	FlowGrid* g = grid;
+
+	for (int i = 0; i < g->touched_count; i++) {
+		g->cells[g->touched[i]] = {};
+	}
+	g->touched_count = 0;
+
+	// In index order, so that the sums come out the same every run.
+	for (int i = 0; i < w->enemy_count; i++) {
+		const Enemy* e = &w->enemies[i];
+		if (!is_ship(e)) continue;
+
+		int cx = flow_cell_x(e->x);
+		int cy = flow_cell_y(e->y);
+		int index = cx + cy * FLOW_W;
+
+		FlowCell* c = &g->cells[index];
+		if (c->count == 0) g->touched[g->touched_count++] = index;
+		c->count++;
+		c->sum_x += e->x - float(cx) * FLOW_CELL;
+		c->sum_y += e->y - float(cy) * FLOW_CELL;
+	}
+}
+
+void FlowField::Separation(float x, float y, float* out_x, float* out_y) const {
+	*out_x = 0.0f;
+	*out_y = 0.0f;
+
+	if (!separation) return;
+
+	int cx = flow_cell_x(x);
+	int cy = flow_cell_y(y);
+
+	float push_x = 0.0f;
+	float push_y = 0.0f;
+
+	for (int j = -1; j <= 1; j++) {
+		for (int i = -1; i <= 1; i++) {
+			// Not wrapped, so that the cell's position is next to the ship's.
+			int nx = cx + i;
+			int ny = cy + j;
+			const FlowCell* c = &grid->cells[wrap(nx, FLOW_W) + wrap(ny, FLOW_H) * FLOW_W];
+
+			int count = c->count;
+			float sum_x = c->sum_x;
+			float sum_y = c->sum_y;
+
+			// Without the ship itself.
+			if (i == 0 && j == 0) {
+				count--;
+				sum_x -= x - float(cx) * FLOW_CELL;
+				sum_y -= y - float(cy) * FLOW_CELL;
+			}
+			if (count <= 0) continue;
+
+			float center_x = float(nx) * FLOW_CELL + sum_x / float(count);
+			float center_y = float(ny) * FLOW_CELL + sum_y / float(count);
+
+			float dx = x - center_x;
+			float dy = y - center_y;
+			float dist = length(dx, dy);
+			if (dist >= FLOW_SEPARATION_DIST || dist == 0.0f) continue;
+
+			float f = (1.0f - dist / FLOW_SEPARATION_DIST) * float(count);
+			push_x += dx / dist * f;
+			push_y += dy / dist * f;
+		}
+	}
+
+	float l = length(push_x, push_y);
+	if (l > 1.0f) {
+		push_x /= l;
+		push_y /= l;
+	}
+
+	*out_x = push_x;
+	*out_y = push_y;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "common.h"
+
+//
+// Steering for the ships that chase the player (TYPE_ENEMY up to TYPE_BOSS).
+//
+// The way to the player is the shortest of its wrapped copies, which is one subtraction and one round per axis
+// (wrapped_delta() in World.h), instead of find_closest()'s 9 checks. The ships steer along that vector instead of
+// turning it into an angle and back. With a single target the direction "field" is just that vector, so it isn't
+// tabulated, sampling a grid would only make it coarser.
+//
+// For separation, Build() sorts the ships into a coarse grid over the map once per update, keeping the count and
+// the sum of the positions per cell. A ship pushes away from the ships around it by looking at the 3x3 cells around
+// it, instead of at every other ship. SHIP_SEPARATION=1 turns it on.
+//
+
+#define FLOW_CELL 125.0f
+#define FLOW_W int(MAP_W / FLOW_CELL)
+#define FLOW_H int(MAP_H / FLOW_CELL)
+
+#define FLOW_SEPARATION_DIST 100.0f
+#define FLOW_SEPARATION_ACC 0.2f
+
+struct World;
+
+struct FlowCell {
+	int count;
+	float sum_x; // From the cell's corner, to keep the precision
+	float sum_y;
+};
+
+// The cells and the list of the ones in use. On the heap, so that loading a world state doesn't get the two
+// out of sync.
+struct FlowGrid;
+
+struct FlowField {
+	bool separation; // Set before World::Init
+	FlowGrid* grid;
+
+	void Init();
+	void Free();
+
+	// Before the enemies update. Does nothing without separation.
+	void Build(const World* w);
+
+	// Direction to push the ship at (x, y) away from the others, up to 1 long.
+	void Separation(float x, float y, float* out_x, float* out_y) const;
+};
@@ -1,7 +1,8 @@
 #include "Font.h"
 
+#include "DrawCapture.h"
+
 #include <SDL_ttf.h>
-#include <stdlib.h> // for calloc
 
 SDL_Point DrawText(SDL_Renderer* renderer, Font* font, const char* text,
 				   int x, int y,
@@ -68,7 +69,7 @@ SDL_Point DrawText(SDL_Renderer* renderer, Font* font, const char* text,
 			dest.w = int(float(src.w) * xscale);
 			dest.h = int(float(src.h) * yscale);
 
-			SDL_RenderCopy(renderer, font->texture, &src, &dest);
+			render_copy(renderer, font->texture, &src, &dest, DRAW_SRC_TEXT);
 		}
 
 		text_x += int(float(glyph->advance) * xscale);
@@ -160,7 +161,7 @@ bool LoadFontFromFileTTF(SDL_Renderer* renderer, Font* font, const char* fname,
 		TTF_SetFontStyle(ttf_font, style);
 
 		font->ptsize = ptsize;
-		font->glyphs = (GlyphData*) calloc(95, sizeof(*font->glyphs));
+		font->glyphs = (GlyphData*) SDL_calloc(95, sizeof(*font->glyphs));
 
 		if (!font->glyphs) {
 			error = true;
@@ -251,6 +252,6 @@ void DestroyFont(Font* font) {
 	if (font->texture) SDL_DestroyTexture(font->texture);
 	font->texture = nullptr;
 
-	if (font->glyphs) free(font->glyphs);
+	if (font->glyphs) SDL_free(font->glyphs);
 	font->glyphs = nullptr;
 }
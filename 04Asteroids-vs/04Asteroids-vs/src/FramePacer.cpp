@@ -0,0 +1,139 @@
+#include "FramePacer.h"
+
+#include "mathh.h"
+#include <SDL.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#elif defined(__linux__)
+#include <time.h>
+#include <errno.h>
+#endif
+
+static double GetTime() {
+	return double(SDL_GetPerformanceCounter()) / double(SDL_GetPerformanceFrequency());
+}
+
+static void os_sleep(FramePacer* p, double seconds) {
+#ifdef _WIN32
+	if (p->timer) {
+		LARGE_INTEGER due;
+		due.QuadPart = -LONGLONG(seconds * 10'000'000.0); // Relative, in 100ns units
+		if (SetWaitableTimer(p->timer, &due, 0, nullptr, nullptr, FALSE)) {
+			WaitForSingleObject(p->timer, INFINITE);
+			return;
+		}
+	}
+	Sleep(DWORD(seconds * 1000.0));
+#elif defined(__linux__)
+	timespec ts;
+	ts.tv_sec  = time_t(seconds);
+	ts.tv_nsec = long((seconds - double(ts.tv_sec)) * 1'000'000'000.0);
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {}
+#else
+	SDL_Delay(u32(seconds * 1000.0));
+#endif
+}
+
+void FramePacer::Init() {
+#ifdef _WIN32
+	// Only on Windows 10 1803 and newer. Otherwise falls back to Sleep().
+	timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+
+	// Calibrate.
+	double worst = 0.0;
+	for (int i = 0; i < 8; i++) {
+		double t = GetTime();
+		os_sleep(this, 0.001);
+		worst = max(worst, GetTime() - t);
+	}
+
+	sleep_granularity = worst;
+	spin_margin = clamp(worst - 0.001 + FRAME_PACER_MIN_MARGIN, FRAME_PACER_MIN_MARGIN, FRAME_PACER_MAX_MARGIN);
+
+	SDL_Log("Frame pacer: 1ms sleep takes up to %.3fms, spin margin %.3fms.", worst * 1000.0, spin_margin * 1000.0);
+}
+
+void FramePacer::Quit() {
+	SDL_Log("Frame pacer: average error %.3fms, max error %.3fms, spinning %.1f%% of the wait, %d missed deadlines.",
+			avg_error * 1000.0, max_error * 1000.0, spin_fraction * 100.0, missed_total);
+
+#ifdef _WIN32
+	if (timer) CloseHandle(timer);
+	timer = nullptr;
+#endif
+}
+
+static void add_sample(FramePacer* p, double error, bool missed) {
+	p->error_sum += error;
+	p->error_max = max(p->error_max, error);
+	p->missed_sum += int(missed);
+	p->missed_total += int(missed);
+	p->frames++;
+
+	if (p->frames >= FRAME_PACER_REPORT_FRAMES) {
+		double wait = p->sleep_sum + p->spin_sum;
+
+		p->avg_error = p->error_sum / double(p->frames);
+		p->max_error = p->error_max;
+		p->spin_fraction = (wait > 0.0) ? p->spin_sum / wait : 0.0;
+		p->missed = p->missed_sum;
+
+		p->error_sum = 0.0;
+		p->error_max = 0.0;
+		p->sleep_sum = 0.0;
+		p->spin_sum  = 0.0;
+		p->missed_sum = 0;
+		p->frames = 0;
+	}
+}
+
+void FramePacer::Wait(double period) {
+	double t = GetTime();
+
+	// Not called for a while: the first frame, or vsync was on. Nothing to be late for.
+	bool resumed = (t - last_wait > 2.0 * period);
+
+	deadline += period;
+	if (t >= deadline || resumed) {
+		if (!resumed) add_sample(this, t - deadline, true);
+
+		deadline = t;
+		last_wait = t;
+		return;
+	}
+
+	double sleep_time = (deadline - t) - spin_margin;
+	if (sleep_time > 0.0) {
+		os_sleep(this, sleep_time);
+
+		double now = GetTime();
+		double oversleep = (now - t) - sleep_time;
+
+		double target = clamp(oversleep + FRAME_PACER_MIN_MARGIN, FRAME_PACER_MIN_MARGIN, FRAME_PACER_MAX_MARGIN);
+		if (target > spin_margin) {
+			spin_margin = target;
+		} else {
+			spin_margin += (target - spin_margin) * 0.02;
+		}
+
+		sleep_sum += now - t;
+		t = now;
+	}
+
+	double spin_start = t;
+	while (t < deadline) {
+		SDL_CPUPauseInstruction();
+		t = GetTime();
+	}
+	spin_sum += t - spin_start;
+
+	add_sample(this, t - deadline, false);
+	last_wait = t;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "common.h"
+
+//
+// Frame limiter for when vsync is off.
+//
+// Sleeps with the OS until "spin_margin" before the deadline, then spins for the rest.
+// The margin starts at the oversleep measured in Init() and follows the oversleep of every wait after that
+// (grows right away, shrinks slowly), so on a system with a precise timer we barely spin at all.
+//
+// Deadlines are spaced exactly one period apart, so the average framerate doesn't drift.
+// If a frame runs late, the schedule restarts from the current time instead of rushing to catch up. The lateness
+// counts towards the error and the frame as a missed deadline, unless pacing was off in between (vsync was on).
+//
+
+#define FRAME_PACER_MIN_MARGIN 0.0002 // Seconds
+#define FRAME_PACER_MAX_MARGIN 0.02
+#define FRAME_PACER_REPORT_FRAMES 60  // Metrics are averaged over this many frames
+
+struct FramePacer {
+	double spin_margin;
+	double sleep_granularity; // Worst time a 1ms sleep took during Init()
+	double deadline;
+	double last_wait;         // When the previous Wait() returned
+
+	// How late we woke up relative to the deadline, or got there if it had passed. In seconds, updated every
+	// FRAME_PACER_REPORT_FRAMES frames.
+	double avg_error;
+	double max_error;
+	double spin_fraction; // Part of the waiting time spent spinning instead of sleeping
+	int missed;           // Deadlines that had passed before Wait() was called, over the same frames
+	int missed_total;
+
+	double error_sum;
+	double error_max;
+	double sleep_sum;
+	double spin_sum;
+	int missed_sum;
+	int frames;
+
+	void* timer; // High resolution waitable timer on Windows
+
+	void Init();
+	void Quit();
+
+	// Waits until one period after the previous deadline.
+	void Wait(double period);
+};
@@ -0,0 +1,112 @@
+#include "FrameTimes.h"
+
+#include "stb_sprintf.h"
+#include <string.h>
+
+void FrameTimes::Add(const FrameTimeSample& s) {
+	samples[head] = s;
+	head = (head + 1) % FRAME_TIMES_LEN;
+	if (count < FRAME_TIMES_LEN) count++;
+
+	if (csv) {
+		char buf[128];
+		int len = stb_snprintf(buf, sizeof(buf), "%llu,%.3f,%.3f,%.3f,%.3f\n",
+							   (unsigned long long) total_frames, s.frame, s.update, s.draw, s.present);
+		SDL_RWwrite(csv, buf, 1, len);
+	}
+
+	total_frames++;
+}
+
+static int compare_double(const void* a, const void* b) {
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+FrameTimePercentiles FrameTimes::Compute(double FrameTimeSample::* field) {
+	FrameTimePercentiles result = {};
+	if (count == 0) return result;
+
+	static double sorted[FRAME_TIMES_LEN];
+	for (int i = 0; i < count; i++) {
+		sorted[i] = samples[i].*field;
+	}
+	SDL_qsort(sorted, count, sizeof(*sorted), compare_double);
+
+	// Nearest rank.
+	auto percentile = [&](int p) {
+		int rank = (p * count + 99) / 100;
+		if (rank < 1) rank = 1;
+		return sorted[rank - 1];
+	};
+
+	result.p50 = percentile(50);
+	result.p95 = percentile(95);
+	result.p99 = percentile(99);
+	result.max = sorted[count - 1];
+	return result;
+}
+
+void FrameTimes::DrawHistogram(SDL_Renderer* renderer, int x, int y, int w, int h) {
+	int buckets[FRAME_TIMES_BUCKETS] = {};
+	int max_bucket = 1;
+
+	for (int i = 0; i < count; i++) {
+		int b = int(samples[i].frame / FRAME_TIMES_BUCKET_MS);
+		if (b < 0) b = 0;
+		if (b >= FRAME_TIMES_BUCKETS) b = FRAME_TIMES_BUCKETS - 1;
+		buckets[b]++;
+		if (buckets[b] > max_bucket) max_bucket = buckets[b];
+	}
+
+	SDL_Rect back = {x, y, w, h};
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 192);
+	SDL_RenderFillRect(renderer, &back);
+
+	int bar_w = w / FRAME_TIMES_BUCKETS;
+	for (int i = 0; i < FRAME_TIMES_BUCKETS; i++) {
+		if (buckets[i] == 0) continue;
+
+		SDL_Rect rect;
+		rect.w = bar_w - 1;
+		rect.h = (buckets[i] * h + max_bucket - 1) / max_bucket;
+		rect.x = x + i * bar_w;
+		rect.y = y + h - rect.h;
+
+		// Green up to 60 fps, yellow up to 30, red after that.
+		double ms = double(i) * FRAME_TIMES_BUCKET_MS;
+		if (ms < 1000.0 / 60.0) {
+			SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+		} else if (ms < 1000.0 / 30.0) {
+			SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+		} else {
+			SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+		}
+		SDL_RenderFillRect(renderer, &rect);
+	}
+}
+
+bool FrameTimes::StartCSV(const char* fname) {
+	StopCSV();
+
+	csv = SDL_RWFromFile(fname, "wb");
+	if (!csv) {
+		SDL_Log("Couldn't open %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	const char* header = "frame,frame_ms,update_ms,draw_ms,present_ms\n";
+	SDL_RWwrite(csv, header, 1, strlen(header));
+
+	SDL_Log("Recording frame times to %s", fname);
+	return true;
+}
+
+void FrameTimes::StopCSV() {
+	if (csv) {
+		SDL_RWclose(csv);
+		csv = nullptr;
+		SDL_Log("Stopped recording frame times.");
+	}
+}
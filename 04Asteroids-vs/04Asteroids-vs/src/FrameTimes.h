@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.h"
+#include <SDL.h>
+
+//
+// Rolling record of the last FRAME_TIMES_LEN frames, for stutter metrics.
+// Times are in milliseconds.
+//
+
+#define FRAME_TIMES_LEN 1024
+#define FRAME_TIMES_BUCKETS 40 // Histogram buckets, FRAME_TIMES_BUCKET_MS each. The last one takes everything above.
+#define FRAME_TIMES_BUCKET_MS 1.0
+
+struct FrameTimeSample {
+	double frame;   // From the start of the previous frame to the start of this one
+	double update;
+	double draw;
+	double present;
+};
+
+struct FrameTimePercentiles {
+	double p50;
+	double p95;
+	double p99;
+	double max;
+};
+
+struct FrameTimes {
+	FrameTimeSample samples[FRAME_TIMES_LEN];
+	int count;
+	int head;
+	u64 total_frames;
+
+	SDL_RWops* csv; // Not null while recording
+
+	void Add(const FrameTimeSample& s);
+
+	FrameTimePercentiles Compute(double FrameTimeSample::* field);
+
+	// Histogram of the whole frame times.
+	void DrawHistogram(SDL_Renderer* renderer, int x, int y, int w, int h);
+
+	// Every frame added from now on is written as a line of CSV.
+	bool StartCSV(const char* fname);
+	void StopCSV();
+};
@@ -1,480 +1,883 @@
-#include "Game.h"
-
-#include "Assets.h"
-#include "Audio.h"
-#include "stb_sprintf.h"
-#include "mathh.h"
-#include <string.h>
-
-Game* game;
-
-static double GetTime() {
-	return double(SDL_GetPerformanceCounter()) / double(SDL_GetPerformanceFrequency());
-}
-
-void Game::Init() {
-	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_VERBOSE);
-	SDL_Log("Starting game...");
-
-	SDL_SetHint(SDL_HINT_WINDOWS_DPI_AWARENESS, "system");
-
-	if (SDL_Init(SDL_INIT_AUDIO
-				 | SDL_INIT_VIDEO) != 0) {
-		ERROR("Couldn't initialize SDL: %s", SDL_GetError());
-	}
-
-	// Mix_Init(0);
-
-	SDL_Rect display;
-	SDL_GetDisplayUsableBounds(0, &display);
-	int window_w = GAME_W;
-	int window_h = GAME_H;
-	if (display.w < window_w || display.h < window_h) {
-		window_w /= 2;
-		window_h /= 2;
-	}
-
-	window = SDL_CreateWindow("Asteroids",
-							  SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-							  window_w, window_h,
-							  SDL_WINDOW_RESIZABLE);
-	SDL_SetWindowMinimumSize(window, GAME_W / 2, GAME_H / 2);
-
-	renderer = SDL_CreateRenderer(window, -1, 0);
-	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-
-	SDL_RendererInfo info;
-	SDL_GetRendererInfo(renderer, &info);
-	if (strcmp(info.name, "direct3d") == 0) {
-		SDL_SetHint(SDL_HINT_VIDEO_MINIMIZE_ON_FOCUS_LOSS, "0");
-		SDL_Log("Using SDL_VIDEO_MINIMIZE_ON_FOCUS_LOSS=0 workaround...");
-	}
-
-	Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 2048);
-	Mix_Volume(-1, int(0.25f * float(MIX_MAX_VOLUME)));
-
-	if (!load_all_assets()) {
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION,
-								 "[INFO]",
-								 "An error occured while loading game assets.",
-								 nullptr);
-	}
-
-	state = GameState::PLAYING;
-	world = &world_instance;
-	world->Init();
-
-	prev_time = GetTime();
-}
-
-void Game::Quit() {
-	switch (state) {
-		case GameState::PLAYING: {
-			world->Quit();
-			break;
-		}
-	}
-
-	free_all_assets();
-
-	if (game_texture) SDL_DestroyTexture(game_texture);
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(window);
-
-	// Mix_Quit();
-	SDL_Quit();
-
-	SDL_Log("Game finished.");
-}
-
-void Game::Run() {
-	while (!quit) {
-		Frame();
-	}
-}
-
-void Game::Frame() {
-	double t = GetTime();
-	double frame_end_time = t + (1.0 / double(fps_cap));
-
-	double elapsed = t - prev_time;
-	fps = 1.0 / elapsed;
-	prev_time = t;
-
-	skip_frame = frame_advance;
-	memset(key_pressed, 0, sizeof(key_pressed));
-
-	SDL_Event ev;
-	while (SDL_PollEvent(&ev)) {
-		switch (ev.type) {
-			case SDL_QUIT: {
-				quit = true;
-				break;
-			}
-
-			case SDL_KEYDOWN: {
-				int scancode = ev.key.keysym.scancode;
-
-				if (0 <= scancode && scancode < ArrayLength(key_pressed)) {
-					key_pressed[scancode] = true;
-				}
-
-				switch (scancode) {
-					case SDL_SCANCODE_F4: {
-						if (ev.key.keysym.mod == 0) {
-							set_fullscreen(!get_fullscreen());
-						}
-						break;
-					}
-
-					case SDL_SCANCODE_F5: {
-						frame_advance = true;
-						skip_frame = false;
-						break;
-					}
-
-					case SDL_SCANCODE_F6: {
-						frame_advance = false;
-						break;
-					}
-				}
-				break;
-			}
-		}
-	}
-
-	float delta;
-	if (get_vsync()) {
-		delta = (float) (elapsed * double(GAME_FPS));
-		delta = clamp(delta, 0.1f, 10.0f);
-	} else {
-		delta = float(GAME_FPS) / float(fps_cap);
-	}
-
-	Update(delta);
-	Draw(delta);
-
-#ifndef __EMSCRIPTEN__
-	{
-		if (!get_vsync()) {
-			t = GetTime();
-			double time_left = frame_end_time - t;
-			if (time_left > 0.0) {
-				SDL_Delay(u32(time_left * (0.95 * 1000.0)));
-				while (GetTime() < frame_end_time) {}
-			}
-		}
-	}
-#endif
-
-	if (sleep_ms > 0) {
-		SDL_Delay(sleep_ms);
-		sleep_ms = 0;
-	}
-}
-
-void Game::Update(float delta) {
-	double t = GetTime();
-
-	if (!skip_frame) {
-		switch (state) {
-			case GameState::PLAYING: {
-				world->Update(delta);
-				break;
-			}
-		}
-	}
-
-	update_took = 1000.0 * (GetTime() - t);
-}
-
-void Game::Draw(float delta) {
-	double t = GetTime();
-
-	{
-		int window_w;
-		int window_h;
-		SDL_GetWindowSize(window, &window_w, &window_h);
-
-		// Decide on game texture size.
-
-		// game_texture_w = window_w;
-		// game_texture_h = window_h;
-
-		// game_texture_h = GAME_H;
-		// game_texture_w = (int) (float(game_texture_h) / float(window_h) * float(window_w));
-
-		game_texture_w = GAME_W;
-		game_texture_h = GAME_H;
-
-		camera_base_h = GAME_H;
-		camera_base_w = (int) (float(camera_base_h) / float(game_texture_h) * float(game_texture_w));
-
-		int w;
-		int h;
-		if (game_texture) SDL_QueryTexture(game_texture, nullptr, nullptr, &w, &h);
-		if (!game_texture || w != game_texture_w || h != game_texture_h) {
-			if (game_texture) SDL_DestroyTexture(game_texture);
-			game_texture = SDL_CreateTexture(renderer,
-											 SDL_PIXELFORMAT_XRGB8888, SDL_TEXTUREACCESS_TARGET,
-											 game_texture_w, game_texture_h);
-		}
-		SDL_SetTextureScaleMode(game_texture,
-								options.bilinear_filter ? SDL_ScaleModeLinear : SDL_ScaleModeNearest);
-
-		ui_w = game_texture_w / ui_scale;
-		ui_h = game_texture_h / ui_scale;
-	}
-
-	{
-		SDL_SetRenderTarget(renderer, nullptr);
-		SDL_RenderSetLogicalSize(renderer, ui_w, ui_h);
-
-		int mouse_x;
-		int mouse_y;
-		u32 mouse = SDL_GetMouseState(&mouse_x, &mouse_y);
-		SDL_RenderWindowToLogical(renderer, mouse_x, mouse_y, &ui_mouse_x, &ui_mouse_y);
-	}
-
-	{
-		SDL_SetRenderTarget(renderer, game_texture);
-
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-		SDL_RenderClear(renderer);
-
-		// Render game world.
-		SDL_RenderSetLogicalSize(renderer, camera_base_w, camera_base_h);
-
-		switch (state) {
-			case GameState::PLAYING: {
-				world->Draw(delta);
-				break;
-			}
-		}
-
-		// Render UI.
-		SDL_RenderSetLogicalSize(renderer, ui_w, ui_h);
-
-		switch (state) {
-			case GameState::PLAYING: {
-				world->DrawUI(delta);
-				break;
-			}
-		}
-
-		// Draw FPS.
-		{
-			char buf[32];
-			if (get_vsync()) {
-				stb_snprintf(buf, sizeof(buf), "%.2f V", fps);
-			} else {
-				stb_snprintf(buf, sizeof(buf), "%.2f", fps);
-			}
-			DrawText(renderer, fnt_cp437, buf, ui_w, ui_h, HALIGN_RIGHT, VALIGN_BOTTOM);
-		}
-	}
-
-	SDL_SetRenderTarget(renderer, nullptr);
-
-	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-	SDL_RenderClear(renderer);
-
-	if (options.letterbox) {
-		SDL_RenderSetLogicalSize(renderer, game_texture_w, game_texture_h);
-	} else {
-		SDL_RenderSetLogicalSize(renderer, 0, 0);
-	}
-
-	// Render game texture.
-	SDL_RenderCopy(renderer, game_texture, nullptr, nullptr);
-
-	SDL_RenderSetLogicalSize(renderer, 0, 0);
-
-	int x = 0;
-	int y = 300;
-	if (show_debug_info) {
-		char buf[100];
-		stb_snprintf(buf, sizeof(buf),
-					 "update: %.2fms\n"
-					 "draw: %.2fms\n",
-					 update_took,
-					 draw_took);
-		y = DrawText(renderer, fnt_mincho, buf, x, y).y;
-		if (state == GameState::PLAYING) {
-			char buf[100];
-			stb_snprintf(buf, sizeof(buf),
-						 "enemies: %d (%d all)\n"
-						 "bullets: %d\n"
-						 "player bullets: %d\n"
-						 "allies: %d\n"
-						 "chests: %d\n"
-						 "particles: %d\n",
-						 world->get_enemy_count(), world->enemy_count,
-						 world->bullet_count,
-						 world->p_bullet_count,
-						 world->ally_count,
-						 world->chest_count,
-						 world->particles.particle_count);
-			y = DrawText(renderer, fnt_mincho, buf, x, y).y;
-			if (world->ai_points) {
-				char buf[50];
-				stb_snprintf(buf, sizeof buf,
-							 "ai points: %d\n"
-							 "ai wait time: %d\n"
-							 "ai wait timer: %d\n",
-							 *world->ai_points,
-							 *world->ai_tick_wait_time,
-							 *world->ai_tick_wait_timer);
-				y = DrawText(renderer, fnt_mincho, buf, x, y).y;
-			}
-		}
-		y += 10;
-	}
-	if (show_audio_channels) {
-		// draw audio channels
-
-		for (int i = 0; i < Mix_AllocateChannels(-1); i++) {
-			const char* name = "";
-			Mix_Chunk* chunk = Mix_GetChunk(i);
-			for (int j = 0; j < SOUND_COUNT; j++) {
-				if (chunk == Chunks[j]) {
-					name = Chunk_Names[j];
-					break;
-				}
-			}
-			char buf[100];
-			stb_snprintf(buf, sizeof(buf), "%d %u %d %s\n", i, channel_when_played[i], channel_priority[i], name);
-			SDL_Color col = Mix_Playing(i) ? SDL_Color{255, 255, 255, 255} : SDL_Color{128, 128, 128, 255};
-			y = DrawText(renderer, fnt_mincho, buf, x, y, 0, 0, col).y;
-		}
-	}
-
-	draw_took = 1000.0 * (GetTime() - t);
-
-	SDL_RenderPresent(renderer);
-}
-
-void Game::sleep(float x, float y, u32 ms) {
-	if (!is_on_screen(x, y)) {
-		return;
-	}
-	sleep_ms = max(sleep_ms, ms);
-}
-
-void Game::set_audio3d(bool enable) {
-	options.audio_3d = enable;
-	// @Hack
-	int vol = Mix_Volume(0, -1);
-	Mix_AllocateChannels(0);
-	Mix_AllocateChannels(MIX_CHANNELS);
-	Mix_Volume(-1, vol);
-	memset(channel_when_played, 0, sizeof(channel_when_played));
-	memset(channel_priority, 0, sizeof(channel_priority));
-}
-
-void Game::set_vsync(bool enable) {
-#ifndef __EMSCRIPTEN__
-	SDL_RenderSetVSync(renderer, enable);
-#endif
-}
-
-bool Game::get_vsync() {
-#ifdef __EMSCRIPTEN__
-	return true;
-#else
-	SDL_RendererInfo info;
-	SDL_GetRendererInfo(renderer, &info);
-	return (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
-#endif
-}
-
-void Game::set_fullscreen(bool enable) {
-	if (enable) {
-		SDL_DisplayMode mode;
-		SDL_GetDesktopDisplayMode(SDL_GetWindowDisplayIndex(window), &mode);
-		SDL_SetWindowDisplayMode(window, &mode);
-		SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
-	} else {
-		SDL_SetWindowFullscreen(window, 0);
-	}
-}
-
-bool Game::get_fullscreen() {
-	return (SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN) != 0;
-}
-
-float point_distance_wrapped(float x1, float y1, float x2, float y2) {
-	float dist = INFINITY;
-	float d;
-
-	d = point_distance(x1 - MAP_W, y1 - MAP_H, x2, y2); if (d < dist) dist = d;
-	d = point_distance(x1,         y1 - MAP_H, x2, y2); if (d < dist) dist = d;
-	d = point_distance(x1 + MAP_W, y1 - MAP_H, x2, y2); if (d < dist) dist = d;
-
-	d = point_distance(x1 - MAP_W, y1,         x2, y2); if (d < dist) dist = d;
-	d = point_distance(x1,         y1,         x2, y2); if (d < dist) dist = d;
-	d = point_distance(x1 + MAP_W, y1,         x2, y2); if (d < dist) dist = d;
-
-	d = point_distance(x1 - MAP_W, y1 + MAP_H, x2, y2); if (d < dist) dist = d;
-	d = point_distance(x1,         y1 + MAP_H, x2, y2); if (d < dist) dist = d;
-	d = point_distance(x1 + MAP_W, y1 + MAP_H, x2, y2); if (d < dist) dist = d;
-
-	return dist;
-}
-
-bool is_on_screen(float x, float y) {
-	// float center_x = world->camera_x;
-	// float center_y = world->camera_y;
-	// float dist = point_distance_wrapped(x, y, center_x, center_y);
-	// return dist < DIST_OFFSCREEN;
-
-	x -= world->camera_left;
-	y -= world->camera_top;
-
-	auto check = [](float x, float y) {
-		float off = 100.0f;
-		return (-off <= x && x < world->camera_w + off)
-			&& (-off <= y && y < world->camera_h + off);
-	};
-
-	bool result = false;
-
-	result |= check(x - MAP_W, y - MAP_H);
-	result |= check(x,         y - MAP_H);
-	result |= check(x + MAP_W, y - MAP_H);
-
-	result |= check(x - MAP_W, y);
-	result |= check(x,         y);
-	result |= check(x + MAP_W, y);
-
-	result |= check(x - MAP_W, y + MAP_H);
-	result |= check(x,         y + MAP_H);
-	result |= check(x + MAP_W, y + MAP_H);
-
-	return result;
-}
-
-float circle_vs_circle_wrapped(float x1, float y1, float r1, float x2, float y2, float r2) {
-	float d = point_distance_wrapped(x1, y1, x2, y2);
-	return d < (r1 + r2);
-}
-
-float point_direction_wrapped(float x1, float y1, float x2, float y2) {
-	float dist = INFINITY;
-	float d;
-	float dir = 0.0f;
-
-	d = point_distance(x1 - MAP_W, y1 - MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 - MAP_W, y1 - MAP_H, x2, y2);}
-	d = point_distance(x1,         y1 - MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1,         y1 - MAP_H, x2, y2);}
-	d = point_distance(x1 + MAP_W, y1 - MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 + MAP_W, y1 - MAP_H, x2, y2);}
-
-	d = point_distance(x1 - MAP_W, y1,         x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 - MAP_W, y1,         x2, y2);}
-	d = point_distance(x1,         y1,         x2, y2); if (d < dist) {dist = d; dir = point_direction(x1,         y1,         x2, y2);}
-	d = point_distance(x1 + MAP_W, y1,         x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 + MAP_W, y1,         x2, y2);}
-
-	d = point_distance(x1 - MAP_W, y1 + MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 - MAP_W, y1 + MAP_H, x2, y2);}
-	d = point_distance(x1,         y1 + MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1,         y1 + MAP_H, x2, y2);}
-	d = point_distance(x1 + MAP_W, y1 + MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 + MAP_W, y1 + MAP_H, x2, y2);}
-
-	return dir;
-}
+#include "Game.h"
+
+#include "Assets.h"
+#include "Audio.h"
+#include "Profiler.h"
+#include "Jobs.h"
+#include "AllocTracker.h"
+#include "DrawCapture.h"
+#include "Log.h"
+#include "stb_sprintf.h"
+#include "mathh.h"
+#include <string.h>
+
+Game* game;
+
+static double GetTime() {
+	return double(SDL_GetPerformanceCounter()) / double(SDL_GetPerformanceFrequency());
+}
+
+void Game::Init() {
+	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_VERBOSE);
+	SDL_Log("Starting game...");
+
+	main_thread_id = SDL_ThreadID();
+
+	SDL_SetHint(SDL_HINT_WINDOWS_DPI_AWARENESS, "system");
+
+	if (SDL_Init(SDL_INIT_AUDIO
+				 | SDL_INIT_VIDEO) != 0) {
+		ERROR("Couldn't initialize SDL: %s", SDL_GetError());
+	}
+
+	// Mix_Init(0);
+
+	log_init();
+
+	pacer.Init();
+
+	{
+		int threads = 0;
+		char* env_threads = SDL_getenv("JOB_THREADS");
+		if (env_threads) threads = SDL_atoi(env_threads);
+		jobs_init(threads);
+	}
+
+	SDL_Rect display;
+	SDL_GetDisplayUsableBounds(0, &display);
+	int window_w = GAME_W;
+	int window_h = GAME_H;
+	if (display.w < window_w || display.h < window_h) {
+		window_w /= 2;
+		window_h /= 2;
+	}
+
+	window = SDL_CreateWindow("Asteroids",
+							  SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+							  window_w, window_h,
+							  SDL_WINDOW_RESIZABLE);
+	SDL_SetWindowMinimumSize(window, GAME_W / 2, GAME_H / 2);
+
+	renderer = SDL_CreateRenderer(window, -1, 0);
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+	SDL_RendererInfo info;
+	SDL_GetRendererInfo(renderer, &info);
+	if (strcmp(info.name, "direct3d") == 0) {
+		SDL_SetHint(SDL_HINT_VIDEO_MINIMIZE_ON_FOCUS_LOSS, "0");
+		SDL_Log("Using SDL_VIDEO_MINIMIZE_ON_FOCUS_LOSS=0 workaround...");
+	}
+
+	Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 2048);
+	Mix_Volume(-1, int(0.25f * float(MIX_MAX_VOLUME)));
+
+	if (!load_all_assets()) {
+		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION,
+								 "[INFO]",
+								 "An error occured while loading game assets.",
+								 nullptr);
+	}
+
+	state = GameState::PLAYING;
+	{
+		// The stress scenarios are about the pools being full.
+		bool sectors = !stress.scenario;
+		char* env_sectors = SDL_getenv("SECTORS");
+		if (env_sectors) sectors = (SDL_atoi(env_sectors) != 0);
+		world_instance.sectors.enabled = sectors;
+
+		char* env_sim_lod = SDL_getenv("SIM_LOD");
+		if (env_sim_lod) world_instance.sim_lod = (SDL_atoi(env_sim_lod) != 0);
+
+		char* env_separation = SDL_getenv("SHIP_SEPARATION");
+		if (env_separation) world_instance.flow.separation = (SDL_atoi(env_separation) != 0);
+	}
+	world_instance.Init();
+	draw_world = &world_instance;
+	draw_snapshot = nullptr;
+
+	if (stress.scenario) {
+		// Unpaced, and on this thread so that the update and draw times add up to the frame time.
+		set_vsync(false);
+		stress.Start(&world_instance);
+	}
+
+	{
+		char* env_hash_log = SDL_getenv("WORLD_HASH_LOG");
+		if (env_hash_log) hash_log.StartRecording(env_hash_log);
+
+		char* env_hash_ref = SDL_getenv("WORLD_HASH_REF");
+		if (env_hash_ref) hash_log.LoadReference(env_hash_ref);
+	}
+
+	{
+		char* env_metrics = SDL_getenv("METRICS_SHM");
+		if (env_metrics && SDL_atoi(env_metrics) != 0) metrics.Open();
+	}
+
+#ifndef __EMSCRIPTEN__
+	{
+		bool threaded = true;
+		char* env_sim_thread = SDL_getenv("SIM_THREAD");
+		if (env_sim_thread) threaded = (SDL_atoi(env_sim_thread) != 0);
+		if (threaded && !stress.scenario) StartSimThread();
+	}
+#endif
+
+	prev_time = GetTime();
+}
+
+void Game::Quit() {
+	StopSimThread();
+
+	switch (state) {
+		case GameState::PLAYING: {
+			world_instance.Quit();
+			break;
+		}
+	}
+
+	world_state_free(&checkpoint);
+	rewind.Free();
+	hash_log.Stop();
+	stress.Free();
+	metrics.Close();
+
+	free_all_assets();
+
+	profiler_free();
+	counters_free();
+	draw_capture_free();
+
+	frame_times.StopCSV();
+
+	pacer.Quit();
+
+	jobs_quit();
+	log_quit();
+
+	if (game_texture) SDL_DestroyTexture(game_texture);
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroyWindow(window);
+
+	// Mix_Quit();
+	SDL_Quit();
+
+	SDL_Log("Game finished.");
+}
+
+void Game::Run() {
+	while (!quit) {
+		Frame();
+	}
+}
+
+static int sim_thread_proc(void* arg) {
+	Game* g = (Game*) arg;
+
+	while (!SDL_AtomicGet(&g->sim_quit)) {
+		g->Step(1.0f);
+		g->sim_frame++;
+
+		{
+			PROFILE_SCOPE("Snapshot");
+
+			RenderSnapshot* s = g->snapshots.GetWriteSlot();
+			snapshot_world(s, &g->world_instance);
+			s->sim_frame = g->sim_frame;
+			s->update_took = g->update_took;
+			g->snapshots.Publish();
+		}
+
+		{
+			PROFILE_SCOPE("Wait");
+			g->sim_pacer.Wait(1.0 / double(GAME_FPS));
+		}
+	}
+
+	return 0;
+}
+
+void Game::StartSimThread() {
+	snapshots.Init();
+
+	// So that the main thread has something to draw right away.
+	snapshot_world(snapshots.GetWriteSlot(), &world_instance);
+	snapshots.Publish();
+
+	sim_pacer.Init();
+
+	SDL_AtomicSet(&sim_quit, 0);
+	sim_thread = SDL_CreateThread(sim_thread_proc, "Simulation", this);
+	if (!sim_thread) {
+		SDL_Log("Couldn't create simulation thread: %s", SDL_GetError());
+		sim_pacer.Quit();
+		snapshots.Free();
+		return;
+	}
+
+	SDL_Log("Simulation runs on its own thread.");
+}
+
+void Game::StopSimThread() {
+	if (!sim_thread) return;
+
+	SDL_AtomicSet(&sim_quit, 1);
+	SDL_WaitThread(sim_thread, nullptr);
+	sim_thread = nullptr;
+
+	sim_pacer.Quit();
+	snapshots.Free();
+
+	draw_world = &world_instance;
+	draw_snapshot = nullptr;
+}
+
+void Game::Frame() {
+	alloc_tracker_end_frame(state == GameState::PLAYING && !alloc_expected);
+	alloc_expected = false;
+
+	counters_sample(draw_world);
+
+	profiler_begin_frame();
+
+	double t = GetTime();
+
+	double elapsed = t - prev_time;
+	fps = 1.0 / elapsed;
+	prev_time = t;
+
+	// Times of the previous frame, and of the update that made what it drew.
+	frame_times.Add({1000.0 * elapsed, drawn_update_took(), draw_took, present_took});
+
+	SDL_Event ev;
+	while (SDL_PollEvent(&ev)) {
+		switch (ev.type) {
+			case SDL_QUIT: {
+				quit = true;
+				break;
+			}
+
+			case SDL_WINDOWEVENT: {
+				alloc_expected = true;
+				break;
+			}
+
+			case SDL_KEYDOWN: {
+				int scancode = ev.key.keysym.scancode;
+
+				// Debug keys save files, toggle fullscreen and so on.
+				if (SDL_SCANCODE_F1 <= scancode && scancode <= SDL_SCANCODE_F12) {
+					alloc_expected = true;
+				}
+
+				if (0 <= scancode && scancode < (int) ArrayLength(pending_key_pressed)) {
+					SDL_AtomicLock(&input_lock);
+					pending_key_pressed[scancode] = true;
+					SDL_AtomicUnlock(&input_lock);
+				}
+
+				switch (scancode) {
+					case SDL_SCANCODE_F3: {
+						draw_capture_request((ev.key.keysym.mod & KMOD_SHIFT) != 0);
+						break;
+					}
+
+					case SDL_SCANCODE_F4: {
+						if (ev.key.keysym.mod == 0) {
+							set_fullscreen(!get_fullscreen());
+						}
+						break;
+					}
+
+					case SDL_SCANCODE_F5: {
+						frame_advance = true;
+						SDL_AtomicLock(&input_lock);
+						pending_steps++;
+						SDL_AtomicUnlock(&input_lock);
+						break;
+					}
+
+					case SDL_SCANCODE_F6: {
+						frame_advance = false;
+						break;
+					}
+
+					case SDL_SCANCODE_F8: {
+						if (frame_times.csv) {
+							frame_times.StopCSV();
+							counters_stop_csv();
+						} else {
+							u32 ticks = SDL_GetTicks();
+							char fname[64];
+							stb_snprintf(fname, sizeof(fname), "frametimes_%u.csv", ticks);
+							frame_times.StartCSV(fname);
+							stb_snprintf(fname, sizeof(fname), "counters_%u.csv", ticks);
+							counters_start_csv(fname);
+						}
+						break;
+					}
+
+					case SDL_SCANCODE_F9: {
+						// Run by the thread that owns the job system.
+						SDL_AtomicLock(&input_lock);
+						pending_benchmark = true;
+						SDL_AtomicUnlock(&input_lock);
+						break;
+					}
+
+					case SDL_SCANCODE_F7: {
+						if (profiler.enabled) {
+							char fname[64];
+							stb_snprintf(fname, sizeof(fname), "trace_%u.json", SDL_GetTicks());
+							profiler_dump_trace(fname);
+						}
+						break;
+					}
+				}
+				break;
+			}
+		}
+	}
+
+	{
+		// The world can update on the simulation thread, which mustn't call SDL_GetKeyboardState while this one
+		// pumps events. It gets a copy in Step().
+		const u8* key = SDL_GetKeyboardState(nullptr);
+
+		SDL_AtomicLock(&input_lock);
+		memcpy(pending_key_held, key, sizeof(pending_key_held));
+		u32 settings = pending_settings;
+		pending_settings = 0;
+		SDL_AtomicUnlock(&input_lock);
+
+		if (settings) toggle_settings(settings);
+	}
+
+	float delta;
+	if (get_vsync()) {
+		delta = (float) (elapsed * double(GAME_FPS));
+		delta = clamp(delta, 0.1f, 10.0f);
+	} else {
+		delta = float(GAME_FPS) / float(fps_cap);
+	}
+
+	if (sim_thread) {
+		// The world updates on its own thread. Draw the newest state it has published.
+		draw_snapshot = snapshots.Acquire();
+		draw_world = &draw_snapshot->world;
+		Draw(delta);
+	} else {
+		Step(delta);
+		Draw(delta);
+	}
+
+	if (stress.scenario) {
+		FrameTimeSample s = {1000.0 * elapsed, drawn_update_took(), draw_took, present_took};
+		int draw_calls = int(counters_since_sample(COUNTER_DRAW_SPRITE) + counters_since_sample(COUNTER_RENDER_GEOMETRY));
+		if (stress.Frame(&world_instance, s, draw_calls)) {
+			stress.WriteReport();
+			quit = true;
+		}
+		return;
+	}
+
+#ifndef __EMSCRIPTEN__
+	{
+		if (!get_vsync()) {
+			PROFILE_SCOPE("Wait");
+			pacer.Wait(1.0 / double(fps_cap));
+		}
+	}
+#endif
+}
+
+void Game::Step(float delta) {
+	int steps;
+	bool benchmark;
+
+	SDL_AtomicLock(&input_lock);
+	{
+		memcpy(key_pressed, pending_key_pressed, sizeof(key_pressed));
+		memset(pending_key_pressed, 0, sizeof(pending_key_pressed));
+		memcpy(key_held, pending_key_held, sizeof(key_held));
+
+		steps = pending_steps;
+		pending_steps = 0;
+
+		benchmark = pending_benchmark;
+		pending_benchmark = false;
+	}
+	SDL_AtomicUnlock(&input_lock);
+
+	if (benchmark) jobs_benchmark();
+
+	skip_frame = (frame_advance && steps == 0);
+
+	Update(delta);
+}
+
+void Game::Update(float delta) {
+	PROFILE_SCOPE("Update");
+
+	double t = GetTime();
+
+	if (!skip_frame) {
+		switch (state) {
+			case GameState::PLAYING: {
+				World* w = &world_instance;
+
+				if (key_pressed[SDL_SCANCODE_F1]) {
+					double t = GetTime();
+					if (world_save_state(w, &checkpoint)) {
+						SDL_Log("Checkpoint saved: frame %d, %.1f KB, %.3fms.",
+								w->frame, double(checkpoint.size) / 1024.0, 1000.0 * (GetTime() - t));
+					} else {
+						SDL_Log("Couldn't save a checkpoint.");
+					}
+				}
+
+				if (key_pressed[SDL_SCANCODE_F2]) {
+					double t = GetTime();
+					if (world_load_state(w, &checkpoint)) {
+						// Rewinding past the checkpoint would go into a different timeline.
+						rewind.Clear();
+						SDL_Log("Checkpoint loaded: frame %d, %.3fms.", w->frame, 1000.0 * (GetTime() - t));
+					}
+				}
+
+				if (key_held[SDL_SCANCODE_BACKSPACE] && !w->paused) {
+					// One state per frame, so rewinding goes REWIND_INTERVAL times faster than the game.
+					rewind.Pop(w);
+					rewind.timer = 0;
+				} else {
+					w->Update(delta);
+
+					hash_log.Frame(w);
+
+					if (!w->paused && ++rewind.timer >= REWIND_INTERVAL) {
+						rewind.Push(w);
+						rewind.timer = 0;
+					}
+				}
+				break;
+			}
+		}
+	}
+
+	update_took = 1000.0 * (GetTime() - t);
+}
+
+double Game::drawn_update_took() {
+	// With the simulation thread, update_took is still being written over there.
+	return draw_snapshot ? draw_snapshot->update_took : update_took;
+}
+
+void Game::Draw(float delta) {
+	PROFILE_SCOPE("Draw");
+
+	double t = GetTime();
+
+	draw_capture_begin_frame(renderer);
+
+	{
+		int window_w;
+		int window_h;
+		SDL_GetWindowSize(window, &window_w, &window_h);
+
+		// Decide on game texture size.
+
+		// game_texture_w = window_w;
+		// game_texture_h = window_h;
+
+		// game_texture_h = GAME_H;
+		// game_texture_w = (int) (float(game_texture_h) / float(window_h) * float(window_w));
+
+		game_texture_w = GAME_W;
+		game_texture_h = GAME_H;
+
+		camera_base_h = GAME_H;
+		camera_base_w = (int) (float(camera_base_h) / float(game_texture_h) * float(game_texture_w));
+
+		int w;
+		int h;
+		if (game_texture) SDL_QueryTexture(game_texture, nullptr, nullptr, &w, &h);
+		if (!game_texture || w != game_texture_w || h != game_texture_h) {
+			if (game_texture) SDL_DestroyTexture(game_texture);
+			game_texture = SDL_CreateTexture(renderer,
+											 SDL_PIXELFORMAT_XRGB8888, SDL_TEXTUREACCESS_TARGET,
+											 game_texture_w, game_texture_h);
+		}
+		SDL_SetTextureScaleMode(game_texture,
+								options.bilinear_filter ? SDL_ScaleModeLinear : SDL_ScaleModeNearest);
+
+		ui_w = game_texture_w / ui_scale;
+		ui_h = game_texture_h / ui_scale;
+	}
+
+	if (state == GameState::PLAYING && draw_world->interface_map_version != interface_map_drawn) {
+		draw_world->DrawInterfaceMap();
+		interface_map_drawn = draw_world->interface_map_version;
+	}
+
+	{
+		render_set_target(renderer, nullptr);
+		render_set_logical_size(renderer, ui_w, ui_h);
+
+		int mouse_x;
+		int mouse_y;
+		u32 mouse = SDL_GetMouseState(&mouse_x, &mouse_y);
+		SDL_RenderWindowToLogical(renderer, mouse_x, mouse_y, &ui_mouse_x, &ui_mouse_y);
+	}
+
+	{
+		render_set_target(renderer, game_texture);
+
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		render_clear(renderer, DRAW_SRC_SCREEN);
+
+		// Render game world.
+		render_set_logical_size(renderer, camera_base_w, camera_base_h);
+
+		switch (state) {
+			case GameState::PLAYING: {
+				draw_world->Draw(delta);
+				break;
+			}
+		}
+
+		// Render UI.
+		render_set_logical_size(renderer, ui_w, ui_h);
+
+		switch (state) {
+			case GameState::PLAYING: {
+				draw_world->DrawUI(delta);
+				break;
+			}
+		}
+
+		// Draw FPS.
+		{
+			char buf[32];
+			if (get_vsync()) {
+				stb_snprintf(buf, sizeof(buf), "%.2f V", fps);
+			} else {
+				stb_snprintf(buf, sizeof(buf), "%.2f", fps);
+			}
+			DrawText(renderer, fnt_cp437, buf, ui_w, ui_h, HALIGN_RIGHT, VALIGN_BOTTOM);
+		}
+	}
+
+	render_set_target(renderer, nullptr);
+
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	render_clear(renderer, DRAW_SRC_SCREEN);
+
+	if (options.letterbox) {
+		render_set_logical_size(renderer, game_texture_w, game_texture_h);
+	} else {
+		render_set_logical_size(renderer, 0, 0);
+	}
+
+	// Render game texture.
+	render_copy(renderer, game_texture, nullptr, nullptr, DRAW_SRC_SCREEN);
+
+	render_set_logical_size(renderer, 0, 0);
+
+	int x = 0;
+	int y = 300;
+	if (show_debug_info) {
+		char buf[100];
+		stb_snprintf(buf, sizeof(buf),
+					 "update: %.2fms\n"
+					 "draw: %.2fms\n",
+					 drawn_update_took(),
+					 draw_took);
+		y = DrawText(renderer, fnt_mincho, buf, x, y).y;
+		{
+			FrameTimePercentiles fr = frame_times.Compute(&FrameTimeSample::frame);
+			FrameTimePercentiles up = frame_times.Compute(&FrameTimeSample::update);
+			FrameTimePercentiles dr = frame_times.Compute(&FrameTimeSample::draw);
+			FrameTimePercentiles pr = frame_times.Compute(&FrameTimeSample::present);
+
+			char buf[400];
+			stb_snprintf(buf, sizeof(buf),
+						 "last %d frames   p50    p95    p99    max\n"
+						 "frame:   %6.2f %6.2f %6.2f %6.2f\n"
+						 "update:  %6.2f %6.2f %6.2f %6.2f\n"
+						 "draw:    %6.2f %6.2f %6.2f %6.2f\n"
+						 "present: %6.2f %6.2f %6.2f %6.2f\n"
+						 "%s\n",
+						 frame_times.count,
+						 fr.p50, fr.p95, fr.p99, fr.max,
+						 up.p50, up.p95, up.p99, up.max,
+						 dr.p50, dr.p95, dr.p99, dr.max,
+						 pr.p50, pr.p95, pr.p99, pr.max,
+						 frame_times.csv ? "recording csv (F8 - stop)" : "F8 - record csv");
+			y = DrawText(renderer, fnt_cp437, buf, x, y).y;
+
+			if (!get_vsync()) {
+				stb_snprintf(buf, sizeof(buf),
+							 "pacing error: avg %.3fms max %.3fms, missed %d (%d total)\n"
+							 "spin margin: %.3fms (spinning %.0f%% of the wait)\n",
+							 pacer.avg_error * 1000.0, pacer.max_error * 1000.0, pacer.missed, pacer.missed_total,
+							 pacer.spin_margin * 1000.0, pacer.spin_fraction * 100.0);
+				y = DrawText(renderer, fnt_cp437, buf, x, y).y;
+			}
+
+			frame_times.DrawHistogram(renderer, x, y, 4 * FRAME_TIMES_BUCKETS, 48);
+			y += 48 + 4;
+		}
+		if (alloc_tracker.enabled) {
+			const AllocFrameStats& a = alloc_tracker.last;
+
+			char buf[600];
+			int len = stb_snprintf(buf, sizeof(buf),
+								   "allocs: %d (%.1f KB)  frees: %d (%.1f KB)\n"
+								   "live: %d blocks, %.1f KB, %d sites\n",
+								   a.allocs, double(a.bytes_allocated) / 1024.0,
+								   a.frees, double(a.bytes_freed) / 1024.0,
+								   alloc_tracker.live, double(alloc_tracker.live_bytes) / 1024.0,
+								   alloc_tracker.site_count);
+
+			AllocSite* top[ALLOC_OVERLAY_SITES];
+			int top_count = alloc_tracker_top_sites(top, ALLOC_OVERLAY_SITES);
+			for (int i = 0; i < top_count; i++) {
+				len += stb_snprintf(buf + len, sizeof(buf) - len, "  %dx %.1f KB %s\n",
+									top[i]->last_allocs, double(top[i]->last_bytes) / 1024.0, top[i]->name);
+			}
+			y = DrawText(renderer, fnt_cp437, buf, x, y).y;
+		}
+		if (state == GameState::PLAYING) {
+			char buf[150];
+			stb_snprintf(buf, sizeof(buf),
+						 "enemies: %d (%d all)\n"
+						 "bullets: %d\n"
+						 "player bullets: %d\n"
+						 "allies: %d\n"
+						 "chests: %d\n"
+						 "particles: %d\n"
+						 "sleeping asteroids: %d\n",
+						 draw_world->get_enemy_count(), draw_world->enemy_count,
+						 draw_world->bullet_count,
+						 draw_world->p_bullet_count,
+						 draw_world->ally_count,
+						 draw_world->chest_count,
+						 draw_world->particles.particle_count,
+						 draw_world->sectors.count);
+			y = DrawText(renderer, fnt_mincho, buf, x, y).y;
+			// The live numbers are on the stage script's stack, which the simulation thread writes to.
+			bool has_ai;
+			int ai[3];
+			if (draw_snapshot) {
+				has_ai = draw_snapshot->has_ai;
+				ai[0] = draw_snapshot->ai_points;
+				ai[1] = draw_snapshot->ai_tick_wait_time;
+				ai[2] = draw_snapshot->ai_tick_wait_timer;
+			} else {
+				has_ai = (draw_world->ai_points != nullptr);
+				if (has_ai) {
+					ai[0] = *draw_world->ai_points;
+					ai[1] = *draw_world->ai_tick_wait_time;
+					ai[2] = *draw_world->ai_tick_wait_timer;
+				}
+			}
+			if (has_ai) {
+				char buf[50];
+				stb_snprintf(buf, sizeof buf,
+							 "ai points: %d\n"
+							 "ai wait time: %d\n"
+							 "ai wait timer: %d\n",
+							 ai[0],
+							 ai[1],
+							 ai[2]);
+				y = DrawText(renderer, fnt_mincho, buf, x, y).y;
+			}
+		}
+		y += 10;
+	}
+	if (show_audio_channels) {
+		// draw audio channels
+
+		for (int i = 0; i < Mix_AllocateChannels(-1); i++) {
+			const char* name = "";
+			Mix_Chunk* chunk = Mix_GetChunk(i);
+			for (int j = 0; j < SOUND_COUNT; j++) {
+				if (chunk == Chunks[j]) {
+					name = Chunk_Names[j];
+					break;
+				}
+			}
+			char buf[100];
+			stb_snprintf(buf, sizeof(buf), "%d %u %d %s\n", i, channel_when_played[i], channel_priority[i], name);
+			SDL_Color col = Mix_Playing(i) ? SDL_Color{255, 255, 255, 255} : SDL_Color{128, 128, 128, 255};
+			y = DrawText(renderer, fnt_mincho, buf, x, y, 0, 0, col).y;
+		}
+	}
+
+	if (show_profiler) {
+		int window_w;
+		SDL_GetWindowSize(window, &window_w, nullptr);
+		profiler_draw_flame_graph(renderer, 0, 0, window_w);
+	}
+
+	if (show_counters) {
+		int window_w;
+		SDL_GetWindowSize(window, &window_w, nullptr);
+		const int graphs_w = 480;
+		counters_draw_graphs(renderer, window_w - graphs_w, 300, graphs_w);
+	}
+
+	draw_took = 1000.0 * (GetTime() - t);
+
+	draw_capture_end_frame(draw_took, frame_times.total_frames);
+
+	{
+		PROFILE_SCOPE("Present");
+
+		t = GetTime();
+		SDL_RenderPresent(renderer);
+		present_took = 1000.0 * (GetTime() - t);
+	}
+
+	metrics.Publish(this);
+}
+
+void Game::toggle_settings(u32 settings) {
+	if (SDL_ThreadID() != main_thread_id) {
+		SDL_AtomicLock(&input_lock);
+		pending_settings ^= settings;
+		SDL_AtomicUnlock(&input_lock);
+		return;
+	}
+
+	if (settings & SETTING_DEBUG_INFO)     show_debug_info         ^= true;
+	if (settings & SETTING_AUDIO_CHANNELS) show_audio_channels     ^= true;
+	if (settings & SETTING_LETTERBOX)      options.letterbox       ^= true;
+	if (settings & SETTING_BILINEAR)       options.bilinear_filter ^= true;
+	if (settings & SETTING_COUNTERS)       show_counters           ^= true;
+	if (settings & SETTING_VSYNC)          set_vsync(!get_vsync());
+	if (settings & SETTING_FULLSCREEN)     set_fullscreen(!get_fullscreen());
+	if (settings & SETTING_PROFILER) {
+		show_profiler ^= true;
+		profiler.enabled = show_profiler;
+	}
+}
+
+void Game::set_audio3d(bool enable) {
+	options.audio_3d = enable;
+	// @Hack
+	int vol = Mix_Volume(0, -1);
+	Mix_AllocateChannels(0);
+	Mix_AllocateChannels(MIX_CHANNELS);
+	Mix_Volume(-1, vol);
+	memset(channel_when_played, 0, sizeof(channel_when_played));
+	memset(channel_priority, 0, sizeof(channel_priority));
+}
+
+void Game::set_vsync(bool enable) {
+#ifndef __EMSCRIPTEN__
+	SDL_RenderSetVSync(renderer, enable);
+#endif
+}
+
+bool Game::get_vsync() {
+#ifdef __EMSCRIPTEN__
+	return true;
+#else
+	SDL_RendererInfo info;
+	SDL_GetRendererInfo(renderer, &info);
+	return (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+#endif
+}
+
+void Game::set_fullscreen(bool enable) {
+	if (enable) {
+		SDL_DisplayMode mode;
+		SDL_GetDesktopDisplayMode(SDL_GetWindowDisplayIndex(window), &mode);
+		SDL_SetWindowDisplayMode(window, &mode);
+		SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
+	} else {
+		SDL_SetWindowFullscreen(window, 0);
+	}
+}
+
+bool Game::get_fullscreen() {
+	return (SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN) != 0;
+}
+
+float point_distance_wrapped(float x1, float y1, float x2, float y2) {
+	float dist = INFINITY;
+	float d;
+
+	d = point_distance(x1 - MAP_W, y1 - MAP_H, x2, y2); if (d < dist) dist = d;
+	d = point_distance(x1,         y1 - MAP_H, x2, y2); if (d < dist) dist = d;
+	d = point_distance(x1 + MAP_W, y1 - MAP_H, x2, y2); if (d < dist) dist = d;
+
+	d = point_distance(x1 - MAP_W, y1,         x2, y2); if (d < dist) dist = d;
+	d = point_distance(x1,         y1,         x2, y2); if (d < dist) dist = d;
+	d = point_distance(x1 + MAP_W, y1,         x2, y2); if (d < dist) dist = d;
+
+	d = point_distance(x1 - MAP_W, y1 + MAP_H, x2, y2); if (d < dist) dist = d;
+	d = point_distance(x1,         y1 + MAP_H, x2, y2); if (d < dist) dist = d;
+	d = point_distance(x1 + MAP_W, y1 + MAP_H, x2, y2); if (d < dist) dist = d;
+
+	return dist;
+}
+
+bool is_on_screen(World* w, float x, float y) {
+	// float center_x = w->camera_x;
+	// float center_y = w->camera_y;
+	// float dist = point_distance_wrapped(x, y, center_x, center_y);
+	// return dist < DIST_OFFSCREEN;
+
+	x -= w->camera_left;
+	y -= w->camera_top;
+
+	auto check = [w](float x, float y) {
+		float off = 100.0f;
+		return (-off <= x && x < w->camera_w + off)
+			&& (-off <= y && y < w->camera_h + off);
+	};
+
+	bool result = false;
+
+	result |= check(x - MAP_W, y - MAP_H);
+	result |= check(x,         y - MAP_H);
+	result |= check(x + MAP_W, y - MAP_H);
+
+	result |= check(x - MAP_W, y);
+	result |= check(x,         y);
+	result |= check(x + MAP_W, y);
+
+	result |= check(x - MAP_W, y + MAP_H);
+	result |= check(x,         y + MAP_H);
+	result |= check(x + MAP_W, y + MAP_H);
+
+	return result;
+}
+
+float circle_vs_circle_wrapped(float x1, float y1, float r1, float x2, float y2, float r2) {
+	float d = point_distance_wrapped(x1, y1, x2, y2);
+	return d < (r1 + r2);
+}
+
+float point_direction_wrapped(float x1, float y1, float x2, float y2) {
+	float dist = INFINITY;
+	float d;
+	float dir = 0.0f;
+
+	d = point_distance(x1 - MAP_W, y1 - MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 - MAP_W, y1 - MAP_H, x2, y2);}
+	d = point_distance(x1,         y1 - MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1,         y1 - MAP_H, x2, y2);}
+	d = point_distance(x1 + MAP_W, y1 - MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 + MAP_W, y1 - MAP_H, x2, y2);}
+
+	d = point_distance(x1 - MAP_W, y1,         x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 - MAP_W, y1,         x2, y2);}
+	d = point_distance(x1,         y1,         x2, y2); if (d < dist) {dist = d; dir = point_direction(x1,         y1,         x2, y2);}
+	d = point_distance(x1 + MAP_W, y1,         x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 + MAP_W, y1,         x2, y2);}
+
+	d = point_distance(x1 - MAP_W, y1 + MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 - MAP_W, y1 + MAP_H, x2, y2);}
+	d = point_distance(x1,         y1 + MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1,         y1 + MAP_H, x2, y2);}
+	d = point_distance(x1 + MAP_W, y1 + MAP_H, x2, y2); if (d < dist) {dist = d; dir = point_direction(x1 + MAP_W, y1 + MAP_H, x2, y2);}
+
+	return dir;
+}
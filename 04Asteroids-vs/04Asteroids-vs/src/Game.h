@@ -1,75 +1,136 @@
-#pragma once
-
-#include "common.h"
-#include "World.h"
-
-struct Game;
-extern Game* game;
-
-enum struct GameState {
-	PLAYING
-};
-
-struct Options {
-	bool bilinear_filter = true;
-	bool letterbox = true;
-	bool audio_3d;
-};
-
-struct Game {
-	union {
-		World world_instance{};
-	};
-
-	GameState state;
-	Options options;
-
-	SDL_Window* window;
-	SDL_Renderer* renderer;
-	SDL_Texture* game_texture;
-	bool quit;
-	double prev_time;
-	double fps;
-	double update_took;
-	double draw_took;
-	bool frame_advance;
-	bool skip_frame;
-	bool key_pressed[SDL_SCANCODE_UP + 1];
-	bool show_debug_info;
-	bool show_audio_channels;
-	int fps_cap = 60;
-	int ui_w = GAME_W;
-	int ui_h = GAME_H;
-	int ui_scale = 1;
-	float ui_mouse_x;
-	float ui_mouse_y;
-	int camera_base_w = GAME_W;
-	int camera_base_h = GAME_H;
-	int game_texture_w = GAME_W;
-	int game_texture_h = GAME_H;
-	u32 sleep_ms;
-
-	void Init();
-	void Quit();
-	void Run();
-	void Frame();
-
-	void Update(float delta);
-	void Draw(float delta);
-
-	void sleep(float x, float y, u32 ms);
-
-	void set_audio3d(bool enable);
-	void set_vsync(bool enable);
-	bool get_vsync();
-	void set_fullscreen(bool enable);
-	bool get_fullscreen();
-};
-
-float point_distance_wrapped(float x1, float y1, float x2, float y2);
-
-bool is_on_screen(float x, float y);
-
-float circle_vs_circle_wrapped(float x1, float y1, float r1, float x2, float y2, float r2);
-
-float point_direction_wrapped(float x1, float y1, float x2, float y2);
+#pragma once
+
+#include "common.h"
+#include "World.h"
+#include "FrameTimes.h"
+#include "FramePacer.h"
+#include "Snapshot.h"
+#include "WorldState.h"
+#include "WorldHash.h"
+#include "Stress.h"
+#include "Metrics.h"
+
+struct Game;
+extern Game* game;
+
+enum struct GameState {
+	PLAYING
+};
+
+struct Options {
+	bool bilinear_filter = true;
+	bool letterbox = true;
+	bool audio_3d;
+};
+
+// Settings the pause menu flips. Drawing reads them and some are window or renderer calls, so they only change
+// on the main thread (see toggle_settings).
+enum {
+	SETTING_DEBUG_INFO     = 1,
+	SETTING_AUDIO_CHANNELS = 1 << 1,
+	SETTING_LETTERBOX      = 1 << 2,
+	SETTING_BILINEAR       = 1 << 3,
+	SETTING_PROFILER       = 1 << 4,
+	SETTING_COUNTERS       = 1 << 5,
+	SETTING_VSYNC          = 1 << 6,
+	SETTING_FULLSCREEN     = 1 << 7
+};
+
+struct Game {
+	union {
+		World world_instance{};
+	};
+	World* draw_world; // What Draw() shows: world_instance, or the newest snapshot of it
+	RenderSnapshot* draw_snapshot; // The snapshot draw_world is in, null if it's world_instance
+
+	GameState state;
+	Options options;
+
+	SDL_Window* window;
+	SDL_Renderer* renderer;
+	SDL_Texture* game_texture;
+	bool quit;
+	double prev_time;
+	double fps;
+	double update_took; // Written by whichever thread updates the world. Read drawn_update_took() on the main thread.
+	double draw_took;
+	double present_took;
+	FrameTimes frame_times;
+	FramePacer pacer;
+	bool frame_advance;
+	bool skip_frame;
+	bool key_pressed[SDL_SCANCODE_UP + 1];
+	u8 key_held[SDL_NUM_SCANCODES]; // SDL_GetKeyboardState() as of the last Step(). The world reads this one.
+	bool show_debug_info;
+	bool show_audio_channels;
+	bool show_profiler;
+	bool show_counters;
+	int fps_cap = 60;
+	int ui_w = GAME_W;
+	int ui_h = GAME_H;
+	int ui_scale = 1;
+	float ui_mouse_x;
+	float ui_mouse_y;
+	int camera_base_w = GAME_W;
+	int camera_base_h = GAME_H;
+	int game_texture_w = GAME_W;
+	int game_texture_h = GAME_H;
+	int interface_map_drawn = -1; // World::interface_map_version the map texture was last drawn for
+
+	WorldState checkpoint; // F1 saves, F2 loads
+	RewindBuffer rewind;   // Hold backspace to go back
+	HashLog hash_log;      // WORLD_HASH_LOG=file records, WORLD_HASH_REF=file compares
+	StressRun stress;      // Set up by main() from the command line
+	bool alloc_expected;   // Something happened this frame that's allowed to allocate (ALLOC_TRACK=assert)
+	MetricsExport metrics; // METRICS_SHM=1
+
+	// Simulation thread. Runs the world at GAME_FPS and publishes a snapshot after every update,
+	// the main thread only handles events and draws. Null if the world updates on the main thread (SIM_THREAD=0).
+	SDL_Thread* sim_thread;
+	SDL_threadID main_thread_id;
+	SDL_atomic_t sim_quit;
+	SnapshotBuffer snapshots;
+	FramePacer sim_pacer;
+	u64 sim_frame;
+
+	// Filled in by the event loop, taken by whichever thread updates the world.
+	SDL_SpinLock input_lock;
+	bool pending_key_pressed[SDL_SCANCODE_UP + 1];
+	u8 pending_key_held[SDL_NUM_SCANCODES];
+	int pending_steps; // Frame advance presses
+	bool pending_benchmark;
+	u32 pending_settings; // The other way: SETTING_* for the main thread to flip, also under input_lock
+
+	void Init();
+	void Quit();
+	void Run();
+	void Frame();
+
+	void StartSimThread();
+	void StopSimThread();
+
+	// Takes the pending input and updates the world once.
+	void Step(float delta);
+	void Update(float delta);
+	void Draw(float delta);
+
+	// update_took of the update that made what Draw() shows.
+	double drawn_update_took();
+
+	// Flips the SETTING_* in "settings". Off the main thread it's done there on the next frame.
+	void toggle_settings(u32 settings);
+
+	void set_audio3d(bool enable);
+	void set_vsync(bool enable);
+	bool get_vsync();
+	void set_fullscreen(bool enable);
+	bool get_fullscreen();
+};
+
+float point_distance_wrapped(float x1, float y1, float x2, float y2);
+
+bool is_on_screen(World* w, float x, float y);
+
+float circle_vs_circle_wrapped(float x1, float y1, float r1, float x2, float y2, float r2);
+
+float point_direction_wrapped(float x1, float y1, float x2, float y2);
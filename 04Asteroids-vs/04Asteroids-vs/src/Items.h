@@ -1,15 +1,15 @@
-#pragma once
-
-enum {
-	ITEM_MISSILES,
-
-	ITEM_COUNT
-};
-
-enum {
-	ACTIVE_ITEM_HEAL,
-
-	ACTIVE_ITEM_COUNT,
-
-	ACTIVE_ITEM_NONE = 0xff
-};
+#pragma once
+
+enum {
+	ITEM_MISSILES,
+
+	ITEM_COUNT
+};
+
+enum {
+	ACTIVE_ITEM_HEAL,
+
+	ACTIVE_ITEM_COUNT,
+
+	ACTIVE_ITEM_NONE = 0xff
+};
@@ -0,0 +1,244 @@
+#include "Jobs.h"
+
+#include "Profiler.h"
+#include "ecalloc.h"
+#include "mathh.h"
+#include <string.h>
+
+JobSystem jobs;
+
+static bool pop_chunk(int index, JobChunk* out) {
+	JobQueue* q = &jobs.queues[index];
+	bool result = false;
+
+	SDL_AtomicLock(&q->lock);
+	if (q->head < q->tail) {
+		*out = q->chunks[--q->tail];
+		result = true;
+	}
+	SDL_AtomicUnlock(&q->lock);
+
+	return result;
+}
+
+static bool steal_chunk(int index, JobChunk* out) {
+	for (int i = 1; i < JOBS_MAX_THREADS; i++) {
+		JobQueue* q = &jobs.queues[(index + i) % JOBS_MAX_THREADS];
+		bool result = false;
+
+		SDL_AtomicLock(&q->lock);
+		if (q->head < q->tail) {
+			*out = q->chunks[q->head++];
+			result = true;
+		}
+		SDL_AtomicUnlock(&q->lock);
+
+		if (result) {
+			SDL_AtomicAdd(&jobs.stolen, 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void run_chunks(int index) {
+	JobChunk c;
+	while (pop_chunk(index, &c) || steal_chunk(index, &c)) {
+		{
+			PROFILE_SCOPE("Job");
+			c.func(c.data, c.begin, c.end);
+		}
+		SDL_AtomicAdd(&jobs.remaining, -1);
+	}
+}
+
+static int worker_proc(void* arg) {
+	int index = (int) (intptr_t) arg;
+
+	while (true) {
+		SDL_SemWait(jobs.wake);
+		if (SDL_AtomicGet(&jobs.quit)) break;
+
+		run_chunks(index);
+	}
+
+	return 0;
+}
+
+void jobs_init(int threads) {
+	int cpus = SDL_GetCPUCount();
+	int max_threads = clamp(cpus, 1, JOBS_MAX_THREADS);
+
+	jobs.wake = SDL_CreateSemaphore(0);
+
+	for (int i = 1; i < max_threads; i++) {
+		char name[32];
+		SDL_snprintf(name, sizeof(name), "Worker %d", i);
+
+		SDL_Thread* t = SDL_CreateThread(worker_proc, name, (void*) (intptr_t) i);
+		if (!t) {
+			SDL_Log("Couldn't create worker thread: %s", SDL_GetError());
+			break;
+		}
+		jobs.threads[jobs.thread_count++] = t;
+	}
+
+	jobs_set_active_threads((threads > 0) ? threads : max_threads);
+
+	SDL_Log("Job system: %d worker threads, using %d threads.", jobs.thread_count, jobs.active_threads);
+}
+
+void jobs_quit() {
+	SDL_AtomicSet(&jobs.quit, 1);
+	for (int i = 0; i < jobs.thread_count; i++) {
+		SDL_SemPost(jobs.wake);
+	}
+	for (int i = 0; i < jobs.thread_count; i++) {
+		SDL_WaitThread(jobs.threads[i], nullptr);
+		jobs.threads[i] = nullptr;
+	}
+	jobs.thread_count = 0;
+
+	if (jobs.wake) SDL_DestroySemaphore(jobs.wake);
+	jobs.wake = nullptr;
+}
+
+void jobs_set_active_threads(int threads) {
+	jobs.active_threads = clamp(threads, 1, jobs.thread_count + 1);
+}
+
+void parallel_for(int count, int batch, JobFunc func, void* data) {
+	if (count <= 0) return;
+
+	int threads = jobs.active_threads;
+	if (threads <= 1 || count <= batch || !SDL_AtomicCAS(&jobs.busy, 0, 1)) {
+		func(data, 0, count);
+		return;
+	}
+
+	int chunk_size = max(batch, (count + threads * JOBS_CHUNKS_PER_THREAD - 1) / (threads * JOBS_CHUNKS_PER_THREAD));
+	int chunk_count = (count + chunk_size - 1) / chunk_size;
+
+	SDL_AtomicSet(&jobs.remaining, chunk_count);
+
+	// Each queue gets a contiguous run of chunks. Pushed in reverse, so the owner goes through its run front to back.
+	for (int q = 0; q < threads; q++) {
+		int first = chunk_count * q / threads;
+		int last  = chunk_count * (q + 1) / threads;
+
+		JobQueue* queue = &jobs.queues[q];
+		SDL_AtomicLock(&queue->lock);
+		queue->head = 0;
+		queue->tail = 0;
+		for (int c = last - 1; c >= first; c--) {
+			JobChunk* chunk = &queue->chunks[queue->tail++];
+			chunk->func  = func;
+			chunk->data  = data;
+			chunk->begin = c * chunk_size;
+			chunk->end   = min(count, (c + 1) * chunk_size);
+		}
+		SDL_AtomicUnlock(&queue->lock);
+	}
+
+	for (int i = 1; i < threads; i++) {
+		SDL_SemPost(jobs.wake);
+	}
+
+	run_chunks(0);
+
+	// Wait for the chunks that other threads are still running.
+	while (SDL_AtomicGet(&jobs.remaining) > 0) {
+		SDL_CPUPauseInstruction();
+	}
+
+	SDL_AtomicSet(&jobs.busy, 0);
+}
+
+void jobs_benchmark() {
+	const int targets = 1000;
+	const int seekers = 4096;
+	const int iterations = 21;
+
+	float* target_pos = (float*) ecalloc(targets * 2, sizeof(float));
+	float* seeker_pos = (float*) ecalloc(seekers * 2, sizeof(float));
+	int* result = (int*) ecalloc(seekers, sizeof(int));
+
+	u32 seed = 12345;
+	auto rand_pos = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return float(seed >> 8) / float(1 << 24) * 10'000.0f;
+	};
+	for (int i = 0; i < targets * 2; i++) target_pos[i] = rand_pos();
+	for (int i = 0; i < seekers * 2; i++) seeker_pos[i] = rand_pos();
+
+	int prev_active = jobs.active_threads;
+	double single_thread_time = 0.0;
+	u32 single_thread_hash = 0;
+
+	SDL_Log("Job system benchmark: %d seekers x %d targets (x9 for wrapping), median of %d runs.", seekers, targets, iterations);
+
+	for (int threads = 1; threads <= jobs.thread_count + 1; threads++) {
+		jobs_set_active_threads(threads);
+
+		double times[iterations];
+		for (int it = 0; it < iterations; it++) {
+			u64 t = SDL_GetPerformanceCounter();
+
+			ParallelFor(seekers, 64, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					float x = seeker_pos[i * 2];
+					float y = seeker_pos[i * 2 + 1];
+					float best = INFINITY;
+					int best_idx = -1;
+
+					for (int j = 0; j < targets; j++) {
+						for (int yoff = -1; yoff <= 1; yoff++) {
+							for (int xoff = -1; xoff <= 1; xoff++) {
+								float dx = x - (target_pos[j * 2]     + float(xoff) * 10'000.0f);
+								float dy = y - (target_pos[j * 2 + 1] + float(yoff) * 10'000.0f);
+								float d = dx * dx + dy * dy;
+								if (d < best) {
+									best = d;
+									best_idx = j;
+								}
+							}
+						}
+					}
+
+					result[i] = best_idx;
+				}
+			});
+
+			times[it] = double(SDL_GetPerformanceCounter() - t) / double(SDL_GetPerformanceFrequency());
+		}
+
+		SDL_qsort(times, iterations, sizeof(*times), [](const void* a, const void* b) {
+			double x = *(const double*) a;
+			double y = *(const double*) b;
+			return (x > y) - (x < y);
+		});
+		double median = times[iterations / 2];
+
+		u32 hash = 2166136261u;
+		for (int i = 0; i < seekers; i++) {
+			hash = (hash ^ u32(result[i])) * 16777619u;
+		}
+
+		if (threads == 1) {
+			single_thread_time = median;
+			single_thread_hash = hash;
+		}
+
+		SDL_Log("  %2d threads: %8.3fms, speedup %.2fx%s",
+				threads, median * 1000.0, single_thread_time / median,
+				(hash == single_thread_hash) ? "" : " (RESULT DIFFERS!)");
+	}
+
+	SDL_Log("  chunks stolen so far: %d", SDL_AtomicGet(&jobs.stolen));
+
+	jobs_set_active_threads(prev_active);
+
+	SDL_free(result);
+	SDL_free(seeker_pos);
+	SDL_free(target_pos);
+}
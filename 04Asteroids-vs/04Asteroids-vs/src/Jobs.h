@@ -0,0 +1,74 @@
+#pragma once
+
+#include "common.h"
+#include <SDL.h>
+
+//
+// Thread pool for splitting loops over objects.
+//
+// parallel_for() cuts [0, count) into chunks and deals them out to the workers' queues in order.
+// A worker takes chunks from the back of its own queue, and steals from the front of the others' when it runs out.
+// The calling thread works too, and returns when every chunk is done.
+//
+// A chunk only gets a range of indices, so as long as the loop body only writes to its own elements,
+// the result doesn't depend on the number of threads. Anything that touches shared state
+// (creating objects, rng, sounds) should be recorded per element and applied after, in index order.
+//
+// Any thread can call parallel_for, but only one at a time gets the workers. The others (and calls from inside a job)
+// just run the whole loop themselves, which gives the same result.
+//
+
+#define JOBS_MAX_THREADS 16       // Including the main thread
+#define JOBS_MAX_CHUNKS  256      // Per queue
+#define JOBS_CHUNKS_PER_THREAD 4  // More chunks than threads, so there's something to steal
+
+typedef void (*JobFunc)(void* data, int begin, int end);
+
+struct JobChunk {
+	JobFunc func;
+	void* data;
+	int begin;
+	int end;
+};
+
+struct JobQueue {
+	JobChunk chunks[JOBS_MAX_CHUNKS];
+	int head; // Thieves take from here
+	int tail; // The owner takes from here
+	SDL_SpinLock lock;
+};
+
+struct JobSystem {
+	SDL_Thread* threads[JOBS_MAX_THREADS];
+	int thread_count;    // Worker threads created. Doesn't count the main thread.
+	int active_threads;  // How many threads parallel_for uses, including the main thread. 1 runs everything on the main thread.
+
+	JobQueue queues[JOBS_MAX_THREADS]; // [0] is the main thread's
+
+	SDL_sem* wake;
+	SDL_atomic_t remaining; // Chunks that aren't done yet
+	SDL_atomic_t quit;
+	SDL_atomic_t busy;      // Set while some thread's parallel_for owns the queues
+	SDL_atomic_t stolen;    // For metrics
+};
+
+extern JobSystem jobs;
+
+// threads is the number of threads to use, including the main thread. 0 means one per CPU core.
+void jobs_init(int threads);
+void jobs_quit();
+
+void jobs_set_active_threads(int threads);
+
+// "batch" is the smallest number of elements worth sending to another thread.
+void parallel_for(int count, int batch, JobFunc func, void* data);
+
+template <typename F>
+void ParallelFor(int count, int batch, const F& f) {
+	parallel_for(count, batch, [](void* data, int begin, int end) {
+		(*(const F*) data)(begin, end);
+	}, (void*) &f);
+}
+
+// Runs a loop like the homing bullets' target search with 1 to jobs.thread_count + 1 threads, and logs the timings.
+void jobs_benchmark();
@@ -0,0 +1,117 @@
+#include "Log.h"
+
+Logger logger;
+
+void log_activate(LogSite* site) {
+	if (!logger.thread) {
+		SDL_AtomicSet(&site->hits, 0);
+		SDL_Log("%s", site->msg);
+		return;
+	}
+
+	// Only the hit that flips it gets to push the site, so it's never on the list twice.
+	if (!SDL_AtomicCAS(&site->active, 0, 1)) return;
+
+	LogSite* head;
+	do {
+		head = (LogSite*) SDL_AtomicGetPtr((void**) &logger.pending);
+		site->next = head;
+	} while (!SDL_AtomicCASPtr((void**) &logger.pending, head, site));
+}
+
+struct ActiveSite {
+	LogSite* site;
+	u32 window_start;
+	int printed; // Hits in this window that were already printed
+};
+
+static ActiveSite active_sites[LOG_MAX_ACTIVE_SITES];
+static int active_count;
+
+static void take_pending(u32 now) {
+	LogSite* list = (LogSite*) SDL_AtomicSetPtr((void**) &logger.pending, nullptr);
+
+	// The list is newest first.
+	LogSite* reversed = nullptr;
+	while (list) {
+		LogSite* next = list->next;
+		list->next = reversed;
+		reversed = list;
+		list = next;
+	}
+
+	for (LogSite* site = reversed; site; site = site->next) {
+		SDL_Log("%s", site->msg);
+
+		if (active_count == LOG_MAX_ACTIVE_SITES) {
+			SDL_AtomicSet(&site->hits, 0);
+			SDL_AtomicSet(&site->active, 0);
+			continue;
+		}
+		active_sites[active_count++] = {site, now, 1};
+	}
+}
+
+static void end_windows(u32 now, bool all) {
+	for (int i = 0; i < active_count;) {
+		ActiveSite* a = &active_sites[i];
+		u32 elapsed = now - a->window_start;
+
+		if (!all && elapsed < LOG_WINDOW_MS) {
+			i++;
+			continue;
+		}
+
+		int more = SDL_AtomicSet(&a->site->hits, 0) - a->printed;
+		if (more > 0) {
+			SDL_Log("%s (x%d in the last %.1fs)", a->site->msg, more, double(elapsed) / 1000.0);
+		}
+
+		if (more > 0 && !all) {
+			a->window_start = now;
+			a->printed = 0;
+			i++;
+		} else {
+			// A hit that comes in between the swap and this stays counted, and gets printed with the next one.
+			SDL_AtomicSet(&a->site->active, 0);
+			active_sites[i] = active_sites[--active_count];
+		}
+	}
+}
+
+static int log_proc(void* userdata) {
+	while (!SDL_AtomicGet(&logger.quit)) {
+		SDL_SemWaitTimeout(logger.wake, LOG_POLL_MS);
+
+		u32 now = SDL_GetTicks();
+		take_pending(now);
+		end_windows(now, false);
+	}
+
+	u32 now = SDL_GetTicks();
+	take_pending(now);
+	end_windows(now, true);
+	return 0;
+}
+
+void log_init() {
+	logger.wake = SDL_CreateSemaphore(0);
+	logger.thread = SDL_CreateThread(log_proc, "Log", nullptr);
+	if (!logger.thread) {
+		SDL_Log("Couldn't create the log thread: %s", SDL_GetError());
+	}
+}
+
+void log_quit() {
+	if (logger.thread) {
+		SDL_AtomicSet(&logger.quit, 1);
+		SDL_SemPost(logger.wake);
+		SDL_WaitThread(logger.thread, nullptr);
+		logger.thread = nullptr;
+	}
+	if (logger.wake) {
+		SDL_DestroySemaphore(logger.wake);
+		logger.wake = nullptr;
+	}
+	SDL_AtomicSet(&logger.quit, 0);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.h"
+#include <SDL.h>
+
+//
+// Rate-limited logging for messages that can come from the hot paths every frame, like the object pools being full.
+//
+// A LogSite is one such message. log_hit() counts a hit with an atomic add. The first hit of an idle site also pushes
+// the site onto a lock-free list for the log thread, which prints the message. After that the site only counts,
+// and every LOG_WINDOW_MS the log thread prints how many more hits there were ("Bullet limit hit. (x412 in the last
+// 1.0s)"), until a window goes by with none and the site is idle again. The formatting and the console writes
+// all happen on the log thread.
+//
+// Without log_init() (the tools, headless tests) every hit is printed right away.
+//
+
+#define LOG_WINDOW_MS 1000
+#define LOG_POLL_MS 100
+#define LOG_MAX_ACTIVE_SITES 64
+
+struct LogSite {
+	const char* msg;     // Has to be a string literal.
+	SDL_atomic_t hits;   // Since the log thread last took them
+	SDL_atomic_t active; // From the first hit until a window goes by without any
+	LogSite* next;       // In logger.pending
+};
+
+struct Logger {
+	SDL_Thread* thread;
+	SDL_sem* wake;
+	SDL_atomic_t quit;
+
+	LogSite* pending; // Sites that just got their first hit. Pushed with a CAS, taken all at once by the log thread.
+};
+
+extern Logger logger;
+
+void log_init();
+void log_quit(); // Prints what's left.
+
+void log_activate(LogSite* site);
+
+inline void log_hit(LogSite* site) {
+	SDL_AtomicAdd(&site->hits, 1);
+	if (SDL_AtomicGet(&site->active) == 0) log_activate(site);
+}
@@ -0,0 +1,312 @@
+#include "Metrics.h"
+
+#include "Game.h"
+#include "Assets.h"
+#include "Audio.h"
+#include "AllocTracker.h"
+#include "mathh.h"
+#include <string.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define METRICS_SLOW_FRAMES 30 // Process memory and the percentile are updated this often
+
+#ifdef _WIN32
+#define METRICS_MAPPING_NAME L"Local\\" L"asteroids_metrics"
+#else
+#define METRICS_MAPPING_NAME "/" METRICS_SHM_NAME
+#endif
+
+static u64 get_process_memory() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc = {};
+	pmc.cb = sizeof(pmc);
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+		return u64(pmc.WorkingSetSize);
+	}
+	return 0;
+#elif defined(__linux__)
+	FILE* f = fopen("/proc/self/statm", "r");
+	if (!f) return 0;
+	unsigned long long size = 0;
+	unsigned long long resident = 0;
+	int n = fscanf(f, "%llu %llu", &size, &resident);
+	fclose(f);
+	return (n == 2) ? u64(resident) * u64(sysconf(_SC_PAGESIZE)) : 0;
+#else
+	return 0;
+#endif
+}
+
+static u32 get_pid() {
+#ifdef _WIN32
+	return u32(GetCurrentProcessId());
+#elif !defined(__EMSCRIPTEN__)
+	return u32(getpid());
+#else
+	return 0;
+#endif
+}
+
+bool MetricsExport::Open() {
+	Close();
+
+#ifdef _WIN32
+	HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(MetricsData), METRICS_MAPPING_NAME);
+	if (!mapping) {
+		SDL_Log("Metrics: couldn't create the file mapping (error %lu).", GetLastError());
+		return false;
+	}
+	void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(MetricsData));
+	if (!view) {
+		SDL_Log("Metrics: couldn't map the file mapping (error %lu).", GetLastError());
+		CloseHandle(mapping);
+		return false;
+	}
+	handle = mapping;
+	data = (MetricsData*) view;
+#elif !defined(__EMSCRIPTEN__)
+	fd = shm_open(METRICS_MAPPING_NAME, O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		SDL_Log("Metrics: couldn't open shared memory %s.", METRICS_MAPPING_NAME);
+		return false;
+	}
+	if (ftruncate(fd, sizeof(MetricsData)) != 0) {
+		SDL_Log("Metrics: couldn't resize shared memory %s.", METRICS_MAPPING_NAME);
+		close(fd);
+		shm_unlink(METRICS_MAPPING_NAME);
+		return false;
+	}
+	void* view = mmap(nullptr, sizeof(MetricsData), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (view == MAP_FAILED) {
+		SDL_Log("Metrics: couldn't map shared memory %s.", METRICS_MAPPING_NAME);
+		close(fd);
+		shm_unlink(METRICS_MAPPING_NAME);
+		return false;
+	}
+	data = (MetricsData*) view;
+#else
+	return false;
+#endif
+
+	// A reader that sees the new magic with an old seq would still wait for an even one.
+	SDL_AtomicSet(&data->seq, 1);
+	SDL_MemoryBarrierRelease();
+
+	data->version = METRICS_VERSION;
+	data->size = sizeof(MetricsData);
+	data->pid = get_pid();
+	data->magic = METRICS_MAGIC;
+
+	memory_timer = 0;
+
+	SDL_Log("Publishing metrics to shared memory \"%s\".", METRICS_SHM_NAME);
+	return true;
+}
+
+void MetricsExport::Publish(Game* g) {
+	if (!data) return;
+
+	MetricsData* m = data;
+
+	// Odd while writing.
+	int seq = SDL_AtomicGet(&m->seq);
+	SDL_AtomicSet(&m->seq, seq | 1);
+	SDL_MemoryBarrierRelease();
+
+	m->frame = g->frame_times.total_frames;
+	m->time  = double(SDL_GetTicks()) / 1000.0;
+
+	m->fps        = g->fps;
+	m->update_ms  = g->update_took;
+	m->draw_ms    = g->draw_took;
+	m->present_ms = g->present_took;
+	if (g->frame_times.count > 0) {
+		int last = (g->frame_times.head + FRAME_TIMES_LEN - 1) % FRAME_TIMES_LEN;
+		m->frame_ms = g->frame_times.samples[last].frame;
+	}
+
+	if (g->state == GameState::PLAYING) {
+		World* w = g->draw_world;
+		m->enemies     = w->get_enemy_count();
+		m->enemies_all = w->enemy_count;
+		m->bullets     = w->bullet_count;
+		m->p_bullets   = w->p_bullet_count;
+		m->allies      = w->ally_count;
+		m->chests      = w->chest_count;
+		m->particles   = w->particles.particle_count;
+	}
+
+	m->heap_live_bytes  = alloc_tracker.live_bytes;
+	m->heap_live_allocs = alloc_tracker.live;
+
+	if (memory_timer <= 0) {
+		m->process_memory = get_process_memory();
+		m->frame_p99_ms = g->frame_times.Compute(&FrameTimeSample::frame).p99;
+		memory_timer = METRICS_SLOW_FRAMES;
+	}
+	memory_timer--;
+
+	m->channel_count = min(Mix_AllocateChannels(-1), METRICS_MAX_CHANNELS);
+	for (int i = 0; i < m->channel_count; i++) {
+		MetricsChannel* c = &m->channels[i];
+
+		Mix_Chunk* chunk = Mix_GetChunk(i);
+		c->sound = -1;
+		for (int j = 0; j < SOUND_COUNT; j++) {
+			if (chunk == Chunks[j]) {
+				c->sound = i8(j);
+				break;
+			}
+		}
+
+		c->playing = (Mix_Playing(i) != 0);
+		c->priority = (i < MIX_CHANNELS) ? u16(channel_priority[i]) : 0;
+		c->when_played = (i < MIX_CHANNELS) ? channel_when_played[i] : 0;
+	}
+
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&m->seq, (seq | 1) + 1);
+}
+
+void MetricsExport::Close() {
+	if (!data) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE) handle);
+	handle = nullptr;
+#elif !defined(__EMSCRIPTEN__)
+	munmap(data, sizeof(MetricsData));
+	close(fd);
+	shm_unlink(METRICS_MAPPING_NAME);
+#endif
+
+	data = nullptr;
+}
+
+// SDL_AtomicGet can be a locked read-modify-write (_InterlockedOr with MSVC), which faults on a read-only view.
+static int load_seq(const MetricsData* shared) {
+	int seq = *(const volatile int*) &shared->seq.value;
+	SDL_MemoryBarrierAcquire();
+	return seq;
+}
+
+// Returns false if the writer kept changing it.
+static bool read_metrics(const MetricsData* shared, MetricsData* out) {
+	for (int attempt = 0; attempt < 1000; attempt++) {
+		int seq1 = load_seq(shared);
+		if (seq1 & 1) {
+			SDL_CPUPauseInstruction();
+			continue;
+		}
+
+		memcpy(out, shared, sizeof(*out));
+
+		SDL_MemoryBarrierAcquire();
+		int seq2 = load_seq(shared);
+		if (seq1 == seq2) return true;
+	}
+	return false;
+}
+
+int metrics_watch() {
+	const MetricsData* shared = nullptr;
+
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, METRICS_MAPPING_NAME);
+	if (mapping) {
+		shared = (const MetricsData*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(MetricsData));
+	}
+#elif !defined(__EMSCRIPTEN__)
+	int fd = shm_open(METRICS_MAPPING_NAME, O_RDONLY, 0);
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && usize(st.st_size) >= sizeof(MetricsData)) {
+			void* view = mmap(nullptr, sizeof(MetricsData), PROT_READ, MAP_SHARED, fd, 0);
+			if (view != MAP_FAILED) shared = (const MetricsData*) view;
+		}
+		close(fd);
+	}
+#endif
+
+	if (!shared) {
+		SDL_Log("No metrics to watch. Start the game with METRICS_SHM=1 first.");
+		return 1;
+	}
+
+	if (shared->magic != METRICS_MAGIC || shared->version != METRICS_VERSION || shared->size != sizeof(MetricsData)) {
+		SDL_Log("The metrics are from a different build (version %u, %u bytes; this one reads version %u, %u bytes).",
+				shared->version, shared->size, METRICS_VERSION, (u32) sizeof(MetricsData));
+		return 1;
+	}
+
+	SDL_Log("Watching pid %u.", shared->pid);
+
+	// The bar is 33ms wide, so a frame over 30 fps fills it.
+	const int bar_len = 20;
+	const double bar_ms = 1000.0 / 30.0;
+
+	u64 prev_frame = 0;
+	u32 stalled_since = 0;
+
+	while (true) {
+		MetricsData m;
+		if (!read_metrics(shared, &m)) {
+			SDL_Delay(1);
+			continue;
+		}
+
+		u32 now = SDL_GetTicks();
+		if (m.frame == prev_frame) {
+			if (stalled_since == 0) stalled_since = now;
+			if (now - stalled_since > 5000) {
+				SDL_Log("No new frames for 5 seconds. The game is gone or hung.");
+				break;
+			}
+		} else {
+			stalled_since = 0;
+		}
+		prev_frame = m.frame;
+
+		char bar[bar_len + 1];
+		int filled = clamp(int(m.frame_ms / bar_ms * double(bar_len) + 0.5), 0, bar_len);
+		for (int i = 0; i < bar_len; i++) bar[i] = (i < filled) ? '#' : '.';
+		bar[bar_len] = 0;
+
+		int playing = 0;
+		for (int i = 0; i < m.channel_count; i++) {
+			if (m.channels[i].playing) playing++;
+		}
+
+		SDL_Log("%8llu %7.1fs  %6.1f fps  %6.2fms [%s] p99 %6.2f  upd %5.2f  draw %5.2f  pres %5.2f"
+				"  | en %d/%d  bul %d  pbul %d  all %d  part %d  | mem %.1f MB  heap %.1f MB  | audio %d/%d",
+				(unsigned long long) m.frame, m.time, m.fps, m.frame_ms, bar, m.frame_p99_ms,
+				m.update_ms, m.draw_ms, m.present_ms,
+				m.enemies, m.enemies_all, m.bullets, m.p_bullets, m.allies, m.particles,
+				double(m.process_memory) / (1024.0 * 1024.0), double(m.heap_live_bytes) / (1024.0 * 1024.0),
+				playing, m.channel_count);
+
+		SDL_Delay(METRICS_WATCH_INTERVAL);
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(shared);
+	CloseHandle(mapping);
+#elif !defined(__EMSCRIPTEN__)
+	munmap((void*) shared, sizeof(MetricsData));
+#endif
+
+	return 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "common.h"
+#include <SDL.h>
+
+//
+// Live metrics in shared memory, for watching a long session from another process.
+//
+// With METRICS_SHM=1 the game creates the segment METRICS_SHM_NAME (POSIX shm_open, or a named file mapping
+// on Windows) and publishes a MetricsData into it at the end of every frame.
+// Run "--watch" in another terminal to print it live.
+//
+// The payload is protected by a seqlock: "seq" is odd while the game is writing. A reader copies the struct,
+// and keeps it only if seq was even and the same before and after the copy.
+//
+
+#define METRICS_SHM_NAME "asteroids_metrics"
+#define METRICS_MAGIC 0x4D455452 // "METR"
+#define METRICS_VERSION 1
+#define METRICS_MAX_CHANNELS 32
+#define METRICS_WATCH_INTERVAL 250 // Milliseconds
+
+struct MetricsChannel {
+	u8 playing;
+	i8 sound;  // Index into Chunks, -1 if it's not one of them
+	u16 priority;
+	u32 when_played;
+};
+
+struct MetricsData {
+	// Header. Doesn't change after the segment is created.
+	u32 magic;
+	u32 version;
+	u32 size; // sizeof(MetricsData) of the writer
+	u32 pid;
+
+	SDL_atomic_t seq;
+
+	// Payload.
+	u64 frame;
+	double time; // Seconds since the game started
+
+	double fps;
+	double frame_ms;
+	double update_ms;
+	double draw_ms;
+	double present_ms;
+	double frame_p99_ms; // Over the last FRAME_TIMES_LEN frames
+
+	int enemies;
+	int enemies_all; // Including the asteroids
+	int bullets;
+	int p_bullets;
+	int allies;
+	int chests;
+	int particles;
+
+	u64 process_memory; // Bytes. Working set on Windows, resident set on Linux.
+	u64 heap_live_bytes; // From the allocation tracker, 0 if it's off
+	int heap_live_allocs;
+
+	int channel_count;
+	MetricsChannel channels[METRICS_MAX_CHANNELS];
+};
+
+struct Game;
+
+struct MetricsExport {
+	MetricsData* data; // Null if not exporting
+	void* handle;      // File mapping handle on Windows
+	int fd;
+	int memory_timer;
+
+	bool Open();
+	void Publish(Game* g);
+	void Close();
+};
+
+// Reads the segment of a running game and prints it every METRICS_WATCH_INTERVAL. Returns the exit code.
+int metrics_watch();
@@ -0,0 +1,265 @@
+#include "Profiler.h"
+
+#include "Assets.h"
+#include "ecalloc.h"
+#include "stb_sprintf.h"
+#include <string.h>
+
+Profiler profiler;
+
+static thread_local ProfileThread* this_thread;
+static thread_local bool this_thread_failed;
+
+static ProfileThread* get_this_thread() {
+	if (this_thread) return this_thread;
+	if (this_thread_failed) return nullptr;
+
+	int index = SDL_AtomicAdd(&profiler.thread_count, 1);
+	if (index >= PROFILER_MAX_THREADS) {
+		SDL_AtomicAdd(&profiler.thread_count, -1);
+		SDL_Log("Profiler: too many threads.");
+		this_thread_failed = true;
+		return nullptr;
+	}
+
+	ProfileThread* t = (ProfileThread*) ecalloc(1, sizeof(ProfileThread));
+	t->id = SDL_ThreadID();
+
+	SDL_AtomicSetPtr((void**) &profiler.threads[index], t);
+
+	this_thread = t;
+	return t;
+}
+
+int profiler_enter() {
+	ProfileThread* t = get_this_thread();
+	if (!t) return 0;
+
+	return t->depth++;
+}
+
+void profiler_leave(const char* name, u64 start, int depth) {
+	u64 end = SDL_GetPerformanceCounter();
+
+	ProfileThread* t = get_this_thread();
+	if (!t) return;
+
+	t->depth = depth;
+
+	// Only this thread writes to its ring, so the zone can be filled in before publishing the new head.
+	u32 head = (u32) SDL_AtomicGet(&t->head);
+	ProfileZone* z = &t->zones[head & (PROFILER_RING_SIZE - 1)];
+	z->name  = name;
+	z->start = start;
+	z->end   = end;
+	z->depth = depth;
+
+	SDL_AtomicSet(&t->head, (int) (head + 1));
+}
+
+void profiler_begin_frame() {
+	profiler.main_thread = get_this_thread();
+
+	profiler.prev_frame_start = profiler.frame_start;
+	profiler.frame_start = SDL_GetPerformanceCounter();
+}
+
+void profiler_free() {
+	int count = SDL_AtomicGet(&profiler.thread_count);
+	for (int i = 0; i < count; i++) {
+		SDL_free(profiler.threads[i]);
+		profiler.threads[i] = nullptr;
+	}
+	SDL_AtomicSet(&profiler.thread_count, 0);
+	profiler.main_thread = nullptr;
+
+	// Only clears the calling thread's pointer. Call this at the very end.
+	this_thread = nullptr;
+}
+
+// Copies the zones that are currently in a thread's ring. Returns the count.
+// The owning thread can keep writing, so zones that got overwritten during the copy are thrown away.
+static int copy_zones(ProfileThread* t, ProfileZone* out) {
+	u32 head = (u32) SDL_AtomicGet(&t->head);
+	u32 count = (head < PROFILER_RING_SIZE) ? head : PROFILER_RING_SIZE;
+	u32 first = head - count;
+
+	for (u32 i = 0; i < count; i++) {
+		out[i] = t->zones[(first + i) & (PROFILER_RING_SIZE - 1)];
+	}
+
+	// The owner fills in the slot at head before bumping it, so the slot at new_head may be half-written
+	// and counts as overwritten too.
+	SDL_MemoryBarrierAcquire();
+	u32 new_head = (u32) SDL_AtomicGet(&t->head);
+	u32 reach = new_head + 1 - first; // Slots from "first" on that the owner has been in
+	if (reach <= PROFILER_RING_SIZE) return (int) count;
+
+	u32 overwritten = reach - PROFILER_RING_SIZE;
+	if (overwritten >= count) return 0;
+
+	memmove(out, out + overwritten, (count - overwritten) * sizeof(*out));
+	return (int) (count - overwritten);
+}
+
+bool profiler_dump_trace(const char* fname, double seconds) {
+	SDL_RWops* f = SDL_RWFromFile(fname, "wb");
+	if (!f) {
+		SDL_Log("Profiler: couldn't open %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	ProfileZone* zones = (ProfileZone*) ecalloc(PROFILER_RING_SIZE, sizeof(ProfileZone));
+
+	double freq = double(SDL_GetPerformanceFrequency());
+	u64 now = SDL_GetPerformanceCounter();
+	u64 since = now - u64(seconds * freq);
+
+	char buf[256];
+	int written = 0;
+
+	auto write = [&](const char* s) {
+		SDL_RWwrite(f, s, 1, strlen(s));
+	};
+
+	write("{\"traceEvents\":[\n");
+
+	int thread_count = SDL_AtomicGet(&profiler.thread_count);
+	for (int i = 0; i < thread_count; i++) {
+		ProfileThread* t = (ProfileThread*) SDL_AtomicGetPtr((void**) &profiler.threads[i]);
+		if (!t) continue;
+
+		stb_snprintf(buf, sizeof(buf),
+					 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s %lu\"}}",
+					 (written > 0) ? ",\n" : "", i,
+					 (t == profiler.main_thread) ? "Main" : "Thread", (unsigned long) t->id);
+		write(buf);
+		written++;
+
+		int count = copy_zones(t, zones);
+		for (int j = 0; j < count; j++) {
+			ProfileZone* z = &zones[j];
+			if (z->end < since) continue;
+
+			// Zones that were already open "seconds" ago get cut off there.
+			u64 start = (z->start < since) ? since : z->start;
+
+			// Timestamps are in microseconds.
+			double ts  = double(start - since) / freq * 1'000'000.0;
+			double dur = double(z->end - start) / freq * 1'000'000.0;
+
+			stb_snprintf(buf, sizeof(buf),
+						 ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+						 z->name, i, ts, dur);
+			write(buf);
+			written++;
+		}
+	}
+
+	write("\n]}\n");
+
+	SDL_free(zones);
+	SDL_RWclose(f);
+
+	SDL_Log("Profiler: wrote %d events to %s", written, fname);
+	return true;
+}
+
+static const int row_h = 18;
+
+// Draws the zones of one thread that overlap the frame, one row per depth, under a row with the thread's name.
+// Returns the y below them, or "y" if the thread had none.
+static int draw_thread_zones(SDL_Renderer* renderer, ProfileThread* t, int x, int y, int w,
+							 u64 frame_begin, u64 frame_end, double scale_ms) {
+	static ProfileZone zones[PROFILER_RING_SIZE];
+	int count = copy_zones(t, zones);
+
+	double freq = double(SDL_GetPerformanceFrequency());
+
+	// Other threads don't keep to the main thread's frames, so their zones are cut off at the frame's edges.
+	int max_depth = -1;
+	for (int i = 0; i < count; i++) {
+		if (zones[i].end > frame_begin && zones[i].start < frame_end) {
+			if (zones[i].depth > max_depth) max_depth = zones[i].depth;
+		}
+	}
+	if (max_depth == -1) return y;
+
+	{
+		SDL_Rect back = {x, y, w, (max_depth + 2) * row_h};
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 192);
+		SDL_RenderFillRect(renderer, &back);
+
+		char buf[64];
+		stb_snprintf(buf, sizeof(buf), "%s %lu", (t == profiler.main_thread) ? "Main" : "Thread", (unsigned long) t->id);
+		DrawText(renderer, fnt_cp437, buf, x + 2, y + 2);
+	}
+
+	for (int i = 0; i < count; i++) {
+		ProfileZone* z = &zones[i];
+		if (z->end <= frame_begin || z->start >= frame_end) continue;
+
+		u64 start = (z->start < frame_begin) ? frame_begin : z->start;
+		u64 end   = (z->end > frame_end) ? frame_end : z->end;
+
+		double start_ms = double(start - frame_begin) / freq * 1000.0;
+		double dur_ms   = double(end - start)         / freq * 1000.0;
+
+		SDL_Rect rect;
+		rect.x = x + int(start_ms / scale_ms * double(w));
+		rect.y = y + (z->depth + 1) * row_h;
+		rect.w = int(dur_ms / scale_ms * double(w));
+		rect.h = row_h - 1;
+		if (rect.w < 1) rect.w = 1;
+
+		// Color from the name, so a zone keeps its color between frames.
+		u32 hash = u32(uintptr_t(z->name) * 2654435761u);
+		SDL_SetRenderDrawColor(renderer, 96 + (hash >> 8) % 128, 96 + (hash >> 16) % 128, 96 + (hash >> 24) % 128, 255);
+		SDL_RenderFillRect(renderer, &rect);
+
+		// The whole zone's time, even if it's cut off.
+		char buf[64];
+		stb_snprintf(buf, sizeof(buf), "%s %.2fms", z->name, double(z->end - z->start) / freq * 1000.0);
+		if (MeasureText(fnt_cp437, buf).x <= rect.w) {
+			DrawText(renderer, fnt_cp437, buf, rect.x + 2, rect.y + 1, 0, 0, SDL_Color{0, 0, 0, 255});
+		}
+	}
+
+	return y + (max_depth + 2) * row_h;
+}
+
+void profiler_draw_flame_graph(SDL_Renderer* renderer, int x, int y, int w) {
+	if (!profiler.main_thread) return;
+	if (profiler.prev_frame_start == 0) return;
+
+	double freq = double(SDL_GetPerformanceFrequency());
+	u64 frame_begin = profiler.prev_frame_start;
+	u64 frame_end   = profiler.frame_start;
+
+	// At least one 60 fps frame wide, so the bars don't jump around when the frame time changes a bit.
+	double frame_ms = double(frame_end - frame_begin) / freq * 1000.0;
+	double scale_ms = (frame_ms > 1000.0 / 60.0) ? frame_ms : 1000.0 / 60.0;
+
+	{
+		SDL_Rect back = {x, y, w, row_h};
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 192);
+		SDL_RenderFillRect(renderer, &back);
+
+		char buf[64];
+		stb_snprintf(buf, sizeof(buf), "frame: %.2fms (F7 - dump trace)", frame_ms);
+		DrawText(renderer, fnt_cp437, buf, x + 2, y + 2);
+		y += row_h;
+	}
+
+	// The main thread on top, then every other one that did something during the frame:
+	// the simulation thread and the job workers.
+	y = draw_thread_zones(renderer, profiler.main_thread, x, y, w, frame_begin, frame_end, scale_ms);
+
+	int thread_count = SDL_AtomicGet(&profiler.thread_count);
+	for (int i = 0; i < thread_count; i++) {
+		ProfileThread* t = (ProfileThread*) SDL_AtomicGetPtr((void**) &profiler.threads[i]);
+		if (!t || t == profiler.main_thread) continue;
+
+		y = draw_thread_zones(renderer, t, x, y, w, frame_begin, frame_end, scale_ms);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "common.h"
+#include <SDL.h>
+
+//
+// Hierarchical CPU profiler.
+//
+// PROFILE_SCOPE("Name") records a zone from that line to the end of the scope.
+// Every thread writes finished zones into its own ring buffer, no locks.
+// When the profiler is disabled a zone is just a check of profiler.enabled.
+//
+
+#define PROFILER_MAX_THREADS 8
+#define PROFILER_RING_SIZE (1 << 16) // Zones per thread. Power of 2.
+#define PROFILER_DUMP_SECONDS 5.0
+
+struct ProfileZone {
+	const char* name; // Has to be a string literal.
+	u64 start;        // SDL_GetPerformanceCounter()
+	u64 end;
+	int depth;
+};
+
+struct ProfileThread {
+	ProfileZone zones[PROFILER_RING_SIZE];
+	SDL_atomic_t head; // Number of zones written. Wraps around.
+	int depth;
+	SDL_threadID id;
+};
+
+struct Profiler {
+	bool enabled;
+
+	ProfileThread* threads[PROFILER_MAX_THREADS];
+	SDL_atomic_t thread_count;
+
+	ProfileThread* main_thread; // The one that calls profiler_begin_frame
+	u64 frame_start;
+	u64 prev_frame_start;
+};
+
+extern Profiler profiler;
+
+void profiler_begin_frame();
+void profiler_free();
+
+// Writes the last "seconds" of zones from all threads as Chrome trace_event JSON (chrome://tracing, Perfetto).
+bool profiler_dump_trace(const char* fname, double seconds = PROFILER_DUMP_SECONDS);
+
+// Draws the previous frame's zones, one row per depth. The main thread's on top, then the other threads' that had any.
+void profiler_draw_flame_graph(SDL_Renderer* renderer, int x, int y, int w);
+
+int  profiler_enter();
+void profiler_leave(const char* name, u64 start, int depth);
+
+struct ProfileScope {
+	const char* name;
+	u64 start;
+	int depth;
+
+	ProfileScope(const char* _name) {
+		name = nullptr;
+		if (profiler.enabled) {
+			name  = _name;
+			depth = profiler_enter();
+			start = SDL_GetPerformanceCounter();
+		}
+	}
+
+	~ProfileScope() {
+		if (name) profiler_leave(name, start, depth);
+	}
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(_profile_scope_, __LINE__)(name)
@@ -0,0 +1,266 @@
+#include "Sectors.h"
+
+#include "Game.h"
+#include "Profiler.h"
+#include "ecalloc.h"
+#include "mathh.h"
+#include <math.h>
+#include <string.h>
+
+static float wrap_position(double v, float size) {
+	double r = fmod(v, double(size));
+	if (r < 0.0) r += double(size);
+	float result = float(r);
+	if (result >= size) result = 0.0f; // Rounded up
+	return result;
+}
+
+static int sector_at(float x, float y) {
+	int sx = clamp(int(x / SECTOR_SIZE), 0, SECTORS_X - 1);
+	int sy = clamp(int(y / SECTOR_SIZE), 0, SECTORS_Y - 1);
+	return sx + sy * SECTORS_X;
+}
+
+// Distance from (x, y) to the closest point of the sector, counting the wrapped copies.
+static float distance_to_sector(int sx, int sy, float x, float y) {
+	float dx = x - (float(sx) + 0.5f) * SECTOR_SIZE;
+	float dy = y - (float(sy) + 0.5f) * SECTOR_SIZE;
+	dx -= MAP_W * roundf(dx / MAP_W);
+	dy -= MAP_H * roundf(dy / MAP_H);
+	dx = max(fabsf(dx) - SECTOR_SIZE / 2.0f, 0.0f);
+	dy = max(fabsf(dy) - SECTOR_SIZE / 2.0f, 0.0f);
+	return sqrtf(dx * dx + dy * dy);
+}
+
+static void asteroid_position(const DormantAsteroid* a, double elapsed, float* x, float* y) {
+	*x = wrap_position(double(a->x) + double(a->hsp) * elapsed, MAP_W);
+	*y = wrap_position(double(a->y) + double(a->vsp) * elapsed, MAP_H);
+}
+
+// (x, y) is where it is now. It's stored at the sector's time, like the others in there.
+static void link_asteroid(Sectors* s, int i, float x, float y) {
+	DormantAsteroid* a = &s->asteroids[i];
+	int to = sector_at(x, y);
+	Sector* sec = &s->grid[to];
+
+	double back = s->time - sec->time;
+	a->x = float(double(x) - double(a->hsp) * back);
+	a->y = float(double(y) - double(a->vsp) * back);
+
+	a->next = sec->first;
+	sec->first = i;
+	sec->count++;
+}
+
+static void free_asteroid(Sectors* s, int i) {
+	s->asteroids[i] = {};
+	s->asteroids[i].next = s->free_list;
+	s->free_list = i;
+	s->count--;
+}
+
+void Sectors::Init() {
+	grid      = (Sector*)          ecalloc(SECTOR_COUNT,          sizeof *grid);
+	asteroids = (DormantAsteroid*) ecalloc(MAX_DORMANT_ASTEROIDS, sizeof *asteroids);
+
+	for (int i = 0; i < SECTOR_COUNT; i++) {
+		grid[i].first = -1;
+	}
+	slot_count = 0;
+	free_list = -1;
+	count = 0;
+	time = 0.0;
+	max_spd = 0.0f;
+	rebucket_next = 0;
+}
+
+void Sectors::Free() {
+	SDL_free(asteroids);
+	SDL_free(grid);
+	asteroids = nullptr;
+	grid = nullptr;
+}
+
+bool Sectors::Add(float x, float y, float hsp, float vsp, int type, float experience, float money) {
+	int i;
+	if (free_list != -1) {
+		i = free_list;
+		free_list = asteroids[i].next;
+	} else if (slot_count < MAX_DORMANT_ASTEROIDS) {
+		i = slot_count++;
+	} else {
+		return false;
+	}
+
+	DormantAsteroid* a = &asteroids[i];
+	a->hsp = hsp;
+	a->vsp = vsp;
+	a->experience = experience;
+	a->money = money;
+	a->type = type;
+	link_asteroid(this, i, x, y);
+
+	count++;
+	max_spd = max(max_spd, length(hsp, vsp));
+	return true;
+}
+
+void Sectors::GetPosition(int sector, int i, float* x, float* y) const {
+	asteroid_position(&asteroids[i], time - grid[sector].time, x, y);
+}
+
+static void mark_shot_sectors(Sectors* s, World* w, bool* shot) {
+	const Player* p = &w->player;
+	float stale = s->max_spd * float(s->time - s->grid[s->rebucket_next].time);
+
+	for (int i = 0; i < w->p_bullet_count; i++) {
+		const Bullet* b = &w->p_bullets[i];
+
+		// A homing missile looks for a target this far around it.
+		float reach = stale + ((b->type == BulletType::HOMING) ? DIST_OFFSCREEN : SECTOR_SHOT_MARGIN);
+
+		// Everything it could reach is awake already.
+		if (point_distance_wrapped(b->x, b->y, p->x, p->y) < SECTOR_WAKE_DIST - reach) continue;
+
+		int sx0 = int(floorf((b->x - reach) / SECTOR_SIZE));
+		int sx1 = int(floorf((b->x + reach) / SECTOR_SIZE));
+		int sy0 = int(floorf((b->y - reach) / SECTOR_SIZE));
+		int sy1 = int(floorf((b->y + reach) / SECTOR_SIZE));
+		sx1 = min(sx1, sx0 + SECTORS_X - 1);
+		sy1 = min(sy1, sy0 + SECTORS_Y - 1);
+
+		for (int sy = sy0; sy <= sy1; sy++) {
+			for (int sx = sx0; sx <= sx1; sx++) {
+				shot[wrap(sx, SECTORS_X) + wrap(sy, SECTORS_Y) * SECTORS_X] = true;
+			}
+		}
+	}
+}
+
+static void sleep_far_asteroids(Sectors* s, World* w, const bool* shot) {
+	bool* marked = w->enemy_destroyed;
+	memset(marked, 0, w->enemy_count * sizeof *marked);
+
+	const Player* p = &w->player;
+	bool any = false;
+
+	for (int i = 0; i < w->enemy_count; i++) {
+		const Enemy* e = &w->enemies[i];
+		if (e->type >= TYPE_ENEMY || e->co || (e->flags & FLAG_INSTANCE_DEAD)) continue;
+
+		if (point_distance_wrapped(e->x, e->y, p->x, p->y) < SECTOR_SLEEP_DIST) continue;
+		if (shot[sector_at(e->x, e->y)]) continue;
+
+		if (s->Add(e->x, e->y, e->hsp, e->vsp, e->type, e->experience, e->money)) {
+			marked[i] = true;
+			any = true;
+		}
+	}
+
+	if (any) w->DestroyMarkedEnemies(marked);
+}
+
+static void rebucket(Sectors* s) {
+	for (int n = 0; n < SECTOR_REBUCKET_PER_UPDATE; n++) {
+		int from = s->rebucket_next;
+		s->rebucket_next = (s->rebucket_next + 1) % SECTOR_COUNT;
+
+		Sector* sec = &s->grid[from];
+		double elapsed = s->time - sec->time;
+
+		// Unlinked first, so that the ones that stay go back with the new time.
+		int list = sec->first;
+		sec->first = -1;
+		sec->count = 0;
+		sec->time = s->time;
+
+		while (list != -1) {
+			int i = list;
+			list = s->asteroids[i].next;
+
+			float x;
+			float y;
+			asteroid_position(&s->asteroids[i], elapsed, &x, &y);
+			link_asteroid(s, i, x, y);
+		}
+	}
+}
+
+// Wakes the asteroids of the sector that are within "reach" of the player, or all of them if "all".
+static void wake_sector(Sectors* s, World* w, int index, bool all) {
+	const Player* p = &w->player;
+	Sector* sec = &s->grid[index];
+	double elapsed = s->time - sec->time;
+
+	int* link = &sec->first;
+	while (*link != -1) {
+		int i = *link;
+		DormantAsteroid* a = &s->asteroids[i];
+
+		float x;
+		float y;
+		asteroid_position(a, elapsed, &x, &y);
+
+		// With the pool full it waits until there's room, instead of pushing out the oldest enemy.
+		if ((!all && point_distance_wrapped(x, y, p->x, p->y) >= SECTOR_WAKE_DIST) || w->enemy_count == MAX_ENEMIES) {
+			link = &a->next;
+			continue;
+		}
+
+		make_asteroid(w, x, y, a->hsp, a->vsp, a->type, a->experience, a->money);
+
+		*link = a->next;
+		sec->count--;
+		free_asteroid(s, i);
+	}
+}
+
+static void wake_asteroids(Sectors* s, World* w, const bool* shot) {
+	const Player* p = &w->player;
+
+	for (int i = 0; i < SECTOR_COUNT; i++) {
+		if (shot[i] && s->grid[i].count > 0) wake_sector(s, w, i, true);
+	}
+
+	// The sector up next for a rebucket is the stalest one.
+	float stale = s->max_spd * float(s->time - s->grid[s->rebucket_next].time);
+	float reach = SECTOR_WAKE_DIST + stale;
+
+	int sx0 = int(floorf((p->x - reach) / SECTOR_SIZE));
+	int sx1 = int(floorf((p->x + reach) / SECTOR_SIZE));
+	int sy0 = int(floorf((p->y - reach) / SECTOR_SIZE));
+	int sy1 = int(floorf((p->y + reach) / SECTOR_SIZE));
+	sx1 = min(sx1, sx0 + SECTORS_X - 1);
+	sy1 = min(sy1, sy0 + SECTORS_Y - 1);
+
+	for (int sy = sy0; sy <= sy1; sy++) {
+		for (int sx = sx0; sx <= sx1; sx++) {
+			int wx = wrap(sx, SECTORS_X);
+			int wy = wrap(sy, SECTORS_Y);
+			int index = wx + wy * SECTORS_X;
+			Sector* sec = &s->grid[index];
+
+			if (sec->count == 0) continue;
+
+			float sector_reach = SECTOR_WAKE_DIST + s->max_spd * float(s->time - sec->time);
+			if (distance_to_sector(wx, wy, p->x, p->y) > sector_reach) continue;
+
+			wake_sector(s, w, index, false);
+		}
+	}
+}
+
+void Sectors::Update(World* w, float delta) {
+	PROFILE_SCOPE("Sectors");
+
+	time += double(delta);
+
+	if (!enabled) return;
+
+	bool shot[SECTOR_COUNT] = {};
+	mark_shot_sectors(this, w, shot);
+
+	sleep_far_asteroids(this, w, shot);
+	rebucket(this);
+	wake_asteroids(this, w, shot);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "common.h"
+
+//
+// Lazy simulation of the asteroids that are far from the player.
+//
+// The map is split into SECTOR_SIZE squares. An asteroid farther than SECTOR_SLEEP_DIST from the player leaves the
+// enemies array and goes to sleep in the sector it's in, as its position, velocity and what it's worth. Nothing
+// touches a sleeping asteroid: it can't be hit and doesn't hit anything, so it only moves in a straight line, and
+// its position is worked out when it's needed from the time that passed since the sector's "time".
+// Within SECTOR_WAKE_DIST it's put back into the enemies array, as it would have been.
+//
+// The player's shots go farther than that: a bullet flies up to about 3000 units and a homing missile for 10
+// seconds, far enough to cross the map. The sectors around a shot that's out there (SECTOR_SHOT_MARGIN, or the
+// range a missile looks for targets in) are kept awake, so that it can still hit, or home in on, what's in them.
+//
+// Sleeping asteroids cross into other sectors while nobody looks, so every update SECTOR_REBUCKET_PER_UPDATE sectors
+// (round robin) move theirs to the sector they're in by now. When looking for asteroids to wake, a sector is
+// checked if it's within reach of the wake distance plus how far its asteroids could have gone since then.
+//
+// Per update that's a handful of sectors around the player and 1/SECTOR_REBUCKET_UPDATES of the sleeping asteroids,
+// instead of moving and colliding every asteroid on the map.
+//
+// SECTORS=0 turns it off, and the stress scenarios don't use it, they're about the pools being full.
+//
+
+#define SECTOR_SIZE 1000.0f
+#define SECTORS_X int(MAP_W / SECTOR_SIZE)
+#define SECTORS_Y int(MAP_H / SECTOR_SIZE)
+#define SECTOR_COUNT (SECTORS_X * SECTORS_Y)
+
+#define SECTOR_WAKE_DIST  (2.0f * DIST_OFFSCREEN)       // Past what the player can see or hear
+#define SECTOR_SLEEP_DIST (SECTOR_WAKE_DIST + 400.0f)   // Farther, so that one on the edge doesn't flip every frame
+#define SECTOR_SHOT_MARGIN 150.0f                       // Around a bullet: the biggest asteroid and a frame of flight
+
+#define SECTOR_REBUCKET_UPDATES 50 // Every sector gets rebucketed this often
+#define SECTOR_REBUCKET_PER_UPDATE ((SECTOR_COUNT + SECTOR_REBUCKET_UPDATES - 1) / SECTOR_REBUCKET_UPDATES)
+
+#define MAX_DORMANT_ASTEROIDS 8192
+
+struct World;
+
+struct DormantAsteroid {
+	float x;     // At the sector's "time", not wrapped
+	float y;
+	float hsp;
+	float vsp;
+	float experience;
+	float money;
+	int type;
+	int next;    // In the sector, or in the free list. -1 ends it.
+};
+
+struct Sector {
+	int first;   // -1 if empty
+	int count;
+	double time; // When it was last rebucketed
+};
+
+struct Sectors {
+	bool enabled = true; // Set before World::Init
+
+	Sector* grid;
+	DormantAsteroid* asteroids;
+	int slot_count;      // Slots ever used. Freed ones are in free_list.
+	int free_list;
+	int count;
+
+	double time;         // Sum of the deltas the world moved by
+	float max_spd;       // Of any asteroid that went to sleep
+	int rebucket_next;   // Also the sector that went longest without a rebucket
+
+	void Init();
+	void Free();
+
+	// Returns false if there's no room. The asteroid is at (x, y) now.
+	bool Add(float x, float y, float hsp, float vsp, int type, float experience, float money);
+
+	// After the physics update. Puts far asteroids to sleep and wakes the ones that came close.
+	void Update(World* w, float delta);
+
+	// Where asteroid "i" of sector "sector" is now.
+	void GetPosition(int sector, int i, float* x, float* y) const;
+};
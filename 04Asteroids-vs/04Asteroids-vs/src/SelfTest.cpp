@@ -0,0 +1,164 @@
+#include "SelfTest.h"
+
+#include "World.h"
+#include "WorldHash.h"
+#include "WorldState.h"
+#include "Stress.h"
+#include "Jobs.h"
+#include "ecalloc.h"
+
+struct SelfTestCase {
+	const char* name;
+	void (*script)(mco_coro*); // Null for the normal stage
+	int frames;
+};
+
+static void init_world(World* w, const SelfTestCase* c) {
+	if (c->script) {
+		// Same as a stress run.
+		w->sectors.enabled = false;
+	} else {
+		// So the flow field gets checked too.
+		w->flow.separation = true;
+	}
+
+	w->Init(SELFTEST_SEED, true);
+	if (c->script) w->StartStage(c->script);
+}
+
+// Logs the fields that differ.
+static bool same_hash(const WorldHash* a, const WorldHash* b, const char* check, const SelfTestCase* c, int frame) {
+	if (a->total == b->total) return true;
+
+	SDL_Log("  %-12s %-16s differs at update %d:", check, c->name, frame);
+	for (int i = 0; i < world_hash_field_count; i++) {
+		if (a->fields[i] != b->fields[i]) {
+			SDL_Log("    %s", world_hash_field_names[i]);
+		}
+	}
+	return false;
+}
+
+static bool check_determinism(const SelfTestCase* c) {
+	World a{};
+	World b{};
+	init_world(&a, c);
+	init_world(&b, c);
+
+	int all_threads = jobs.active_threads;
+	bool ok = true;
+
+	for (int frame = 0; frame < c->frames && ok; frame++) {
+		jobs_set_active_threads(1);
+		a.Update(1.0f);
+
+		jobs_set_active_threads(all_threads);
+		b.Update(1.0f);
+
+		WorldHash ha;
+		WorldHash hb;
+		world_hash(&a, &ha);
+		world_hash(&b, &hb);
+		ok = same_hash(&ha, &hb, "determinism", c, frame);
+	}
+
+	jobs_set_active_threads(all_threads);
+
+	a.Quit();
+	b.Quit();
+	return ok;
+}
+
+static bool check_round_trip(const SelfTestCase* c) {
+	World w{};
+	init_world(&w, c);
+
+	int half = c->frames / 2;
+	for (int frame = 0; frame < half; frame++) {
+		w.Update(1.0f);
+	}
+
+	WorldState state = {};
+	if (!world_save_state(&w, &state)) {
+		SDL_Log("  %-12s %-16s couldn't save the world.", "round_trip", c->name);
+		world_state_free(&state);
+		w.Quit();
+		return false;
+	}
+
+	WorldHash saved;
+	world_hash(&w, &saved);
+
+	// What it did the first time.
+	int count = c->frames - half;
+	WorldHash* hashes = (WorldHash*) ecalloc(count, sizeof *hashes);
+	for (int i = 0; i < count; i++) {
+		w.Update(1.0f);
+		world_hash(&w, &hashes[i]);
+	}
+
+	bool ok = world_load_state(&w, &state);
+	if (ok) {
+		WorldHash loaded;
+		world_hash(&w, &loaded);
+		ok = same_hash(&saved, &loaded, "round_trip", c, half);
+	} else {
+		SDL_Log("  %-12s %-16s couldn't load the world.", "round_trip", c->name);
+	}
+
+	for (int i = 0; i < count && ok; i++) {
+		w.Update(1.0f);
+
+		WorldHash h;
+		world_hash(&w, &h);
+		ok = same_hash(&hashes[i], &h, "round_trip", c, half + i + 1);
+	}
+
+	SDL_free(hashes);
+	world_state_free(&state);
+	w.Quit();
+	return ok;
+}
+
+int run_selftest() {
+	jobs_init(0);
+
+	int case_count = 1 + stress_scenario_count;
+	SelfTestCase* cases = (SelfTestCase*) ecalloc(case_count, sizeof *cases);
+
+	cases[0] = {"stage", nullptr, SELFTEST_FRAMES};
+	for (int i = 0; i < stress_scenario_count; i++) {
+		cases[1 + i] = {stress_scenarios[i].name, stress_scenarios[i].script, SELFTEST_STRESS_FRAMES};
+	}
+
+	struct {
+		const char* name;
+		bool (*func)(const SelfTestCase*);
+	} checks[] = {
+		{"determinism", check_determinism},
+		{"round_trip",  check_round_trip},
+	};
+
+	int failed = 0;
+	int total = 0;
+
+	for (int i = 0; i < (int) ArrayLength(checks); i++) {
+		for (int j = 0; j < case_count; j++) {
+			bool ok = checks[i].func(&cases[j]);
+			SDL_Log("  %-12s %-16s %s", checks[i].name, cases[j].name, ok ? "ok" : "FAILED");
+			if (!ok) failed++;
+			total++;
+		}
+	}
+
+	if (failed > 0) {
+		SDL_Log("%d of %d checks failed.", failed, total);
+	} else {
+		SDL_Log("All %d checks passed.", total);
+	}
+
+	SDL_free(cases);
+	jobs_quit();
+
+	return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "common.h"
+
+//
+// Checks of the simulation that don't need a window, for running before a commit or on a build machine.
+//
+// Run with "--selftest". Doesn't open a window or load anything. Returns 1 if any check failed, and logs the first
+// update and the hash fields where it went wrong.
+//
+// Every check runs on headless worlds, on the normal stage and on every stress scenario:
+//
+// determinism - two worlds with the same seed hash the same after every update, one updating on 1 thread and
+//               the other on all of them.
+// round_trip  - a world saved with world_save_state() and loaded back hashes the same as when it was saved, and
+//               the same after every update as it did the first time.
+//
+
+#define SELFTEST_FRAMES 600     // Per world and check
+#define SELFTEST_STRESS_FRAMES 200
+#define SELFTEST_SEED 12345
+
+int run_selftest();
@@ -0,0 +1,84 @@
+#include "Snapshot.h"
+
+#include "ecalloc.h"
+#include <string.h>
+
+void snapshot_world(RenderSnapshot* s, World* w) {
+	s->world = *w;
+
+	memcpy(s->enemies,   w->enemies,   w->enemy_count    * sizeof(*w->enemies));
+	memcpy(s->bullets,   w->bullets,   w->bullet_count   * sizeof(*w->bullets));
+	memcpy(s->p_bullets, w->p_bullets, w->p_bullet_count * sizeof(*w->p_bullets));
+	memcpy(s->allies,    w->allies,    w->ally_count     * sizeof(*w->allies));
+	memcpy(s->chests,    w->chests,    w->chest_count    * sizeof(*w->chests));
+	memcpy(s->particles, w->particles.particles, w->particles.particle_count * sizeof(*w->particles.particles));
+	memcpy(s->dormant,   w->sectors.asteroids, w->sectors.slot_count * sizeof(*w->sectors.asteroids));
+	memcpy(s->sectors,   w->sectors.grid,      SECTOR_COUNT            * sizeof(*w->sectors.grid));
+
+	s->world.enemies   = s->enemies;
+	s->world.bullets   = s->bullets;
+	s->world.p_bullets = s->p_bullets;
+	s->world.allies    = s->allies;
+	s->world.chests    = s->chests;
+	s->world.particles.particles = s->particles;
+	s->world.sectors.asteroids   = s->dormant;
+	s->world.sectors.grid        = s->sectors;
+
+	s->world.hit_events         = nullptr;
+	s->world.asteroid_spawns    = nullptr;
+	s->world.enemy_destroyed    = nullptr;
+	s->world.bullet_destroyed   = nullptr;
+	s->world.p_bullet_destroyed = nullptr;
+	s->world.bullet_trail       = nullptr;
+	s->world.particles.destroyed = nullptr;
+
+	s->has_ai = (w->ai_points != nullptr);
+	if (s->has_ai) {
+		s->ai_points          = *w->ai_points;
+		s->ai_tick_wait_time  = *w->ai_tick_wait_time;
+		s->ai_tick_wait_timer = *w->ai_tick_wait_timer;
+	}
+
+	// The simulation thread keeps writing to these.
+	s->world.co = nullptr;
+	s->world.particles.rng = nullptr;
+	s->world.ai_points = nullptr;
+	s->world.ai_tick_wait_time = nullptr;
+	s->world.ai_tick_wait_timer = nullptr;
+	for (int i = 0; i < s->world.enemy_count; i++) {
+		s->enemies[i].co = nullptr;
+	}
+}
+
+void SnapshotBuffer::Init() {
+	for (int i = 0; i < 3; i++) {
+		slots[i] = (RenderSnapshot*) ecalloc(1, sizeof(RenderSnapshot));
+	}
+	write = 0;
+	read = 1;
+	SDL_AtomicSet(&middle, 2);
+}
+
+void SnapshotBuffer::Free() {
+	for (int i = 0; i < 3; i++) {
+		SDL_free(slots[i]);
+		slots[i] = nullptr;
+	}
+}
+
+void SnapshotBuffer::Publish() {
+	// SDL_AtomicSet() is only an acquire barrier on some compilers. The writes to the slot have to land before the swap.
+	SDL_MemoryBarrierRelease();
+	int prev = SDL_AtomicSet(&middle, write | SNAPSHOT_NEW);
+	write = prev & ~SNAPSHOT_NEW;
+}
+
+RenderSnapshot* SnapshotBuffer::Acquire() {
+	// Only the reader clears SNAPSHOT_NEW, so if it's set, whatever is in "middle" by the time we swap is new too.
+	if (SDL_AtomicGet(&middle) & SNAPSHOT_NEW) {
+		int prev = SDL_AtomicSet(&middle, read);
+		read = prev & ~SNAPSHOT_NEW;
+		SDL_MemoryBarrierAcquire();
+	}
+	return slots[read];
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "common.h"
+#include "World.h"
+#include <SDL.h>
+
+//
+// What the main thread needs to draw a frame, copied out of the world by the simulation thread after every update.
+//
+// "world" is a shallow copy of the live world with the object arrays pointing into the snapshot's own arrays,
+// and only the live part of each array is copied. The scratch arrays are nulled out, drawing doesn't need them,
+// and so are the pointers that still lead into the live world (coroutines, the particles' rng, the AI director's
+// numbers on the stage script's stack). The AI numbers are copied into the snapshot instead.
+// Whoever holds a snapshot owns it until they hand it back, so drawing can't see a half-updated world.
+//
+
+struct RenderSnapshot {
+	World world;
+
+	Enemy    enemies[MAX_ENEMIES];
+	Bullet   bullets[MAX_BULLETS];
+	Bullet   p_bullets[MAX_PLR_BULLETS];
+	Ally     allies[MAX_ALLIES];
+	Chest    chests[MAX_CHESTS];
+	Particle particles[MAX_PARTICLES];
+
+	DormantAsteroid dormant[MAX_DORMANT_ASTEROIDS]; // For the map
+	Sector          sectors[SECTOR_COUNT];
+
+	// The AI director's, if the stage has one. For the debug overlay.
+	bool has_ai;
+	int ai_points;
+	int ai_tick_wait_time;
+	int ai_tick_wait_timer;
+
+	u64 sim_frame;      // How many updates the simulation thread had done
+	double update_took; // Of the update that made this snapshot, in ms
+};
+
+void snapshot_world(RenderSnapshot* s, World* w);
+
+//
+// Lock-free triple buffer. The simulation thread always has a slot to write, the main thread always has one to read,
+// and the third one is swapped between them with a single atomic exchange. Neither side ever waits for the other.
+// If the main thread is slower, it skips to the newest snapshot. If it's faster, it draws the same one again.
+//
+
+#define SNAPSHOT_NEW 4 // Set in "middle" when it holds a snapshot the reader hasn't seen
+
+struct SnapshotBuffer {
+	RenderSnapshot* slots[3];
+	int write;           // Owned by the writer
+	int read;            // Owned by the reader
+	SDL_atomic_t middle; // Index of the third slot, plus SNAPSHOT_NEW
+
+	void Init();
+	void Free();
+
+	RenderSnapshot* GetWriteSlot() { return slots[write]; }
+
+	// Hands the write slot over to the reader.
+	void Publish();
+
+	// Returns the newest published snapshot, or the last one if nothing new came in.
+	RenderSnapshot* Acquire();
+};
@@ -1,6 +1,7 @@
 #include "Sprite.h"
 
 #include "Game.h"
+#include "DrawCapture.h"
 
 float sprite_get_next_frame_index(Sprite* sprite, float frame_index, float delta) {
 	if (!sprite) return frame_index;
@@ -58,5 +59,6 @@ void DrawSprite(Sprite* sprite, int frame_index,
 
 	SDL_SetTextureColorMod(sprite->texture, color.r, color.g, color.b);
 	SDL_SetTextureAlphaMod(sprite->texture, color.a);
-	SDL_RenderCopyExF(renderer, sprite->texture, &src, &dest, AngleToSDL(angle), &center, (SDL_RendererFlip) flip);
+	render_copy_ex(renderer, sprite->texture, &src, &dest, AngleToSDL(angle), &center, (SDL_RendererFlip) flip, DRAW_SRC_SPRITE);
+	counter_add(COUNTER_DRAW_SPRITE);
 }
@@ -0,0 +1,204 @@
+#include "Stress.h"
+
+#include "ecalloc.h"
+#include "mathh.h"
+#include "stb_sprintf.h"
+#include <string.h>
+
+extern void stress_asteroid_field(mco_coro*);
+extern void stress_bullet_curtain(mco_coro*);
+extern void stress_missile_swarm(mco_coro*);
+extern void stress_boss_fight(mco_coro*);
+extern void stress_particle_storm(mco_coro*);
+
+const StressScenario stress_scenarios[] = {
+	{"asteroid_field", "MAX_ENEMIES asteroids, half of them around the player", stress_asteroid_field},
+	{"bullet_curtain", "MAX_BULLETS enemy bullets closing in on the player",   stress_bullet_curtain},
+	{"missile_swarm",  "300 missile enemies and MAX_PLR_BULLETS homing missiles", stress_missile_swarm},
+	{"boss_fight",     "4 bosses and 50 escorts, the player shooting back",    stress_boss_fight},
+	{"particle_storm", "MAX_PARTICLES particles on screen",                    stress_particle_storm},
+};
+
+const int stress_scenario_count = ArrayLength(stress_scenarios);
+
+static const char* pool_names[STRESS_POOL_COUNT] = {
+	"enemies",
+	"bullets",
+	"p_bullets",
+	"allies",
+	"chests",
+	"particles",
+};
+
+static const int pool_limits[STRESS_POOL_COUNT] = {
+	MAX_ENEMIES,
+	MAX_BULLETS,
+	MAX_PLR_BULLETS,
+	MAX_ALLIES,
+	MAX_CHESTS,
+	MAX_PARTICLES,
+};
+
+const StressScenario* find_stress_scenario(const char* name) {
+	for (int i = 0; i < stress_scenario_count; i++) {
+		if (strcmp(stress_scenarios[i].name, name) == 0) {
+			return &stress_scenarios[i];
+		}
+	}
+	return nullptr;
+}
+
+void StressRun::Start(World* w) {
+	frames = max(frames, 1);
+
+	update_ms  = (double*) ecalloc(frames, sizeof(*update_ms));
+	draw_ms    = (double*) ecalloc(frames, sizeof(*draw_ms));
+	present_ms = (double*) ecalloc(frames, sizeof(*present_ms));
+	frame_ms   = (double*) ecalloc(frames, sizeof(*frame_ms));
+	draw_calls = (int*)    ecalloc(frames, sizeof(*draw_calls));
+
+	w->StartStage(scenario->script);
+
+	SDL_Log("Stress scenario \"%s\": %s. %d frames after %d of warmup.",
+			scenario->name, scenario->description, frames, STRESS_WARMUP_FRAMES);
+}
+
+bool StressRun::Frame(World* w, const FrameTimeSample& s, int _draw_calls) {
+	frame++;
+	if (frame <= STRESS_WARMUP_FRAMES) {
+		return false;
+	}
+
+	int i = measured++;
+	update_ms[i]  = s.update;
+	draw_ms[i]    = s.draw;
+	present_ms[i] = s.present;
+	frame_ms[i]   = s.update + s.draw + s.present;
+	draw_calls[i] = _draw_calls;
+
+	int counts[STRESS_POOL_COUNT] = {
+		w->enemy_count,
+		w->bullet_count,
+		w->p_bullet_count,
+		w->ally_count,
+		w->chest_count,
+		w->particles.particle_count,
+	};
+	for (int p = 0; p < STRESS_POOL_COUNT; p++) {
+		pools[p].sum += counts[p];
+		pools[p].max = max(pools[p].max, counts[p]);
+	}
+
+	return measured >= frames;
+}
+
+static int compare_double(const void* a, const void* b) {
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+// Sorts "values".
+static FrameTimePercentiles percentiles(double* values, int count) {
+	FrameTimePercentiles result = {};
+	if (count == 0) return result;
+
+	SDL_qsort(values, count, sizeof(*values), compare_double);
+
+	auto at = [&](double p) { return values[min(count - 1, (int) (p * double(count)))]; };
+	result.p50 = at(0.50);
+	result.p95 = at(0.95);
+	result.p99 = at(0.99);
+	result.max = values[count - 1];
+	return result;
+}
+
+bool StressRun::WriteReport() {
+	FrameTimePercentiles update  = percentiles(update_ms,  measured);
+	FrameTimePercentiles draw    = percentiles(draw_ms,    measured);
+	FrameTimePercentiles present = percentiles(present_ms, measured);
+	FrameTimePercentiles frame_p = percentiles(frame_ms,   measured);
+
+	double draw_call_sum = 0.0;
+	int draw_call_max = 0;
+	for (int i = 0; i < measured; i++) {
+		draw_call_sum += double(draw_calls[i]);
+		draw_call_max = max(draw_call_max, draw_calls[i]);
+	}
+	double draw_call_avg = (measured > 0) ? draw_call_sum / double(measured) : 0.0;
+
+	SDL_Log("Stress scenario \"%s\", %d frames:", scenario->name, measured);
+	SDL_Log("  update  p50 %7.3fms  p95 %7.3fms  p99 %7.3fms  max %7.3fms", update.p50,  update.p95,  update.p99,  update.max);
+	SDL_Log("  draw    p50 %7.3fms  p95 %7.3fms  p99 %7.3fms  max %7.3fms", draw.p50,    draw.p95,    draw.p99,    draw.max);
+	SDL_Log("  present p50 %7.3fms  p95 %7.3fms  p99 %7.3fms  max %7.3fms", present.p50, present.p95, present.p99, present.max);
+	SDL_Log("  draw calls avg %.1f, max %d", draw_call_avg, draw_call_max);
+	for (int p = 0; p < STRESS_POOL_COUNT; p++) {
+		double avg = (measured > 0) ? double(pools[p].sum) / double(measured) : 0.0;
+		SDL_Log("  %-9s avg %7.1f  max %5d / %d", pool_names[p], avg, pools[p].max, pool_limits[p]);
+	}
+
+	if (!report_fname) {
+		return true;
+	}
+
+	SDL_RWops* f = SDL_RWFromFile(report_fname, "wb");
+	if (!f) {
+		SDL_Log("Couldn't open %s: %s", report_fname, SDL_GetError());
+		return false;
+	}
+
+	char buf[256];
+
+	auto write = [&](const char* s) {
+		SDL_RWwrite(f, s, 1, strlen(s));
+	};
+
+	auto write_percentiles = [&](const char* name, const FrameTimePercentiles& p, const char* comma) {
+		stb_snprintf(buf, sizeof(buf), "\t\t\"%s\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+					 name, p.p50, p.p95, p.p99, p.max, comma);
+		write(buf);
+	};
+
+	write("{\n");
+	stb_snprintf(buf, sizeof(buf), "\t\"scenario\": \"%s\",\n\t\"frames\": %d,\n\t\"warmup_frames\": %d,\n",
+				 scenario->name, measured, STRESS_WARMUP_FRAMES);
+	write(buf);
+
+	write("\t\"ms\": {\n");
+	write_percentiles("update",  update,  ",");
+	write_percentiles("draw",    draw,    ",");
+	write_percentiles("present", present, ",");
+	write_percentiles("frame",   frame_p, "");
+	write("\t},\n");
+
+	stb_snprintf(buf, sizeof(buf), "\t\"draw_calls\": {\"avg\": %.1f, \"max\": %d},\n", draw_call_avg, draw_call_max);
+	write(buf);
+
+	write("\t\"pools\": {\n");
+	for (int p = 0; p < STRESS_POOL_COUNT; p++) {
+		double avg = (measured > 0) ? double(pools[p].sum) / double(measured) : 0.0;
+		stb_snprintf(buf, sizeof(buf), "\t\t\"%s\": {\"avg\": %.1f, \"max\": %d, \"limit\": %d}%s\n",
+					 pool_names[p], avg, pools[p].max, pool_limits[p], (p < STRESS_POOL_COUNT - 1) ? "," : "");
+		write(buf);
+	}
+	write("\t}\n");
+	write("}\n");
+
+	SDL_RWclose(f);
+
+	SDL_Log("Wrote stress report to %s", report_fname);
+	return true;
+}
+
+void StressRun::Free() {
+	SDL_free(update_ms);
+	SDL_free(draw_ms);
+	SDL_free(present_ms);
+	SDL_free(frame_ms);
+	SDL_free(draw_calls);
+	update_ms  = nullptr;
+	draw_ms    = nullptr;
+	present_ms = nullptr;
+	frame_ms   = nullptr;
+	draw_calls = nullptr;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "common.h"
+#include "World.h"
+#include "FrameTimes.h"
+
+//
+// Stress scenarios: stage scripts that keep the object pools full, for finding where things stop scaling.
+//
+// Run with "--stress <name> [--frames N] [--report file.json]". The game runs unpaced, with a fixed delta,
+// for STRESS_WARMUP_FRAMES plus N frames, writes the report and quits.
+// Same build, same scenario, same world, so reports can be compared across commits.
+//
+
+#define STRESS_WARMUP_FRAMES 60 // Not measured. Lets the pools fill up.
+#define STRESS_DEFAULT_FRAMES 600
+
+struct StressScenario {
+	const char* name;
+	const char* description;
+	void (*script)(mco_coro*);
+};
+
+extern const StressScenario stress_scenarios[];
+extern const int stress_scenario_count;
+
+// Null if there's no scenario with that name.
+const StressScenario* find_stress_scenario(const char* name);
+
+enum {
+	STRESS_POOL_ENEMIES,
+	STRESS_POOL_BULLETS,
+	STRESS_POOL_P_BULLETS,
+	STRESS_POOL_ALLIES,
+	STRESS_POOL_CHESTS,
+	STRESS_POOL_PARTICLES,
+
+	STRESS_POOL_COUNT
+};
+
+struct StressPool {
+	int sum;
+	int max;
+};
+
+struct StressRun {
+	const StressScenario* scenario; // Null when not stress testing
+	int frames = STRESS_DEFAULT_FRAMES;
+	const char* report_fname;
+
+	int frame; // Including warmup
+
+	// One per measured frame.
+	double* update_ms;
+	double* draw_ms;
+	double* present_ms;
+	double* frame_ms;
+	int* draw_calls;
+	int measured;
+
+	StressPool pools[STRESS_POOL_COUNT];
+
+	// Replaces the world's stage script with the scenario's.
+	void Start(World* w);
+
+	// Call after every frame. Returns true when the run is over.
+	bool Frame(World* w, const FrameTimeSample& s, int _draw_calls);
+
+	// Writes a JSON report, and a summary to the log.
+	bool WriteReport();
+
+	void Free();
+};
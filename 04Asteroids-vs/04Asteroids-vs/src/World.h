@@ -1,159 +1,316 @@
-#pragma once
-
-#include "common.h"
-#include "Objects.h"
-#include "Particles.h"
-#include "xoshiro256plusplus.h"
-
-#define GAME_W 1066 // 1422
-#define GAME_H 800
-#define GAME_FPS 60
-
-#define MAX_ENEMIES 1000
-#define MAX_BULLETS 1000
-#define MAX_PLR_BULLETS 1000
-#define MAX_ALLIES 100
-#define MAX_CHESTS 100
-
-#define MAP_W 10'000.0f
-#define MAP_H 10'000.0f
-
-#define DIST_OFFSCREEN 800.0f
-
-enum {
-	INPUT_RIGHT = 1,
-	INPUT_UP    = 1 << 1,
-	INPUT_LEFT  = 1 << 2,
-	INPUT_DOWN  = 1 << 3,
-
-	INPUT_FIRE     = 1 << 4,
-	INPUT_USE_ITEM = 1 << 5,
-	INPUT_FOCUS    = 1 << 6,
-	INPUT_BOOST    = 1 << 7
-};
-
-struct World;
-extern World* world;
-
-extern const char* ItemNames[ITEM_COUNT];
-extern const char* ItemDescriptions[ITEM_COUNT];
-extern const char* ActiveItemNames[ACTIVE_ITEM_COUNT];
-extern const char* ActiveItemDescriptions[ACTIVE_ITEM_COUNT];
-
-struct World {
-	Player player;
-
-	Enemy* enemies;
-	int enemy_count;
-	Bullet* bullets;
-	int bullet_count;
-	Bullet* p_bullets; // player bullets
-	int p_bullet_count;
-	Ally* allies;
-	int ally_count;
-	Chest* chests;
-	int chest_count;
-
-	instance_id next_id;
-
-	Particles particles;
-
-	float camera_x;
-	float camera_y;
-	float camera_base_x;
-	float camera_base_y;
-	float camera_scale = 1.0f;
-	float camera_scale_target = 1.0f;
-	float camera_w = (float) GAME_W;
-	float camera_h = (float) GAME_H;
-	float camera_left;
-	float camera_top;
-
-	u32 input;
-	u32 input_press;
-	u32 input_release;
-
-	mco_coro* co;
-	float coro_timer;
-	xoshiro256plusplus rng;
-	xoshiro256plusplus rng_visual;
-	bool paused;
-	int frame;
-
-	float screenshake_intensity;
-	float screenshake_time;
-	float screenshake_timer;
-
-	float interface_update_timer;
-	float interface_x;
-	float interface_y;
-	SDL_Texture* interface_map_texture;
-
-	bool hide_interface;
-	bool show_hitboxes;
-
-	struct {
-		int cursor;
-	} pause_menu;
-
-	int* ai_points;
-	int* ai_tick_wait_time;
-	int* ai_tick_wait_timer;
-
-	void Init();
-	void Quit();
-
-	void Update(float delta);
-	void UpdatePlayer(Player* p, float delta);
-	void PhysicsUpdate(float delta);
-	void player_get_hit(Player* p, float dmg);
-	bool enemy_get_hit(Enemy* e, float dmg, float split_dir, bool _play_sound = true);
-
-	void ScreenShake(float x, float y, float intensity, float time, bool always = false);
-
-	void Draw(float delta);
-	void DrawUI(float delta);
-	void draw_ui(float delta);
-	void update_interface(float delta);
-
-	Enemy*  CreateEnemy();
-	Bullet* CreateBullet();
-	Bullet* CreatePlrBullet();
-	Ally*   CreateAlly();
-	Chest*  CreateChest();
-
-	void DestroyEnemyByIndex    (int enemy_idx);
-	void DestroyBulletByIndex   (int bullet_idx);
-	void DestroyPlrBulletByIndex(int p_bullet_idx);
-	void DestroyAllyByIndex     (int ally_idx);
-	void DestroyChestByIndex    (int chest_idx);
-
-	int get_enemy_count() {
-		int result = 0;
-		for (int i = 0; i < enemy_count; i++) {
-			if (enemies[i].type >= TYPE_ENEMY) {
-				result++;
-			}
-		}
-		return result;
-	}
-};
-
-void DrawCircleCamWarped(float x, float y, float radius, SDL_Color color = {255, 255, 255, 255});
-
-void DrawSpriteCamWarped(Sprite* sprite, int frame_index,
-						 float x, float y,
-						 float angle = 0.0f, float xscale = 1.0f, float yscale = 1.0f,
-						 SDL_Color color = {255, 255, 255, 255});
-
-SDL_Point DrawTextCamWarped(SDL_Renderer* renderer, Font* font, const char* text,
-							int x, int y,
-							int halign = 0, int valign = 0,
-							SDL_Color color = {255, 255, 255, 255},
-							float xscale = 1.0f, float yscale = 1.0f);
-
-SDL_Point DrawTextShadowCamWarped(SDL_Renderer* renderer, Font* font, const char* text,
-								  int x, int y,
-								  int halign = 0, int valign = 0,
-								  SDL_Color color = {255, 255, 255, 255},
-								  float xscale = 1.0f, float yscale = 1.0f);
+#pragma once
+
+#include "common.h"
+#include "Objects.h"
+#include "CoroArena.h"
+#include "Particles.h"
+#include "Sectors.h"
+#include "FlowField.h"
+#include "Counters.h"
+#include "xoshiro256plusplus.h"
+#include <math.h>
+
+#define GAME_W 1066 // 1422
+#define GAME_H 800
+#define GAME_FPS 60
+
+#define MAX_ENEMIES 1000
+#define MAX_BULLETS 1000
+#define MAX_PLR_BULLETS 1000
+#define MAX_ALLIES 100
+#define MAX_CHESTS 100
+
+// Every player bullet makes at most one hit, plus the player getting hit by a bullet or an enemy.
+#define MAX_HIT_EVENTS (MAX_PLR_BULLETS + 4)
+#define MAX_ASTEROID_SPAWNS (2 * MAX_HIT_EVENTS)
+
+#define MAP_W 10'000.0f
+#define MAP_H 10'000.0f
+
+#define DIST_OFFSCREEN 800.0f
+
+// Simulation level of detail, by distance to the camera. Farther than LOD_MID_DIST, enemy steering, homing and
+// animation run every LOD_MID_PERIOD updates with the time they missed, and LOD_FAR_PERIOD farther than LOD_FAR_DIST.
+// Missile trails are only made near the camera. Movement, lifetimes, scripts and collisions are exact at any distance.
+#define LOD_MID_DIST DIST_OFFSCREEN
+#define LOD_FAR_DIST (2.0f * DIST_OFFSCREEN)
+#define LOD_MID_PERIOD 2
+#define LOD_FAR_PERIOD 4
+
+enum {
+	PARTICLE_ASTEROID_EXPLOSION,
+	PARTICLE_MISSILE_TRAIL,
+	PARTICLE_TEXT_POPUP
+};
+
+enum {
+	INPUT_RIGHT = 1,
+	INPUT_UP    = 1 << 1,
+	INPUT_LEFT  = 1 << 2,
+	INPUT_DOWN  = 1 << 3,
+
+	INPUT_FIRE     = 1 << 4,
+	INPUT_USE_ITEM = 1 << 5,
+	INPUT_FOCUS    = 1 << 6,
+	INPUT_BOOST    = 1 << 7
+};
+
+struct World;
+
+// What the stage and enemy scripts get through mco_coro::user_data. Set before every resume.
+struct ScriptContext {
+	World* world;
+	Enemy* self; // Null for the stage script
+	int* wait;   // Where wait() leaves the number of resumes to skip
+};
+
+// A collision found by World::DetectCollisions, applied by World::ResolveHits.
+struct HitEvent {
+	ObjType target; // PLAYER or ENEMY
+	int index;      // Into enemies, at the time of detection
+	float dmg;
+	float split_dir;
+	bool play_sound;
+	bool by_player; // The player gets the enemy's experience and money if it dies
+};
+
+// An asteroid that split, spawned after the dead objects are removed.
+struct AsteroidSpawn {
+	float x;
+	float y;
+	float hsp;
+	float vsp;
+	int type;
+	float experience;
+};
+
+extern const char* ItemNames[ITEM_COUNT];
+extern const char* ItemDescriptions[ITEM_COUNT];
+extern const char* ActiveItemNames[ACTIVE_ITEM_COUNT];
+extern const char* ActiveItemDescriptions[ACTIVE_ITEM_COUNT];
+
+struct World {
+	Player player;
+
+	Enemy* enemies;
+	int enemy_count;
+	Bullet* bullets;
+	int bullet_count;
+	Bullet* p_bullets; // player bullets
+	int p_bullet_count;
+	Ally* allies;
+	int ally_count;
+	Chest* chests;
+	int chest_count;
+
+	instance_id next_id;
+
+	HitEvent* hit_events;
+	int hit_event_count;
+	AsteroidSpawn* asteroid_spawns;
+	int asteroid_spawn_count;
+	bool* enemy_destroyed;    // Marks for ResolveHits, indexed like the arrays above
+	bool* bullet_destroyed;
+	bool* p_bullet_destroyed;
+	bool* bullet_trail;       // Scratch for the bullet update
+
+	Particles particles;
+	Sectors sectors; // The asteroids far from the player
+	FlowField flow;  // Ship steering
+
+	float camera_x;
+	float camera_y;
+	float camera_base_x;
+	float camera_base_y;
+	float camera_scale = 1.0f;
+	float camera_scale_target = 1.0f;
+	float camera_w = (float) GAME_W;
+	float camera_h = (float) GAME_H;
+	float camera_left;
+	float camera_top;
+
+	u32 input;
+	u32 input_press;
+	u32 input_release;
+
+	mco_coro* co;
+	int co_wait;
+	float coro_timer;
+	CoroArena coros; // Every coroutine of this world, stage and enemies
+	ScriptContext script_ctx;
+	xoshiro256plusplus rng;
+	xoshiro256plusplus rng_visual;
+	bool paused;
+	bool sim_lod = true; // SIM_LOD=0 or the pause menu turns it off, to compare
+	int frame; // Updates that weren't paused or in hitstop
+	double hitstop_time; // Seconds. Set by sleep().
+
+	// No keyboard, sound or textures, and nothing read from "game" during Update.
+	// Any number of headless worlds can update at the same time on different threads.
+	bool headless;
+
+	float screenshake_intensity;
+	float screenshake_time;
+	float screenshake_timer;
+
+	float interface_update_timer;
+	float interface_x;
+	float interface_y;
+	int interface_map_version; // Bumped when the map should be redrawn
+	SDL_Texture* interface_map_texture;
+
+	bool hide_interface;
+	bool show_hitboxes;
+
+	struct {
+		int cursor;
+		bool audio_3d; // Game::options.audio_3d, which the main thread doesn't read while the world updates
+	} pause_menu;
+
+	int* ai_points;
+	int* ai_tick_wait_time;
+	int* ai_tick_wait_timer;
+
+	// seed 0 keeps the default rng state.
+	void Init(u64 seed = 0, bool _headless = false);
+	void Quit();
+
+	// Replaces the stage script. The enemies the old one spawned stay.
+	void StartStage(void (*script)(mco_coro*));
+
+	void Update(float delta);
+	void UpdatePlayer(Player* p, float delta);
+	void PhysicsUpdate(float delta);
+	void DetectCollisions();
+	void ResolveHits();
+	void player_get_hit(Player* p, float dmg);
+	bool enemy_get_hit(Enemy* e, float dmg, float split_dir, bool _play_sound = true);
+
+	// Freezes the world for "ms" milliseconds if (x, y) is on screen. Doesn't block the frame loop.
+	void sleep(float x, float y, u32 ms);
+
+	void ScreenShake(float x, float y, float intensity, float time, bool always = false);
+
+	void Draw(float delta);
+	void DrawUI(float delta);
+	void draw_ui(float delta);
+	void update_interface(float delta);
+	void DrawInterfaceMap();
+
+	Enemy*  CreateEnemy();
+	Bullet* CreateBullet();
+	Bullet* CreatePlrBullet();
+	Ally*   CreateAlly();
+	Chest*  CreateChest();
+
+	void DestroyEnemyByIndex    (int enemy_idx);
+	void DestroyBulletByIndex   (int bullet_idx);
+	void DestroyPlrBulletByIndex(int p_bullet_idx);
+	void DestroyAllyByIndex     (int ally_idx);
+	void DestroyChestByIndex    (int chest_idx);
+
+	// Removes every object whose mark is set, keeping the order of the rest.
+	void DestroyMarkedEnemies   (const bool* marked);
+	void DestroyMarkedBullets   (const bool* marked);
+	void DestroyMarkedPlrBullets(const bool* marked);
+
+	int get_enemy_count() {
+		int result = 0;
+		for (int i = 0; i < enemy_count; i++) {
+			if (enemies[i].type >= TYPE_ENEMY) {
+				result++;
+			}
+		}
+		return result;
+	}
+};
+
+// type is 1 to 3, from small to big.
+Enemy* make_asteroid(World* w, float x, float y, float hsp, float vsp, int type,
+					 float experience = 0.5f,
+					 float money = 0.5f);
+
+// Shortest vector from (x1, y1) to (x2, y2), counting the wrapped copies.
+inline void wrapped_delta(float x1, float y1, float x2, float y2, float* out_x, float* out_y) {
+	float dx = x2 - x1;
+	float dy = y2 - y1;
+	*out_x = dx - MAP_W * roundf(dx / MAP_W);
+	*out_y = dy - MAP_H * roundf(dy / MAP_H);
+}
+
+// Closest object that passes the filter, counting the wrapped copies around the map.
+// rel_x, rel_y is the position of the closest copy.
+template <typename Obj, typename F>
+Obj* find_closest(Obj* objects, int object_count,
+				  float x, float y,
+				  float* rel_x, float* rel_y, float* out_dist,
+				  const F& filter) {
+	Obj* result = nullptr;
+	float dist_sq = INFINITY;
+
+	counter_add(COUNTER_FIND_CLOSEST_CALLS);
+	counter_add(COUNTER_FIND_CLOSEST_SCANNED, u32(object_count));
+
+	for (int i = 0; i < object_count; i++) {
+		if (!filter(&objects[i])) continue;
+
+		if (objects[i].flags & FLAG_INSTANCE_DEAD) continue;
+
+		auto check = [i, objects, x, y, &result, &dist_sq, rel_x, rel_y, out_dist](float xoff, float yoff) {
+			float dx = x - (objects[i].x + xoff);
+			float dy = y - (objects[i].y + yoff);
+
+			float d = dx * dx + dy * dy;
+			if (d < dist_sq) {
+				result = &objects[i];
+				*rel_x = objects[i].x + xoff;
+				*rel_y = objects[i].y + yoff;
+				dist_sq = d;
+				*out_dist = sqrtf(dist_sq);
+			}
+		};
+
+		check(-MAP_W, -MAP_H);
+		check( 0.0f,  -MAP_H);
+		check( MAP_W, -MAP_H);
+
+		check(-MAP_W,  0.0f);
+		check( 0.0f,   0.0f);
+		check( MAP_W,  0.0f);
+
+		check(-MAP_W,  MAP_H);
+		check( 0.0f,   MAP_H);
+		check( MAP_W,  MAP_H);
+	}
+
+	return result;
+}
+
+template <typename Obj>
+Obj* find_closest(Obj* objects, int object_count,
+				  float x, float y,
+				  float* rel_x, float* rel_y, float* out_dist) {
+	return find_closest(objects, object_count,
+						x, y,
+						rel_x, rel_y, out_dist,
+						[](Obj*) { return true; });
+}
+
+void DrawCircleCamWarped(World* w, float x, float y, float radius, SDL_Color color = {255, 255, 255, 255});
+
+void DrawSpriteCamWarped(World* w, Sprite* sprite, int frame_index,
+						 float x, float y,
+						 float angle = 0.0f, float xscale = 1.0f, float yscale = 1.0f,
+						 SDL_Color color = {255, 255, 255, 255});
+
+SDL_Point DrawTextCamWarped(World* w, SDL_Renderer* renderer, Font* font, const char* text,
+							int x, int y,
+							int halign = 0, int valign = 0,
+							SDL_Color color = {255, 255, 255, 255},
+							float xscale = 1.0f, float yscale = 1.0f);
+
+SDL_Point DrawTextShadowCamWarped(World* w, SDL_Renderer* renderer, Font* font, const char* text,
+								  int x, int y,
+								  int halign = 0, int valign = 0,
+								  SDL_Color color = {255, 255, 255, 255},
+								  float xscale = 1.0f, float yscale = 1.0f);
@@ -0,0 +1,335 @@
+#include "WorldHash.h"
+
+#include "Profiler.h"
+#include "ecalloc.h"
+#include "mathh.h"
+#include "stb_sprintf.h"
+#include <string.h>
+
+#define OBJECT_FIELDS(X) X(id) X(flags) X(x) X(y) X(hsp) X(vsp) X(frame_index)
+
+#define PLAYER_FIELDS(X) OBJECT_FIELDS(X)							\
+	X(radius) X(dir) X(focus) X(experience) X(level) X(money)		\
+	X(health) X(max_health) X(boost) X(max_boost)					\
+	X(invincibility) X(fire_timer) X(fire_queue) X(shot)			\
+	X(items) X(active_item) X(active_item_cooldown)
+
+// Not the script's coroutine. Its stack is hashed indirectly, through everything the script does.
+#define ENEMY_FIELDS(X) OBJECT_FIELDS(X)							\
+	X(radius) X(type) X(health) X(max_health) X(experience) X(money) X(angle)	\
+	X(catch_up_timer) X(acc) X(max_spd) X(stop_when_close_to_player) X(not_exact_player_dir)	\
+	X(co_wait) X(lod_delta)
+
+#define BULLET_FIELDS(X) OBJECT_FIELDS(X)							\
+	X(type) X(radius) X(dmg) X(lifespan) X(lifetime)				\
+	X(dir) X(t) X(max_spd) X(max_acc) X(lod_delta)
+
+#define ALLY_FIELDS(X) OBJECT_FIELDS(X) X(type)
+
+#define CHEST_FIELDS(X) OBJECT_FIELDS(X) X(type) X(radius) X(cost) X(opened) X(item)
+
+// Every slot, the free ones are zeroed.
+#define DORMANT_FIELDS(X) X(x) X(y) X(hsp) X(vsp) X(experience) X(money) X(type) X(next)
+
+#define FIELD_NAME(prefix, f) prefix #f,
+#define PLAYER_NAME(f)   FIELD_NAME("player.", f)
+#define ENEMY_NAME(f)    FIELD_NAME("enemies.", f)
+#define BULLET_NAME(f)   FIELD_NAME("bullets.", f)
+#define P_BULLET_NAME(f) FIELD_NAME("p_bullets.", f)
+#define ALLY_NAME(f)     FIELD_NAME("allies.", f)
+#define CHEST_NAME(f)    FIELD_NAME("chests.", f)
+#define DORMANT_NAME(f)  FIELD_NAME("dormant.", f)
+
+const char* world_hash_field_names[] = {
+	PLAYER_FIELDS(PLAYER_NAME)
+	"enemies.count",   ENEMY_FIELDS(ENEMY_NAME)
+	"bullets.count",   BULLET_FIELDS(BULLET_NAME)
+	"p_bullets.count", BULLET_FIELDS(P_BULLET_NAME)
+	"allies.count",    ALLY_FIELDS(ALLY_NAME)
+	"chests.count",    CHEST_FIELDS(CHEST_NAME)
+	"dormant.count",   DORMANT_FIELDS(DORMANT_NAME)
+	"sectors",
+	"rng",
+	"next_id",
+};
+
+const int world_hash_field_count = ArrayLength(world_hash_field_names);
+
+static_assert(ArrayLength(world_hash_field_names) <= WORLD_HASH_MAX_FIELDS, "");
+
+#define HASH_SEED  0xcbf29ce484222325ull
+#define HASH_PRIME 0x100000001b3ull
+
+// FNV-1a over 8 bytes at a time. Fields are small, so this is about one multiply per field per object.
+static u64 hash_bytes(u64 h, const void* data, usize size) {
+	const u8* p = (const u8*) data;
+	while (size >= 8) {
+		u64 v;
+		memcpy(&v, p, 8);
+		h = (h ^ v) * HASH_PRIME;
+		p += 8;
+		size -= 8;
+	}
+	if (size > 0) {
+		u64 v = 0;
+		memcpy(&v, p, size);
+		h = (h ^ v) * HASH_PRIME;
+	}
+	return h;
+}
+
+#define HASH_FIELD(f) acc[k] = hash_bytes(acc[k], &o->f, sizeof(o->f)); k++;
+#define COUNT_FIELD(f) + 1
+
+// Returns how many fields it used: the count, and one per field of T.
+template <typename T, typename F>
+static int hash_array(u64* acc, const T* objects, int count, int fields, const F& hash_object) {
+	acc[0] = hash_bytes(acc[0], &count, sizeof(count));
+	for (int i = 0; i < count; i++) {
+		hash_object(acc + 1, &objects[i]);
+	}
+	return 1 + fields;
+}
+
+void world_hash(const World* w, WorldHash* out) {
+	PROFILE_SCOPE("world_hash");
+
+	u64 acc[WORLD_HASH_MAX_FIELDS];
+	for (int i = 0; i < world_hash_field_count; i++) {
+		acc[i] = HASH_SEED;
+	}
+
+	int base = 0;
+
+	{
+		const Player* o = &w->player;
+		int k = 0;
+		PLAYER_FIELDS(HASH_FIELD)
+		base += k;
+	}
+
+	base += hash_array(acc + base, w->enemies, w->enemy_count, 0 ENEMY_FIELDS(COUNT_FIELD), [](u64* acc, const Enemy* o) {
+		int k = 0;
+		ENEMY_FIELDS(HASH_FIELD)
+	});
+
+	auto hash_bullet = [](u64* acc, const Bullet* o) {
+		int k = 0;
+		BULLET_FIELDS(HASH_FIELD)
+	};
+	base += hash_array(acc + base, w->bullets,   w->bullet_count,   0 BULLET_FIELDS(COUNT_FIELD), hash_bullet);
+	base += hash_array(acc + base, w->p_bullets, w->p_bullet_count, 0 BULLET_FIELDS(COUNT_FIELD), hash_bullet);
+
+	base += hash_array(acc + base, w->allies, w->ally_count, 0 ALLY_FIELDS(COUNT_FIELD), [](u64* acc, const Ally* o) {
+		int k = 0;
+		ALLY_FIELDS(HASH_FIELD)
+	});
+
+	base += hash_array(acc + base, w->chests, w->chest_count, 0 CHEST_FIELDS(COUNT_FIELD), [](u64* acc, const Chest* o) {
+		int k = 0;
+		CHEST_FIELDS(HASH_FIELD)
+	});
+
+	base += hash_array(acc + base, w->sectors.asteroids, w->sectors.slot_count, 0 DORMANT_FIELDS(COUNT_FIELD), [](u64* acc, const DormantAsteroid* o) {
+		int k = 0;
+		DORMANT_FIELDS(HASH_FIELD)
+	});
+
+	acc[base] = hash_bytes(acc[base], w->sectors.grid, SECTOR_COUNT * sizeof(*w->sectors.grid));
+	acc[base] = hash_bytes(acc[base], &w->sectors.time, sizeof(w->sectors.time));
+	base++;
+
+	acc[base] = hash_bytes(acc[base], &w->rng, sizeof(w->rng));
+	base++;
+
+	acc[base] = hash_bytes(acc[base], &w->next_id, sizeof(w->next_id));
+	base++;
+
+	SDL_assert(base == world_hash_field_count);
+
+	out->total = HASH_SEED;
+	for (int i = 0; i < world_hash_field_count; i++) {
+		out->total = hash_bytes(out->total, &acc[i], sizeof(acc[i]));
+		out->fields[i] = u32(acc[i] ^ (acc[i] >> 32));
+	}
+}
+
+bool HashLog::StartRecording(const char* fname) {
+	if (out) SDL_RWclose(out);
+
+	out = SDL_RWFromFile(fname, "wb");
+	if (!out) {
+		SDL_Log("Couldn't open %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	SDL_RWwrite(out, "frame,total", 1, strlen("frame,total"));
+	for (int i = 0; i < world_hash_field_count; i++) {
+		SDL_RWwrite(out, ",", 1, 1);
+		SDL_RWwrite(out, world_hash_field_names[i], 1, strlen(world_hash_field_names[i]));
+	}
+	SDL_RWwrite(out, "\n", 1, 1);
+
+	SDL_Log("Recording world hashes to %s", fname);
+	return true;
+}
+
+static const char* skip_line(const char* p) {
+	while (*p && *p != '\n') p++;
+	if (*p == '\n') p++;
+	return p;
+}
+
+bool HashLog::LoadReference(const char* fname) {
+	SDL_free(ref_text);
+	SDL_free(ref);
+	ref_text = nullptr;
+	ref = nullptr;
+	ref_count = 0;
+
+	usize size;
+	ref_text = (char*) SDL_LoadFile(fname, &size);
+	if (!ref_text) {
+		SDL_Log("Couldn't load %s: %s", fname, SDL_GetError());
+		return false;
+	}
+
+	// Header, to check that the fields are the same.
+	const char* p = ref_text;
+	const char* header_end = skip_line(p);
+	{
+		int fields = -2; // frame, total
+		for (const char* c = p; c < header_end; c++) {
+			if (*c == ',' || *c == '\n') fields++;
+		}
+		if (fields != world_hash_field_count) {
+			SDL_Log("%s has %d fields, this build hashes %d. Can't compare.", fname, fields, world_hash_field_count);
+			SDL_free(ref_text);
+			ref_text = nullptr;
+			return false;
+		}
+	}
+
+	int lines = 0;
+	for (const char* c = header_end; *c; c++) {
+		if (*c == '\n') lines++;
+	}
+
+	ref = (HashLogEntry*) ecalloc(max(lines, 1), sizeof(*ref));
+
+	p = header_end;
+	while (*p) {
+		char* end;
+		HashLogEntry* e = &ref[ref_count];
+		e->offset = usize(p - ref_text);
+		e->frame = (int) SDL_strtol(p, &end, 10);
+		if (*end != ',') break;
+		e->total = SDL_strtoull(end + 1, &end, 16);
+		ref_count++;
+
+		p = skip_line(end);
+	}
+
+	last_frame = -1;
+	checked = 0;
+	diverged = false;
+
+	SDL_Log("Comparing world hashes against %s (%d frames).", fname, ref_count);
+	return true;
+}
+
+// Reference frames are in order, but a checkpoint or rewind can send the world back.
+static HashLogEntry* find_frame(HashLog* log, int frame) {
+	int lo = 0;
+	int hi = log->ref_count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (log->ref[mid].frame < frame) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo < log->ref_count && log->ref[lo].frame == frame) {
+		return &log->ref[lo];
+	}
+	return nullptr;
+}
+
+static void report_difference(HashLog* log, const HashLogEntry* e, const WorldHash* h) {
+	// Only now parse the fields of the reference line.
+	const char* p = log->ref_text + e->offset;
+	p = SDL_strchr(p, ',') + 1; // frame
+	p = SDL_strchr(p, ',');     // total
+
+	SDL_Log("World hash differs from the reference at frame %d (total %016llx, expected %016llx).",
+			e->frame, (unsigned long long) h->total, (unsigned long long) e->total);
+
+	int reported = 0;
+	for (int i = 0; i < world_hash_field_count; i++) {
+		if (!p || *p != ',') break;
+		char* end;
+		u32 expected = (u32) SDL_strtoul(p + 1, &end, 16);
+		p = end;
+
+		if (h->fields[i] != expected) {
+			SDL_Log("  %s%s", world_hash_field_names[i], (reported == 0) ? " (first)" : "");
+			reported++;
+		}
+	}
+	if (reported == 0) {
+		SDL_Log("  (the fields match, collision in the 32-bit field hashes)");
+	}
+}
+
+void HashLog::Frame(const World* w) {
+	if (!out && !ref) return;
+
+	// Paused or in hitstop, the world's frame didn't advance.
+	if (w->frame == last_frame) return;
+	last_frame = w->frame;
+
+	WorldHash h;
+	world_hash(w, &h);
+
+	if (out) {
+		char buf[32 + 9 * WORLD_HASH_MAX_FIELDS];
+		int len = stb_snprintf(buf, sizeof(buf), "%d,%016llx", w->frame, (unsigned long long) h.total);
+		for (int i = 0; i < world_hash_field_count; i++) {
+			len += stb_snprintf(buf + len, sizeof(buf) - len, ",%08x", h.fields[i]);
+		}
+		buf[len++] = '\n';
+		SDL_RWwrite(out, buf, 1, len);
+	}
+
+	if (ref && !diverged) {
+		HashLogEntry* e = find_frame(this, w->frame);
+		if (!e) return;
+
+		if (e->total != h.total) {
+			report_difference(this, e, &h);
+			diverged = true;
+			return;
+		}
+
+		checked++;
+	}
+}
+
+void HashLog::Stop() {
+	if (out) {
+		SDL_RWclose(out);
+		out = nullptr;
+		SDL_Log("Stopped recording world hashes.");
+	}
+
+	if (ref && !diverged) {
+		SDL_Log("World hashes matched the reference for %d frames.", checked);
+	}
+
+	SDL_free(ref_text);
+	SDL_free(ref);
+	ref_text = nullptr;
+	ref = nullptr;
+	ref_count = 0;
+}
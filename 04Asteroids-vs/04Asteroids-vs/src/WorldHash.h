@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common.h"
+#include "World.h"
+#include <SDL.h>
+
+//
+// Per-frame hash of a world's gameplay state, for checking that an optimization didn't change anything.
+//
+// Every field of the player and of each object array gets its own hash (over all the objects in the array, in order),
+// plus the arrays' counts, the sleeping asteroids and their sectors, rng and next_id. Pointers and visual-only state
+// (rng_visual, particles, camera) are left out, so two runs of the same build, or of two builds, hash the same as long
+// as the simulation is bit-exact.
+//
+// A HashLog writes one CSV line per frame. Given a reference log from an earlier run, it compares every frame
+// against it and reports the first frame and fields that differ.
+//
+
+#define WORLD_HASH_MAX_FIELDS 128
+
+struct WorldHash {
+	u64 total;
+	u32 fields[WORLD_HASH_MAX_FIELDS]; // Folded to 32 bits to keep the log small. "total" is over the full 64.
+};
+
+extern const char* world_hash_field_names[];
+extern const int world_hash_field_count;
+
+void world_hash(const World* w, WorldHash* out);
+
+struct HashLogEntry {
+	int frame;
+	u64 total;
+	usize offset; // Of the line in "ref_text"
+};
+
+struct HashLog {
+	SDL_RWops* out; // Not null while recording
+
+	char* ref_text;
+	HashLogEntry* ref;
+	int ref_count;
+
+	int last_frame = -1;
+	int checked;
+	bool diverged; // Stops comparing after the first difference
+
+	bool StartRecording(const char* fname);
+
+	// Loads a log written by StartRecording. Every frame after this is compared against it.
+	bool LoadReference(const char* fname);
+
+	// Call after every update. Does nothing if neither recording nor comparing.
+	void Frame(const World* w);
+
+	void Stop();
+};
@@ -0,0 +1,198 @@
+#include "WorldState.h"
+
+#include "Profiler.h"
+#include "mathh.h"
+#include <string.h>
+
+template <typename T>
+static void save_array(WorldState* s, const T* src, int count) {
+	usize bytes = usize(count) * sizeof(T);
+	memcpy(s->data + s->size, src, bytes);
+	s->size += bytes;
+}
+
+template <typename T>
+static void load_array(const u8** p, T* dest, int count) {
+	usize bytes = usize(count) * sizeof(T);
+	memcpy(dest, *p, bytes);
+	*p += bytes;
+}
+
+// Makes room for "bytes" more after s->size.
+static bool reserve(WorldState* s, usize bytes) {
+	usize needed = s->size + bytes;
+	if (needed <= s->capacity) {
+		return true;
+	}
+
+	// Some room to grow, so that a rewind buffer doesn't realloc every other frame.
+	usize capacity = needed + needed / 4;
+	u8* data = (u8*) SDL_realloc(s->data, capacity);
+	if (!data) {
+		SDL_Log("Couldn't allocate %zu bytes for a world state.", capacity);
+		return false;
+	}
+	s->data = data;
+	s->capacity = capacity;
+	return true;
+}
+
+bool world_save_state(World* w, WorldState* s) {
+	PROFILE_SCOPE("world_save_state");
+
+	CoroArena* a = &w->coros;
+	if (a->stacks_outside) {
+		return false;
+	}
+
+	int slots = a->slot_count();
+
+	usize needed = sizeof(World)
+		+ usize(w->enemy_count)              * sizeof(Enemy)
+		+ usize(w->bullet_count)             * sizeof(Bullet)
+		+ usize(w->p_bullet_count)           * sizeof(Bullet)
+		+ usize(w->ally_count)               * sizeof(Ally)
+		+ usize(w->chest_count)              * sizeof(Chest)
+		+ usize(w->particles.particle_count) * sizeof(Particle)
+		+ usize(w->sectors.slot_count)       * sizeof(DormantAsteroid)
+		+ usize(SECTOR_COUNT)                * sizeof(Sector)
+		+ usize(slots)                       * sizeof(bool);
+
+	s->size = 0;
+	if (!reserve(s, needed)) {
+		return false;
+	}
+
+	save_array(s, w, 1);
+	save_array(s, w->enemies,             w->enemy_count);
+	save_array(s, w->bullets,             w->bullet_count);
+	save_array(s, w->p_bullets,           w->p_bullet_count);
+	save_array(s, w->allies,              w->ally_count);
+	save_array(s, w->chests,              w->chest_count);
+	save_array(s, w->particles.particles, w->particles.particle_count);
+	save_array(s, w->sectors.asteroids,   w->sectors.slot_count);
+	save_array(s, w->sectors.grid,        SECTOR_COUNT);
+	save_array(s, a->used,                slots);
+
+	// A slot is the coroutine struct, context and storage, then the stack. Scripts stay shallow, so most of a stack
+	// was never written, and only the part from the first written byte to the end of the slot is copied.
+	for (int i = 0; i < slots; i++) {
+		if (!a->used[i]) continue;
+
+		u8* slot = a->get_slot(i);
+		mco_coro* co = (mco_coro*) slot;
+		usize head = usize((u8*) co->stack_base - slot);
+		usize untouched = a->untouched_stack(i);
+		usize tail = a->slot_size - head - untouched;
+
+		if (!reserve(s, sizeof untouched + head + tail)) {
+			return false;
+		}
+		save_array(s, &untouched, 1);
+		save_array(s, slot, int(head));
+		save_array(s, slot + head + untouched, int(tail));
+	}
+
+	s->owner = w;
+	s->frame = w->frame;
+	return true;
+}
+
+bool world_load_state(World* w, const WorldState* s) {
+	PROFILE_SCOPE("world_load_state");
+
+	if (s->size == 0 || s->owner != w) {
+		return false;
+	}
+
+	// The arena only grows, so it stays as it is now. Blocks added after the save are still ours.
+	CoroArena arena = w->coros;
+	int map_version = w->interface_map_version;
+
+	const u8* p = s->data;
+	load_array(&p, w, 1);
+
+	int saved_slots = w->coros.slot_count();
+	w->coros = arena;
+	w->interface_map_version = map_version + 1; // The map texture shows the present
+	CoroArena* a = &w->coros;
+
+	load_array(&p, w->enemies,             w->enemy_count);
+	load_array(&p, w->bullets,             w->bullet_count);
+	load_array(&p, w->p_bullets,           w->p_bullet_count);
+	load_array(&p, w->allies,              w->ally_count);
+	load_array(&p, w->chests,              w->chest_count);
+	load_array(&p, w->particles.particles, w->particles.particle_count);
+	load_array(&p, w->sectors.asteroids,   w->sectors.slot_count);
+	load_array(&p, w->sectors.grid,        SECTOR_COUNT);
+
+	load_array(&p, a->used, saved_slots);
+	for (int i = saved_slots; i < a->slot_count(); i++) {
+		a->used[i] = false;
+	}
+
+	for (int i = 0; i < saved_slots; i++) {
+		if (!a->used[i]) continue;
+
+		usize untouched;
+		load_array(&p, &untouched, 1);
+
+		// The head first, it has the stack's address.
+		u8* slot = a->get_slot(i);
+		mco_coro* co = (mco_coro*) slot;
+		load_array(&p, slot, int(sizeof *co));
+		usize head = usize((u8*) co->stack_base - slot);
+		load_array(&p, slot + sizeof *co, int(head - sizeof *co));
+
+		// Zeroed again below, untouched_stack() counts on it.
+		memset(slot + head, 0, untouched);
+		load_array(&p, slot + head + untouched, int(a->slot_size - head - untouched));
+	}
+
+	SDL_assert(p == s->data + s->size);
+	return true;
+}
+
+void world_state_free(WorldState* s) {
+	SDL_free(s->data);
+	*s = {};
+}
+
+bool RewindBuffer::Push(World* w) {
+	WorldState* s = &states[head];
+	if (!world_save_state(w, s)) {
+		return false;
+	}
+
+	head = (head + 1) % REWIND_STATES;
+	count = min(count + 1, REWIND_STATES);
+	return true;
+}
+
+bool RewindBuffer::Pop(World* w) {
+	if (count == 0) {
+		return false;
+	}
+
+	int i = (head - 1 + REWIND_STATES) % REWIND_STATES;
+	if (!world_load_state(w, &states[i])) {
+		return false;
+	}
+
+	head = i;
+	count--;
+	return true;
+}
+
+void RewindBuffer::Clear() {
+	head = 0;
+	count = 0;
+	timer = 0;
+}
+
+void RewindBuffer::Free() {
+	for (int i = 0; i < REWIND_STATES; i++) {
+		world_state_free(&states[i]);
+	}
+	Clear();
+}
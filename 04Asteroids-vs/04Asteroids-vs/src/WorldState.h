@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common.h"
+#include "World.h"
+
+//
+// Whole-world save states, for checkpoints and rewind.
+//
+// A state is one contiguous buffer: the World struct, the live part of every object array, and the coroutine
+// arena slots that are in use, with only the part of their stacks that was ever written. Nothing is serialized,
+// the coroutines' stacks still hold pointers into the world's arrays and into each other, so a state can only be
+// loaded back into the same World in the same run. It's not a save file.
+//
+// The buffer is reused between saves, so after the first few a save doesn't allocate.
+//
+
+#define REWIND_STATES   60
+#define REWIND_INTERVAL 5 // Frames between rewind states
+
+struct WorldState {
+	u8* data;
+	usize size;
+	usize capacity;
+
+	const World* owner;
+	int frame;
+};
+
+// Returns false if the world's coroutines can't be saved (their stacks aren't in the arena).
+bool world_save_state(World* w, WorldState* s);
+
+// Returns false if there's nothing to load or the state came from another world.
+bool world_load_state(World* w, const WorldState* s);
+
+void world_state_free(WorldState* s);
+
+// Ring of the last REWIND_STATES states.
+struct RewindBuffer {
+	WorldState states[REWIND_STATES];
+	int head;  // Where the next state goes
+	int count;
+	int timer;
+
+	bool Push(World* w);
+
+	// Loads the newest state and removes it. Returns false when there's nothing left.
+	bool Pop(World* w);
+
+	void Clear();
+	void Free();
+};
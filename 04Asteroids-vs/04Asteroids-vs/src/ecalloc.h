@@ -1,14 +1,14 @@
-#pragma once
-
-#include "common.h"
-#include "stb_sprintf.h"
-#include <SDL.h>
-#include <stdlib.h>
-
-static void* ecalloc(usize count, usize size) {
-	void* result = calloc(count, size);
-	if (!result) {
-		ERROR("Out of memory.");
-	}
-	return result;
-}
+#pragma once
+
+#include "common.h"
+#include "stb_sprintf.h"
+#include <SDL.h>
+#include <stdlib.h>
+
+static void* ecalloc(usize count, usize size) {
+	void* result = SDL_calloc(count, size);
+	if (!result) {
+		ERROR("Out of memory.");
+	}
+	return result;
+}
@@ -1,46 +1,139 @@
-//
-// https://20_games_challenge.gitlab.io/games/asteroids/
-//
-
-#include "Game.h"
-
-#ifdef __EMSCRIPTEN__
-#include <emscripten.h>
-
-static void emscripten_main_loop() {
-	game->Frame();
-}
-#endif
-
-int main(int argc, char* argv[]) {
-	Game game_instance{};
-	game = &game_instance;
-
-	game->Init();
-
-#ifdef __EMSCRIPTEN__
-	emscripten_set_main_loop(emscripten_main_loop, -1, 1);
-#else
-	game->Run();
-#endif
-
-	game->Quit();
-
-	return 0;
-}
-
-#define MINICORO_IMPL
-#define MCO_LOG(s) SDL_Log(s)
-
-#ifdef NDEBUG
-#define MCO_DEFAULT_STACK_SIZE 16384
-#define MCO_MIN_STACK_SIZE 16384
-#else
-#define MCO_DEFAULT_STACK_SIZE 32768
-#define MCO_MIN_STACK_SIZE 32768
-#endif
-
-#include "minicoro.h"
-
-#define STB_SPRINTF_IMPLEMENTATION
-#include "stb_sprintf.h"
+//
+// https://20_games_challenge.gitlab.io/games/asteroids/
+//
+
+#include "Game.h"
+#include "Bench.h"
+#include "Batch.h"
+#include "SelfTest.h"
+#include "AllocTracker.h"
+#include "Metrics.h"
+#include "DrawCapture.h"
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+
+static void emscripten_main_loop() {
+	game->Frame();
+}
+#endif
+
+static bool bench;
+static const char* bench_baseline;
+static const char* bench_save;
+static bool watch;
+static int batch_count;
+static bool selftest;
+static const char* replay_fname;
+
+// --stress <name> [--frames N] [--report file.json]
+// --bench [--baseline file.csv] [--save-baseline file.csv]
+// --batch N [--frames N] [--report file.csv]
+// --selftest
+// --watch (the metrics of a game running with METRICS_SHM=1)
+// --replay-draw drawcap.bin
+static bool parse_args(int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* next = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (SDL_strcmp(arg, "--stress") == 0 && next) {
+			game->stress.scenario = find_stress_scenario(next);
+			if (!game->stress.scenario) {
+				SDL_Log("Unknown stress scenario \"%s\". There are:", next);
+				for (int j = 0; j < stress_scenario_count; j++) {
+					SDL_Log("  %-16s %s", stress_scenarios[j].name, stress_scenarios[j].description);
+				}
+				return false;
+			}
+			i++;
+		} else if (SDL_strcmp(arg, "--frames") == 0 && next) {
+			game->stress.frames = SDL_atoi(next);
+			i++;
+		} else if (SDL_strcmp(arg, "--report") == 0 && next) {
+			game->stress.report_fname = next;
+			i++;
+		} else if (SDL_strcmp(arg, "--bench") == 0) {
+			bench = true;
+		} else if (SDL_strcmp(arg, "--baseline") == 0 && next) {
+			bench_baseline = next;
+			i++;
+		} else if (SDL_strcmp(arg, "--save-baseline") == 0 && next) {
+			bench_save = next;
+			i++;
+		} else if (SDL_strcmp(arg, "--batch") == 0 && next) {
+			batch_count = SDL_atoi(next);
+			i++;
+		} else if (SDL_strcmp(arg, "--selftest") == 0) {
+			selftest = true;
+		} else if (SDL_strcmp(arg, "--watch") == 0) {
+			watch = true;
+		} else if (SDL_strcmp(arg, "--replay-draw") == 0 && next) {
+			replay_fname = next;
+			i++;
+		} else {
+			SDL_Log("Unknown argument \"%s\".", arg);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	alloc_tracker_init();
+
+	Game game_instance{};
+	game = &game_instance;
+
+	if (!parse_args(argc, argv)) {
+		return 1;
+	}
+
+	if (bench) {
+		return run_benchmarks(bench_baseline, bench_save);
+	}
+
+	if (batch_count > 0) {
+		return run_batch(batch_count, game->stress.frames, game->stress.report_fname);
+	}
+
+	if (selftest) {
+		return run_selftest();
+	}
+
+	if (watch) {
+		return metrics_watch();
+	}
+
+	if (replay_fname) {
+		return draw_replay(replay_fname);
+	}
+
+	game->Init();
+
+#ifdef __EMSCRIPTEN__
+	emscripten_set_main_loop(emscripten_main_loop, -1, 1);
+#else
+	game->Run();
+#endif
+
+	game->Quit();
+
+	return 0;
+}
+
+#define MINICORO_IMPL
+#define MCO_LOG(s) SDL_Log(s)
+
+#ifdef NDEBUG
+#define MCO_DEFAULT_STACK_SIZE 16384
+#define MCO_MIN_STACK_SIZE 16384
+#else
+#define MCO_DEFAULT_STACK_SIZE 32768
+#define MCO_MIN_STACK_SIZE 32768
+#endif
+
+#include "minicoro.h"
+
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb_sprintf.h"
@@ -1,265 +1,459 @@
-#include "scripts_common.h"
-
-static Enemy* _create_enemy(float x, float y, float dir,
-							int type,
-							float max_spd,
-							float acc,
-							Sprite* sprite,
-							mco_func* func) {
-	Enemy* e = world->CreateEnemy();
-
-	e->x = x;
-	e->y = y;
-	e->max_spd = max_spd;
-	e->hsp = lengthdir_x(e->max_spd, dir);
-	e->vsp = lengthdir_y(e->max_spd, dir);
-	e->angle = dir;
-
-	e->type = type;
-	e->sprite = sprite;
-	mco_desc desc = mco_desc_init(func, 0);
-	mco_create(&e->co, &desc);
-	e->acc = acc;
-
-	e->experience = 5.0f;
-	e->money = 5.0f;
-
-	return e;
-}
-
-static Enemy* create_enemy(float x, float y, float dir) {
-	extern mco_func script_enemy;
-
-	float max_spd = random_range(&world->rng, 10.0f, 11.0f);
-	float acc = random_range(&world->rng, 0.25f, 0.35f);
-
-	Enemy* e = _create_enemy(x, y, dir,
-							 TYPE_ENEMY,
-							 max_spd, acc,
-							 spr_player_ship,
-							 script_enemy);
-
-	e->stop_when_close_to_player = random_chance(&world->rng, 50.0f);
-	e->not_exact_player_dir = random_chance(&world->rng, 50.0f);
-
-	return e;
-}
-
-static Enemy* create_enemy_spread(float x, float y, float dir) {
-	extern mco_func script_enemy_spread;
-
-	float max_spd = 10.0f;
-	float acc = 0.3f;
-
-	Enemy* e = _create_enemy(x, y, dir,
-							 TYPE_ENEMY_SPREAD,
-							 max_spd, acc,
-							 spr_player_ship,
-							 script_enemy_spread);
-
-	return e;
-}
-
-static Enemy* create_enemy_missile(float x, float y, float dir) {
-	extern mco_func script_enemy_missile;
-
-	float max_spd = 8.0f;
-	float acc = 0.2f;
-
-	Enemy* e = _create_enemy(x, y, dir,
-							 TYPE_ENEMY_MISSILE,
-							 max_spd, acc,
-							 spr_player_ship,
-							 script_enemy_missile);
-
-	return e;
-}
-
-static Enemy* create_boss(float x, float y) {
-	extern mco_func boss0_script;
-
-	Enemy* e = world->CreateEnemy();
-	e->x = x;
-	e->y = y;
-	e->radius = 25.0f;
-	e->type = TYPE_BOSS;
-	e->health = 2000.0f;
-	e->max_health = 2000.0f;
-	e->sprite = spr_invader;
-	mco_desc desc = mco_desc_init(boss0_script, 0);
-	mco_create(&e->co, &desc);
-
-	return e;
-}
-
-/*
-static void spawn_ships(mco_coro* co, int i) {
-	float dir = random_range(&world->rng, 0.0f, 360.0f);
-	float x = world->player.x - lengthdir_x(4000.0f, dir);
-	float y = world->player.y - lengthdir_y(4000.0f, dir);
-
-	while (i--) {
-		create_enemy(x, y, dir + 180.0f);
-
-		x += random_range(&world->rng, -50.0f, 50.0f);
-		y += random_range(&world->rng, -50.0f, 50.0f);
-
-		wait(co, 30);
-	}
-}
-
-void stage0_script(mco_coro* co) {
-	// int a;
-	// SDL_Log("%lld", co->stack_size - (i64(&a) - i64(co->stack_base)));
-
-	// world->player.power = 200;
-	// goto l_boss;
-
-	wait(co, 40 * 60);
-
-	for (int i = 5; i--;) {
-		spawn_ships(co, 1);
-		wait(co, 10 * 60);
-		while (world->get_enemy_count() > 0) wait(co, 1);
-		wait(co, 5 * 60);
-	}
-
-	for (int i = 3; i--;) {
-		spawn_ships(co, 3);
-		wait(co, 15 * 60);
-		while (world->get_enemy_count() > 0) wait(co, 1);
-		wait(co, 5 * 60);
-	}
-
-	for (int i = 2; i--;) {
-		spawn_ships(co, 5);
-		wait(co, 15 * 60);
-		while (world->get_enemy_count() > 0) wait(co, 1);
-		wait(co, 5 * 60);
-	}
-
-l_boss:
-	{
-		float dir = random_range(&world->rng, 0.0f, 360.0f);
-		float x = world->player.x - lengthdir_x(1500.0f, dir);
-		float y = world->player.y - lengthdir_y(1500.0f, dir);
-
-		create_boss(x, y);
-	}
-}
-//*/
-
-/*
-template <typename F>
-static bool ai_step(int cost, float chance,
-					int &points, int &total_points,
-					const F& f) {
-	if (points >= cost) {
-		if (random_chance(&world->rng, chance)) {
-			float dir = random_range(&world->rng, 0.0f, 360.0f);
-			float x = world->player.x - lengthdir_x(4000.0f, dir);
-			float y = world->player.y - lengthdir_y(4000.0f, dir);
-			f(x, y, dir);
-
-			points -= cost;
-			total_points += cost;
-
-			return true;
-		}
-	}
-
-	return false;
-}
-
-static void ai_tick(mco_coro* co, int &points, int &total_points) {
-	int count = 0;
-
-	for (int i = points / 5; i--;) {
-		bool spawned = false;
-
-		if (ai_step(10, 25.0f, points, total_points, create_enemy_spread)) {spawned = true; count++;}
-
-		if (ai_step(10, 25.0f, points, total_points, create_enemy_missile)) {spawned = true; count++;}
-
-		if (ai_step(5, 50.0f, points, total_points, create_enemy)) {spawned = true; count++;}
-
-		// if (!spawned || count >= 5) {
-		// 	break;
-		// }
-	}
-}
-
-void stage0_script(mco_coro* co) {
-	int points = 0;
-	int total_points = 0;
-
-	int tick_wait_time = 5;
-	int tick_wait_timer = 0;
-
-	world->ai_points = &points;
-	world->ai_tick_wait_time = &tick_wait_time;
-	world->ai_tick_wait_timer = &tick_wait_timer;
-
-	world->player.items[ITEM_MISSILES]++;
-	world->player.active_item = ACTIVE_ITEM_HEAL;
-
-	for (;;) {
-		// if (world->get_enemy_count() < 10) {
-			points++;
-		// }
-
-		tick_wait_timer++;
-		if (tick_wait_timer >= tick_wait_time) {
-			ai_tick(co, points, total_points);
-
-			tick_wait_time = random_range(&world->rng, 5, 10);
-			tick_wait_timer = 0;
-		}
-
-		wait(co, 60);
-	}
-}
-//*/
-
-//*
-static void spawn_wave(mco_coro* co, int wave) {
-	int count = wave / 5 + 1;
-
-	float missile_chance = float(wave / 5) / 4.0f * 25.0f;
-	float spread_chance  = float(wave / 5) / 4.0f * 25.0f;
-
-	while (count--) {
-		float dir = random_range(&world->rng, 0.0f, 360.0f);
-		float x = world->player.x - lengthdir_x(4000.0f, dir);
-		float y = world->player.y - lengthdir_y(4000.0f, dir);
-
-		if (random_chance(&world->rng, missile_chance)) {
-			create_enemy_missile(x, y, dir);
-		} else if (random_chance(&world->rng, spread_chance)) {
-			create_enemy_spread(x, y, dir);
-		} else {
-			create_enemy(x, y, dir);
-		}
-
-		wait(co, 60);
-	}
-}
-
-void stage0_script(mco_coro* co) {
-	wait(co, 60 * 60);
-
-	int wave = 1;
-
-	for (int i = 20; i--;) {
-		spawn_wave(co, wave++);
-
-		wait(co, 10 * 60);
-
-		while (world->get_enemy_count() > 1) {
-			wait(co, 1);
-		}
-
-		wait(co, 10 * 60);
-	}
-}
-//*/
+#include "scripts_common.h"
+
+static Enemy* _create_enemy(World* w, float x, float y, float dir,
+							int type,
+							float max_spd,
+							float acc,
+							Sprite* sprite,
+							mco_func* func) {
+	Enemy* e = w->CreateEnemy();
+
+	e->x = x;
+	e->y = y;
+	e->max_spd = max_spd;
+	e->hsp = lengthdir_x(e->max_spd, dir);
+	e->vsp = lengthdir_y(e->max_spd, dir);
+	e->angle = dir;
+
+	e->type = type;
+	e->sprite = sprite;
+	e->co = w->coros.Create(func);
+	e->acc = acc;
+
+	e->experience = 5.0f;
+	e->money = 5.0f;
+
+	return e;
+}
+
+static Enemy* create_enemy(World* w, float x, float y, float dir) {
+	extern mco_func script_enemy;
+
+	float max_spd = random_range(&w->rng, 10.0f, 11.0f);
+	float acc = random_range(&w->rng, 0.25f, 0.35f);
+
+	Enemy* e = _create_enemy(w, x, y, dir,
+							 TYPE_ENEMY,
+							 max_spd, acc,
+							 spr_player_ship,
+							 script_enemy);
+
+	e->stop_when_close_to_player = random_chance(&w->rng, 50.0f);
+	e->not_exact_player_dir = random_chance(&w->rng, 50.0f);
+
+	return e;
+}
+
+static Enemy* create_enemy_spread(World* w, float x, float y, float dir) {
+	extern mco_func script_enemy_spread;
+
+	float max_spd = 10.0f;
+	float acc = 0.3f;
+
+	Enemy* e = _create_enemy(w, x, y, dir,
+							 TYPE_ENEMY_SPREAD,
+							 max_spd, acc,
+							 spr_player_ship,
+							 script_enemy_spread);
+
+	return e;
+}
+
+static Enemy* create_enemy_missile(World* w, float x, float y, float dir) {
+	extern mco_func script_enemy_missile;
+
+	float max_spd = 8.0f;
+	float acc = 0.2f;
+
+	Enemy* e = _create_enemy(w, x, y, dir,
+							 TYPE_ENEMY_MISSILE,
+							 max_spd, acc,
+							 spr_player_ship,
+							 script_enemy_missile);
+
+	return e;
+}
+
+static Enemy* create_boss(World* w, float x, float y) {
+	extern mco_func boss0_script;
+
+	Enemy* e = w->CreateEnemy();
+	e->x = x;
+	e->y = y;
+	e->radius = 25.0f;
+	e->type = TYPE_BOSS;
+	e->health = 2000.0f;
+	e->max_health = 2000.0f;
+	e->sprite = spr_invader;
+	e->co = w->coros.Create(boss0_script);
+
+	return e;
+}
+
+/*
+static void spawn_ships(mco_coro* co, int i) {
+	World* w = script_world(co);
+	float dir = random_range(&w->rng, 0.0f, 360.0f);
+	float x = w->player.x - lengthdir_x(4000.0f, dir);
+	float y = w->player.y - lengthdir_y(4000.0f, dir);
+
+	while (i--) {
+		create_enemy(w, x, y, dir + 180.0f);
+
+		x += random_range(&w->rng, -50.0f, 50.0f);
+		y += random_range(&w->rng, -50.0f, 50.0f);
+
+		wait(co, 30);
+	}
+}
+
+void stage0_script(mco_coro* co) {
+	World* w = script_world(co);
+
+	// int a;
+	// SDL_Log("%lld", co->stack_size - (i64(&a) - i64(co->stack_base)));
+
+	// w->player.power = 200;
+	// goto l_boss;
+
+	wait(co, 40 * 60);
+
+	for (int i = 5; i--;) {
+		spawn_ships(co, 1);
+		wait(co, 10 * 60);
+		while (w->get_enemy_count() > 0) wait(co, 1);
+		wait(co, 5 * 60);
+	}
+
+	for (int i = 3; i--;) {
+		spawn_ships(co, 3);
+		wait(co, 15 * 60);
+		while (w->get_enemy_count() > 0) wait(co, 1);
+		wait(co, 5 * 60);
+	}
+
+	for (int i = 2; i--;) {
+		spawn_ships(co, 5);
+		wait(co, 15 * 60);
+		while (w->get_enemy_count() > 0) wait(co, 1);
+		wait(co, 5 * 60);
+	}
+
+l_boss:
+	{
+		float dir = random_range(&w->rng, 0.0f, 360.0f);
+		float x = w->player.x - lengthdir_x(1500.0f, dir);
+		float y = w->player.y - lengthdir_y(1500.0f, dir);
+
+		create_boss(w, x, y);
+	}
+}
+//*/
+
+/*
+template <typename F>
+static bool ai_step(World* w, int cost, float chance,
+					int &points, int &total_points,
+					const F& f) {
+	if (points >= cost) {
+		if (random_chance(&w->rng, chance)) {
+			float dir = random_range(&w->rng, 0.0f, 360.0f);
+			float x = w->player.x - lengthdir_x(4000.0f, dir);
+			float y = w->player.y - lengthdir_y(4000.0f, dir);
+			f(w, x, y, dir);
+
+			points -= cost;
+			total_points += cost;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void ai_tick(mco_coro* co, int &points, int &total_points) {
+	World* w = script_world(co);
+	int count = 0;
+
+	for (int i = points / 5; i--;) {
+		bool spawned = false;
+
+		if (ai_step(w, 10, 25.0f, points, total_points, create_enemy_spread)) {spawned = true; count++;}
+
+		if (ai_step(w, 10, 25.0f, points, total_points, create_enemy_missile)) {spawned = true; count++;}
+
+		if (ai_step(w, 5, 50.0f, points, total_points, create_enemy)) {spawned = true; count++;}
+
+		// if (!spawned || count >= 5) {
+		// 	break;
+		// }
+	}
+}
+
+void stage0_script(mco_coro* co) {
+	World* w = script_world(co);
+	int points = 0;
+	int total_points = 0;
+
+	int tick_wait_time = 5;
+	int tick_wait_timer = 0;
+
+	w->ai_points = &points;
+	w->ai_tick_wait_time = &tick_wait_time;
+	w->ai_tick_wait_timer = &tick_wait_timer;
+
+	w->player.items[ITEM_MISSILES]++;
+	w->player.active_item = ACTIVE_ITEM_HEAL;
+
+	for (;;) {
+		// if (w->get_enemy_count() < 10) {
+			points++;
+		// }
+
+		tick_wait_timer++;
+		if (tick_wait_timer >= tick_wait_time) {
+			ai_tick(co, points, total_points);
+
+			tick_wait_time = random_range(&w->rng, 5, 10);
+			tick_wait_timer = 0;
+		}
+
+		wait(co, 60);
+	}
+}
+//*/
+
+//*
+static void spawn_wave(mco_coro* co, int wave) {
+	World* w = script_world(co);
+	int count = wave / 5 + 1;
+
+	float missile_chance = float(wave / 5) / 4.0f * 25.0f;
+	float spread_chance  = float(wave / 5) / 4.0f * 25.0f;
+
+	while (count--) {
+		float dir = random_range(&w->rng, 0.0f, 360.0f);
+		float x = w->player.x - lengthdir_x(4000.0f, dir);
+		float y = w->player.y - lengthdir_y(4000.0f, dir);
+
+		if (random_chance(&w->rng, missile_chance)) {
+			create_enemy_missile(w, x, y, dir);
+		} else if (random_chance(&w->rng, spread_chance)) {
+			create_enemy_spread(w, x, y, dir);
+		} else {
+			create_enemy(w, x, y, dir);
+		}
+
+		wait(co, 60);
+	}
+}
+
+void stage0_script(mco_coro* co) {
+	World* w = script_world(co);
+
+	wait(co, 60 * 60);
+
+	int wave = 1;
+
+	for (int i = 20; i--;) {
+		spawn_wave(co, wave++);
+
+		wait(co, 10 * 60);
+
+		while (w->get_enemy_count() > 1) {
+			wait(co, 1);
+		}
+
+		wait(co, 10 * 60);
+	}
+}
+//*/
+
+//
+// Stress scenarios (--stress on the command line). Each one keeps some of the pools full for as long as it runs.
+// Everything comes from the world's rng, so a scenario plays out the same way every time.
+//
+
+static void keep_player_alive(World* w) {
+	w->player.health = w->player.max_health;
+	w->player.invincibility = 60.0f;
+}
+
+// A random point within "dist" of the player.
+static void near_player(World* w, float dist, float* x, float* y) {
+	float dir = random_range(&w->rng, 0.0f, 360.0f);
+	float len = random_range(&w->rng, 0.0f, dist);
+	*x = w->player.x + lengthdir_x(len, dir);
+	*y = w->player.y + lengthdir_y(len, dir);
+}
+
+static Bullet* stress_player_shoot(World* w, float spd, float dir) {
+	Player* p = &w->player;
+	Bullet* pb = w->CreatePlrBullet();
+	pb->x = p->x + lengthdir_x(20.0f, dir);
+	pb->y = p->y + lengthdir_y(20.0f, dir);
+	pb->hsp = lengthdir_x(spd, dir);
+	pb->vsp = lengthdir_y(spd, dir);
+	pb->dmg = 10.0f;
+	return pb;
+}
+
+void stress_asteroid_field(mco_coro* co) {
+	World* w = script_world(co);
+
+	for (;;) {
+		keep_player_alive(w);
+
+		while (w->enemy_count < MAX_ENEMIES) {
+			// Half of them around the player, so that drawing and collisions get their share.
+			float x;
+			float y;
+			if (w->enemy_count % 2 == 0) {
+				near_player(w, 1500.0f, &x, &y);
+			} else {
+				x = random_range(&w->rng, 0.0f, MAP_W);
+				y = random_range(&w->rng, 0.0f, MAP_H);
+			}
+
+			float dir = random_range(&w->rng, 0.0f, 360.0f);
+			float spd = random_range(&w->rng, 1.0f, 3.0f);
+			make_asteroid(w, x, y, lengthdir_x(spd, dir), lengthdir_y(spd, dir), random_range(&w->rng, 1, 3));
+		}
+
+		wait(co, 1);
+	}
+}
+
+void stress_bullet_curtain(mco_coro* co) {
+	World* w = script_world(co);
+	const int emitters = 16;
+	float angle = 0.0f;
+
+	for (;;) {
+		keep_player_alive(w);
+
+		// Rings from emitters around the player, aimed inwards, until the pool is full.
+		int n = min(MAX_BULLETS - w->bullet_count, 64);
+		for (int i = 0; i < n; i++) {
+			float emitter_dir = angle + float(i % emitters) * (360.0f / float(emitters));
+			float x = w->player.x + lengthdir_x(600.0f, emitter_dir);
+			float y = w->player.y + lengthdir_y(600.0f, emitter_dir);
+			float dir = emitter_dir + 180.0f + float(i / emitters) * 7.0f - 10.0f;
+
+			Bullet* b = w->CreateBullet();
+			b->x = x;
+			b->y = y;
+			b->hsp = lengthdir_x(4.0f, dir);
+			b->vsp = lengthdir_y(4.0f, dir);
+			b->dmg = 15.0f;
+		}
+
+		angle += 3.0f;
+		wait(co, 1);
+	}
+}
+
+void stress_missile_swarm(mco_coro* co) {
+	World* w = script_world(co);
+	const int missile_enemies = 300;
+	float dir = 0.0f;
+
+	for (;;) {
+		keep_player_alive(w);
+
+		int enemies = w->get_enemy_count();
+		for (int i = enemies; i < missile_enemies && w->enemy_count < MAX_ENEMIES; i++) {
+			float d = random_range(&w->rng, 0.0f, 360.0f);
+			float x = w->player.x - lengthdir_x(1500.0f, d);
+			float y = w->player.y - lengthdir_y(1500.0f, d);
+			create_enemy_missile(w, x, y, d);
+		}
+
+		// Homing missiles from the player in every direction, like the missiles item.
+		int n = min(MAX_PLR_BULLETS - w->p_bullet_count, 40);
+		for (int i = 0; i < n; i++) {
+			Bullet* pb = stress_player_shoot(w, 0.0f, dir);
+			pb->type = BulletType::HOMING;
+			pb->sprite = spr_missile;
+			pb->lifespan = 10.0f * 60.0f;
+			pb->dir = dir;
+			pb->max_acc = 0.5f;
+			pb->max_spd = 13.5f;
+
+			dir += 37.0f;
+		}
+
+		wait(co, 1);
+	}
+}
+
+void stress_boss_fight(mco_coro* co) {
+	World* w = script_world(co);
+	const int bosses = 4;
+	const int escorts = 50;
+
+	for (;;) {
+		keep_player_alive(w);
+
+		int boss_count = 0;
+		int escort_count = 0;
+		for (int i = 0; i < w->enemy_count; i++) {
+			if (w->enemies[i].type == TYPE_BOSS) boss_count++;
+			else if (w->enemies[i].type >= TYPE_ENEMY) escort_count++;
+		}
+
+		for (int i = boss_count; i < bosses && w->enemy_count < MAX_ENEMIES; i++) {
+			float d = random_range(&w->rng, 0.0f, 360.0f);
+			create_boss(w, w->player.x + lengthdir_x(500.0f, d), w->player.y + lengthdir_y(500.0f, d));
+		}
+
+		for (int i = escort_count; i < escorts && w->enemy_count < MAX_ENEMIES; i++) {
+			float d = random_range(&w->rng, 0.0f, 360.0f);
+			float x = w->player.x - lengthdir_x(1200.0f, d);
+			float y = w->player.y - lengthdir_y(1200.0f, d);
+			create_enemy_spread(w, x, y, d);
+		}
+
+		// The player fires back at the nearest boss.
+		Enemy* target = nullptr;
+		float target_dist = INFINITY;
+		for (int i = 0; i < w->enemy_count; i++) {
+			Enemy* e = &w->enemies[i];
+			if (e->type != TYPE_BOSS) continue;
+			float d = point_distance_wrapped(w->player.x, w->player.y, e->x, e->y);
+			if (d < target_dist) {
+				target = e;
+				target_dist = d;
+			}
+		}
+
+		if (target) {
+			float dir = point_direction_wrapped(w->player.x, w->player.y, target->x, target->y);
+			int n = min(MAX_PLR_BULLETS - w->p_bullet_count, 8);
+			for (int i = 0; i < n; i++) {
+				stress_player_shoot(w, 20.0f, dir + random_range(&w->rng, -5.0f, 5.0f));
+			}
+		}
+
+		wait(co, 1);
+	}
+}
+
+void stress_particle_storm(mco_coro* co) {
+	World* w = script_world(co);
+
+	for (;;) {
+		keep_player_alive(w);
+
+		// On screen, so that all of them get drawn.
+		while (w->particles.particle_count < MAX_PARTICLES) {
+			float x = w->player.x + random_range(&w->rng, -float(GAME_W) / 2.0f, float(GAME_W) / 2.0f);
+			float y = w->player.y + random_range(&w->rng, -float(GAME_H) / 2.0f, float(GAME_H) / 2.0f);
+			int n = min(MAX_PARTICLES - w->particles.particle_count, 8);
+			w->particles.CreateParticles(x, y, PARTICLE_ASTEROID_EXPLOSION, n);
+		}
+
+		wait(co, 1);
+	}
+}
@@ -38,6 +38,16 @@ inline u64 random_next(xoshiro256plusplus* rng) {
 	return result;
 }
 
+// Fills the state from a 64-bit seed with splitmix64, as the authors recommend.
+inline void random_seed(xoshiro256plusplus* rng, u64 seed) {
+	for (int i = 0; i < 4; i++) {
+		u64 z = (seed += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		rng->s[i] = z ^ (z >> 31);
+	}
+}
+
 // [a, b)
 inline float random_range(xoshiro256plusplus* rng, float a, float b) {
 	u64 x = random_next(rng);